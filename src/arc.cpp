@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <cmath>
+#include "arc.h"
+#include "bezier.h"
+#include "polygon.h"
+#include "ray.h"
+#include "rectangle.h"
+
+namespace {
+
+const double TWO_PI = 2 * M_PI;
+
+// Smallest distance from the arc points on the line through its center and
+// toward, the only interior points where the arc can be nearest to another
+// figure; HUGE_VAL when neither is in the sweep.
+template <typename Distance>
+double across_center(const Arc &arc, const Point &toward, Distance &&distance)
+{
+    double dx = toward.x() - arc.center().x();
+    double dy = toward.y() - arc.center().y();
+    double length = hypot(dx, dy);
+    if (length == 0) {
+        return HUGE_VAL;
+    }
+
+    double result = HUGE_VAL;
+    for (double side : {1.0, -1.0}) {
+        Point point(arc.center().x() + side * dx / length * arc.radius(),
+                    arc.center().y() + side * dy / length * arc.radius());
+        if (arc.spans(point)) {
+            result = fmin(result, distance(point));
+        }
+    }
+    return result;
+}
+
+Point nearest_on_segment(const Point &point, const Segment &segment)
+{
+    double dx = segment.end().x() - segment.start().x();
+    double dy = segment.end().y() - segment.start().y();
+    double length_2 = dx * dx + dy * dy;
+    if (length_2 == 0) {
+        return segment.start();
+    }
+    double t = ((point.x() - segment.start().x()) * dx + (point.y() - segment.start().y()) * dy) / length_2;
+    t = fmax(0, fmin(1, t));
+    return Point(segment.start().x() + t * dx, segment.start().y() + t * dy);
+}
+
+}//namespace
+
+Arc::Arc(double x, double y, double radius, double start_angle, double end_angle)
+    : circle_(x, y, radius),
+      start_angle_(fmod(start_angle, TWO_PI)),
+      sweep_(fmod(end_angle - start_angle, TWO_PI))
+{
+    if (sweep_ <= 0) {
+        sweep_ += TWO_PI;
+    }
+
+    //the ends plus every axis extreme inside the sweep
+    bbox_.expand(start());
+    bbox_.expand(end());
+    for (int quarter = 0; quarter < 4; quarter++) {
+        Point extreme = at_angle(quarter * M_PI / 2);
+        if (spans(extreme)) {
+            bbox_.expand(extreme);
+        }
+    }
+}
+
+Point Arc::at_angle(double angle) const
+{
+    return Point(center().x() + radius() * cos(angle), center().y() + radius() * sin(angle));
+}
+
+bool Arc::spans(const Point &point) const
+{
+    if (radius() == 0) {
+        return true;
+    }
+    double offset = fmod(atan2(point.y() - center().y(), point.x() - center().x()) - start_angle_, TWO_PI);
+    if (offset < 0) {
+        offset += TWO_PI;
+    }
+    double tolerance = EPS / radius();
+    return offset <= sweep_ + tolerance || offset >= TWO_PI - tolerance;
+}
+
+void Arc::keep_spanned(Points &points) const
+{
+    auto last = std::remove_if(points.begin(), points.end(), [&](const Point &point) { return !spans(point); });
+    points.erase(last, points.end());
+}
+
+Points Arc::intersect(const Figure &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Arc::intersect(const Segment &other, std::pmr::memory_resource *resource) const
+{
+    if (!bbox_.intersects(other.start(), other.end())) {
+        return Points(resource);
+    }
+    Points result = circle_.intersect(other, resource);
+    keep_spanned(result);
+    return result;
+}
+
+Points Arc::intersect(const Circle &other, std::pmr::memory_resource *resource) const
+{
+    //coincident circles overlap along the whole arc, nothing to report
+    if (!bbox_.meets_circle(other.center(), other.radius()) || center() == other.center()) {
+        return Points(resource);
+    }
+    Points result = circle_.intersect(other, resource);
+    keep_spanned(result);
+    return result;
+}
+
+Points Arc::intersect(const Polyline &other, std::pmr::memory_resource *resource) const
+{
+    if (!bbox_.intersects(other.bbox())) {
+        return Points(resource);
+    }
+    Points result = circle_.intersect(other, resource);
+    keep_spanned(result);
+    return result;
+}
+
+Points Arc::intersect(const Polygon &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Arc::intersect(const Rectangle &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Arc::intersect(const Arc &other, std::pmr::memory_resource *resource) const
+{
+    if (!bbox_.intersects(other.bbox_) || center() == other.center()) {
+        return Points(resource);
+    }
+    Points result = circle_.intersect(other.circle_, resource);
+    keep_spanned(result);
+    other.keep_spanned(result);
+    return result;
+}
+
+Points Arc::intersect(const Bezier &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+double Arc::distance(const Point &point) const
+{
+    if (spans(point)) {
+        return circle_.distance(point);
+    }
+    return fmin(start().distance(point), end().distance(point));
+}
+
+double Arc::distance(const Figure &other) const
+{
+    return other.distance(*this);
+}
+
+double Arc::distance(const Segment &other) const
+{
+    if (!intersect(other).empty()) {
+        return 0;
+    }
+    double result = fmin(fmin(distance(other.start()), distance(other.end())),
+                         fmin(other.distance(start()), other.distance(end())));
+    Point foot = nearest_on_segment(center(), other);
+    return fmin(result, across_center(*this, foot, [&](const Point &point) { return other.distance(point); }));
+}
+
+double Arc::distance(const Circle &other) const
+{
+    if (!intersect(other).empty()) {
+        return 0;
+    }
+    double result = fmin(other.distance(start()), other.distance(end()));
+    return fmin(result, across_center(*this, other.center(), [&](const Point &point) { return other.distance(point); }));
+}
+
+double Arc::distance(const Polyline &other) const
+{
+    if (other.size() == 1) {
+        return distance(other[0]);
+    }
+    double result = HUGE_VAL;
+    for (std::size_t i = 1; i < other.size() && result > 0; i++) {
+        result = fmin(result, distance(Segment(other[i - 1], other[i])));
+    }
+    return result;
+}
+
+double Arc::distance(const Polygon &other) const
+{
+    return other.distance(*this);
+}
+
+double Arc::distance(const Rectangle &other) const
+{
+    return other.distance(*this);
+}
+
+double Arc::distance(const Arc &other) const
+{
+    if (!intersect(other).empty()) {
+        return 0;
+    }
+    double result = fmin(fmin(distance(other.start()), distance(other.end())),
+                         fmin(other.distance(start()), other.distance(end())));
+    return fmin(result, across_center(*this, other.center(), [&](const Point &point) { return other.distance(point); }));
+}
+
+double Arc::distance(const Bezier &other) const
+{
+    return other.distance(*this);
+}
+
+double Arc::first_hit(const Ray &ray) const
+{
+    for (double distance : circle_.hits(ray)) {
+        if (spans(ray.at(distance))) {
+            return distance;
+        }
+    }
+    return HUGE_VAL;
+}
+
+Distances Arc::hits(const Ray &ray) const
+{
+    Distances result;
+    for (double distance : circle_.hits(ray)) {
+        if (spans(ray.at(distance))) {
+            result.push_back(distance);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "figures.h"
+
+// Circular arc running counterclockwise from start_angle to end_angle
+// (radians) around the center; equal angles give the full circle.
+// Intersections come from the Circle kernels and keep the points whose
+// direction from the center lies in the sweep, so an arc stays exact and
+// costs about what its circle does.
+class Arc : public Figure
+{
+public:
+    Arc(double x, double y, double radius, double start_angle, double end_angle);
+
+    const Circle &circle() const { return circle_; }
+    Point center() const { return circle_.center(); }
+    double radius() const { return circle_.radius(); }
+    double start_angle() const { return start_angle_; }
+    // counterclockwise, in (0, 2 pi]
+    double sweep() const { return sweep_; }
+    Point start() const { return at_angle(start_angle_); }
+    Point end() const { return at_angle(start_angle_ + sweep_); }
+
+    // whether the direction from the center to the point lies in the sweep
+    bool spans(const Point &point) const;
+
+    double length() const override { return radius() * sweep_; }
+    BoundingBox bbox() const override { return bbox_; }
+
+    using Figure::intersect;
+    Points intersect(const Figure &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Segment &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Circle &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Polyline &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Polygon &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Rectangle &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Arc &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Bezier &other, std::pmr::memory_resource *resource) const override;
+
+    double distance(const Point &point) const override;
+    double distance(const Figure &other) const override;
+    double distance(const Segment &other) const override;
+    double distance(const Circle &other) const override;
+    double distance(const Polyline &other) const override;
+    double distance(const Polygon &other) const override;
+    double distance(const Rectangle &other) const override;
+    double distance(const Arc &other) const override;
+    double distance(const Bezier &other) const override;
+
+    double first_hit(const Ray &ray) const override;
+    Distances hits(const Ray &ray) const override;
+
+private:
+    Point at_angle(double angle) const;
+    // drops the points outside the sweep
+    void keep_spanned(Points &points) const;
+
+    Circle circle_;
+    double start_angle_;
+    double sweep_;
+    BoundingBox bbox_;
+};
@@ -0,0 +1,90 @@
+#include <memory>
+#include <optional>
+#include "arena.h"
+
+namespace {
+
+const std::size_t INITIAL_ARENA_SIZE = 64 * 1024;
+
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    std::size_t allocated() const { return allocated_; }
+    void reset() { allocated_ = 0; }
+
+private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        allocated_ += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    std::size_t allocated_ = 0;
+};
+
+class Arena
+{
+public:
+    Arena() { grow(INITIAL_ARENA_SIZE); }
+
+    std::pmr::memory_resource *resource() { return &*monotonic_; }
+    std::size_t overflow() const { return upstream_.allocated(); }
+
+    void release()
+    {
+        std::size_t spilled = upstream_.allocated();
+        if (spilled > 0) {
+            grow(size_ + spilled);
+        } else {
+            monotonic_->release();
+        }
+    }
+
+private:
+    void grow(std::size_t size)
+    {
+        monotonic_.reset();
+        upstream_.reset();
+        buffer_ = std::make_unique<std::byte[]>(size);
+        size_ = size;
+        monotonic_.emplace(buffer_.get(), size_, &upstream_);
+    }
+
+    CountingResource upstream_;
+    std::unique_ptr<std::byte[]> buffer_;
+    std::size_t size_ = 0;
+    std::optional<std::pmr::monotonic_buffer_resource> monotonic_;
+};
+
+Arena &thread_arena()
+{
+    thread_local Arena arena;
+    return arena;
+}
+
+}//namespace
+
+std::pmr::memory_resource *ThreadArena::resource()
+{
+    return thread_arena().resource();
+}
+
+void ThreadArena::release()
+{
+    thread_arena().release();
+}
+
+std::size_t ThreadArena::overflow()
+{
+    return thread_arena().overflow();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+// Per-thread monotonic arena for batch jobs. Everything allocated from
+// resource() is dropped at once by release(); the backing buffer grows to the
+// high-water mark of previous batches, so steady-state batches never reach
+// the system allocator.
+class ThreadArena
+{
+public:
+    static std::pmr::memory_resource *resource();
+    static void release();
+
+    // bytes the current batch had to take from the system allocator
+    static std::size_t overflow();
+};
+
+// Releases the thread arena when leaving the scope
+class ArenaScope
+{
+public:
+    ArenaScope() = default;
+    ~ArenaScope() { ThreadArena::release(); }
+
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+
+    std::pmr::memory_resource *resource() const { return ThreadArena::resource(); }
+};
@@ -0,0 +1,399 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include "arc.h"
+#include "bezier.h"
+#include "polygon.h"
+#include "ray.h"
+#include "rectangle.h"
+
+namespace {
+
+// subdivision stops here even if a piece is not flat yet, 2^16 pieces
+const int MAX_DEPTH = 16;
+
+// control points of a part of the curve
+struct Piece
+{
+    double x[4] = {};
+    double y[4] = {};
+    std::size_t size;
+
+    explicit Piece(const std::vector<Point> &control) : size(control.size())
+    {
+        for (std::size_t i = 0; i < size; i++) {
+            x[i] = control[i].x();
+            y[i] = control[i].y();
+        }
+    }
+
+    Point first() const { return Point(x[0], y[0]); }
+    Point last() const { return Point(x[size - 1], y[size - 1]); }
+    Segment chord() const { return Segment(first(), last()); }
+
+    BoundingBox box() const
+    {
+        BoundingBox box;
+        for (std::size_t i = 0; i < size; i++) {
+            box.expand(Point(x[i], y[i]));
+        }
+        return box;
+    }
+
+    // farthest inner control point from the chord, bounds the curve's
+    // distance from it
+    double flatness() const
+    {
+        double dx = x[size - 1] - x[0];
+        double dy = y[size - 1] - y[0];
+        double length = hypot(dx, dy);
+        double result = 0;
+        for (std::size_t i = 1; i + 1 < size; i++) {
+            double offset = length > 0
+                ? fabs((x[i] - x[0]) * dy - (y[i] - y[0]) * dx) / length
+                : hypot(x[i] - x[0], y[i] - y[0]);
+            result = fmax(result, offset);
+        }
+        return result;
+    }
+
+    // de Casteljau at t = 1/2
+    void split(Piece &left, Piece &right) const
+    {
+        double px[4], py[4];
+        std::copy(x, x + size, px);
+        std::copy(y, y + size, py);
+        left.size = right.size = size;
+        for (std::size_t level = 0; level < size; level++) {
+            left.x[level] = px[0];
+            left.y[level] = py[0];
+            right.x[size - 1 - level] = px[size - 1 - level];
+            right.y[size - 1 - level] = py[size - 1 - level];
+            for (std::size_t i = 0; i + 1 < size - level; i++) {
+                px[i] = (px[i] + px[i + 1]) / 2;
+                py[i] = (py[i] + py[i + 1]) / 2;
+            }
+        }
+    }
+};
+
+// Calls flat(chord) for every piece flat within tolerance whose control box
+// passes keep(box), splitting the others in halves.
+template <typename Keep, typename Flat>
+void visit_pieces(const Piece &piece, double tolerance, Keep &&keep, Flat &&flat, int depth = 0)
+{
+    if (!keep(piece.box())) {
+        return;
+    }
+    if (depth == MAX_DEPTH || piece.flatness() <= tolerance) {
+        flat(piece.chord());
+        return;
+    }
+    Piece left = piece, right = piece;
+    piece.split(left, right);
+    visit_pieces(left, tolerance, keep, flat, depth + 1);
+    visit_pieces(right, tolerance, keep, flat, depth + 1);
+}
+
+// Pairs of flat pieces with overlapping control boxes, splitting the less
+// flat piece of a pair first.
+template <typename Flat>
+void visit_piece_pairs(const Piece &a, const Piece &b, Flat &&flat, int depth = 0)
+{
+    if (!a.box().intersects(b.box())) {
+        return;
+    }
+    double a_flatness = a.flatness();
+    double b_flatness = b.flatness();
+    if (depth == 2 * MAX_DEPTH || (a_flatness <= EPS && b_flatness <= EPS)) {
+        flat(a.chord(), b.chord());
+        return;
+    }
+    Piece left = a, right = a;
+    if (a_flatness >= b_flatness) {
+        a.split(left, right);
+        visit_piece_pairs(left, b, flat, depth + 1);
+        visit_piece_pairs(right, b, flat, depth + 1);
+    } else {
+        b.split(left, right);
+        visit_piece_pairs(a, left, flat, depth + 1);
+        visit_piece_pairs(a, right, flat, depth + 1);
+    }
+}
+
+// Intersections of the curve with a figure through the chords of its flat
+// pieces; a crossing at a joint of two pieces shows up in both.
+template <typename Keep, typename Other>
+Points intersect_pieces(const std::vector<Point> &control, const Other &other, Keep &&keep,
+                        std::pmr::memory_resource *resource)
+{
+    Points result(resource);
+    visit_pieces(Piece(control), EPS, keep, [&](const Segment &chord) {
+        Points points = chord.intersect(other, resource);
+        result.insert(result.end(), points.begin(), points.end());
+    });
+    merge_close_points(result);
+    return result;
+}
+
+}//namespace
+
+Bezier::Bezier(const Point &p0, const Point &p1, const Point &p2)
+    : control_{p0, p1, p2}
+{
+    compute_bbox();
+}
+
+Bezier::Bezier(const Point &p0, const Point &p1, const Point &p2, const Point &p3)
+    : control_{p0, p1, p2, p3}
+{
+    compute_bbox();
+}
+
+Bezier::Bezier(const std::vector<Point> &control)
+    : control_(control)
+{
+    if (control_.size() != 3 && control_.size() != 4) {
+        throw std::invalid_argument("bezier: expected 3 or 4 control points");
+    }
+    compute_bbox();
+}
+
+Bezier::Bezier(const Bezier &other)
+    : control_(other.control_),
+      bbox_(other.bbox_),
+      flattenings_(std::atomic_load(&other.flattenings_)) {}
+
+Bezier &Bezier::operator=(const Bezier &other)
+{
+    if (this != &other) {
+        control_ = other.control_;
+        bbox_ = other.bbox_;
+        flattenings_ = std::atomic_load(&other.flattenings_);
+    }
+    return *this;
+}
+
+void Bezier::compute_bbox()
+{
+    bbox_ = BoundingBox();
+    bbox_.expand(control_.front());
+    bbox_.expand(control_.back());
+
+    //the curve turns back on an axis where that coordinate's derivative,
+    //a t^2 + b t + c up to a constant factor, has a root in (0, 1)
+    auto expand_at_roots = [&](double p0, double p1, double p2, double p3) {
+        double a = degree() == 3 ? -p0 + 3 * p1 - 3 * p2 + p3 : 0;
+        double b = degree() == 3 ? 2 * (p0 - 2 * p1 + p2) : p0 - 2 * p1 + p2;
+        double c = p1 - p0;
+        double roots[2];
+        int count = 0;
+        if (fabs(a) < 1e-12) {
+            if (b != 0) {
+                roots[count++] = -c / b;
+            }
+        } else {
+            double discriminant = b * b - 4 * a * c;
+            if (discriminant >= 0) {
+                roots[count++] = (-b + sqrt(discriminant)) / (2 * a);
+                roots[count++] = (-b - sqrt(discriminant)) / (2 * a);
+            }
+        }
+        for (int i = 0; i < count; i++) {
+            if (roots[i] > 0 && roots[i] < 1) {
+                bbox_.expand(at(roots[i]));
+            }
+        }
+    };
+    const Point &p3 = control_.back();
+    expand_at_roots(control_[0].x(), control_[1].x(), control_[2].x(), p3.x());
+    expand_at_roots(control_[0].y(), control_[1].y(), control_[2].y(), p3.y());
+}
+
+Point Bezier::at(double t) const
+{
+    double x[4], y[4];
+    std::size_t size = control_.size();
+    for (std::size_t i = 0; i < size; i++) {
+        x[i] = control_[i].x();
+        y[i] = control_[i].y();
+    }
+    for (std::size_t level = 1; level < size; level++) {
+        for (std::size_t i = 0; i < size - level; i++) {
+            x[i] += t * (x[i + 1] - x[i]);
+            y[i] += t * (y[i + 1] - y[i]);
+        }
+    }
+    return Point(x[0], y[0]);
+}
+
+std::shared_ptr<const Polyline> Bezier::flattened(double tolerance) const
+{
+    //nearby tolerances share one entry; rounding down keeps the promise
+    if (tolerance > 0 && std::isfinite(tolerance)) {
+        int exponent;
+        frexp(tolerance, &exponent);
+        tolerance = ldexp(0.5, exponent);
+    }
+
+    auto find = [&](const Flattenings *flattenings) -> std::shared_ptr<const Polyline> {
+        if (flattenings) {
+            for (const auto &entry : *flattenings) {
+                if (entry.second && entry.first == tolerance) {
+                    return entry.second;
+                }
+            }
+        }
+        return nullptr;
+    };
+
+    auto cached = std::atomic_load(&flattenings_);
+    if (auto polyline = find(cached.get())) {
+        return polyline;
+    }
+
+    std::vector<Point> points{control_.front()};
+    visit_pieces(Piece(control_), tolerance, [](const BoundingBox &) { return true; },
+                 [&](const Segment &chord) { points.push_back(chord.end()); });
+    auto built = std::make_shared<const Polyline>(points);
+
+    //publish the new entry in front, dropping the oldest, unless another
+    //thread got there first
+    while (true) {
+        auto extended = std::make_shared<Flattenings>();
+        (*extended)[0] = {tolerance, built};
+        if (cached) {
+            std::copy(cached->begin(), cached->end() - 1, extended->begin() + 1);
+        }
+        std::shared_ptr<const Flattenings> desired = extended;
+        if (std::atomic_compare_exchange_strong(&flattenings_, &cached, desired)) {
+            return built;
+        }
+        if (auto polyline = find(cached.get())) {
+            return polyline;
+        }
+    }
+}
+
+double Bezier::length() const
+{
+    return flattened(EPS)->length();
+}
+
+Points Bezier::intersect(const Figure &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Bezier::intersect(const Segment &other, std::pmr::memory_resource *resource) const
+{
+    return intersect_pieces(control_, other, [&](const BoundingBox &box) {
+        return box.intersects(other.start(), other.end());
+    }, resource);
+}
+
+Points Bezier::intersect(const Circle &other, std::pmr::memory_resource *resource) const
+{
+    return intersect_pieces(control_, other, [&](const BoundingBox &box) {
+        return box.meets_circle(other.center(), other.radius());
+    }, resource);
+}
+
+Points Bezier::intersect(const Polyline &other, std::pmr::memory_resource *resource) const
+{
+    BoundingBox other_box = other.bbox();
+    return intersect_pieces(control_, other, [&](const BoundingBox &box) {
+        return box.intersects(other_box);
+    }, resource);
+}
+
+Points Bezier::intersect(const Polygon &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Bezier::intersect(const Rectangle &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Bezier::intersect(const Arc &other, std::pmr::memory_resource *resource) const
+{
+    BoundingBox other_box = other.bbox();
+    return intersect_pieces(control_, other, [&](const BoundingBox &box) {
+        return box.intersects(other_box) && box.meets_circle(other.center(), other.radius());
+    }, resource);
+}
+
+Points Bezier::intersect(const Bezier &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    if (!bbox_.intersects(other.bbox_)) {
+        return result;
+    }
+    visit_piece_pairs(Piece(control_), Piece(other.control_), [&](const Segment &a, const Segment &b) {
+        Points points = a.intersect(b, resource);
+        result.insert(result.end(), points.begin(), points.end());
+    });
+    merge_close_points(result);
+    return result;
+}
+
+double Bezier::distance(const Point &point) const
+{
+    return flattened(EPS)->distance(point);
+}
+
+double Bezier::distance(const Figure &other) const
+{
+    return other.distance(*this);
+}
+
+double Bezier::distance(const Segment &other) const
+{
+    return flattened(EPS)->distance(other);
+}
+
+double Bezier::distance(const Circle &other) const
+{
+    return flattened(EPS)->distance(other);
+}
+
+double Bezier::distance(const Polyline &other) const
+{
+    return flattened(EPS)->distance(other);
+}
+
+double Bezier::distance(const Polygon &other) const
+{
+    return other.distance(*this);
+}
+
+double Bezier::distance(const Rectangle &other) const
+{
+    return other.distance(*this);
+}
+
+double Bezier::distance(const Arc &other) const
+{
+    return other.distance(*flattened(EPS));
+}
+
+double Bezier::distance(const Bezier &other) const
+{
+    return flattened(EPS)->distance(*other.flattened(EPS));
+}
+
+double Bezier::first_hit(const Ray &ray) const
+{
+    if (ray.enter(bbox_, ray.max_distance()) == HUGE_VAL) {
+        return HUGE_VAL;
+    }
+    return flattened(EPS)->first_hit(ray);
+}
+
+Distances Bezier::hits(const Ray &ray) const
+{
+    return flattened(EPS)->hits(ray);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "figures.h"
+
+// Quadratic or cubic Bézier curve given by its 3 or 4 control points.
+//
+// Intersections subdivide the curve at t = 1/2 and drop every piece whose
+// control polygon box, which holds the piece, misses the other figure. A
+// piece flat within EPS stands for its chord and goes through the Segment
+// kernels. Distances, ray hits and length() run on the curve flattened to
+// EPS.
+//
+// flattened() subdivides adaptively on the control polygon's distance from
+// the chord, so flat stretches come out as single segments. Tolerances are
+// rounded down to a power of two and the last FLATTENING_SLOTS of them are
+// kept; copies share the cache.
+class Bezier : public Figure
+{
+public:
+    Bezier(const Point &p0, const Point &p1, const Point &p2);
+    Bezier(const Point &p0, const Point &p1, const Point &p2, const Point &p3);
+    // throws std::invalid_argument unless given 3 or 4 points
+    explicit Bezier(const std::vector<Point> &control);
+
+    Bezier(const Bezier &other);
+    Bezier(Bezier &&other) noexcept = default;
+    Bezier &operator=(const Bezier &other);
+    Bezier &operator=(Bezier &&other) noexcept = default;
+
+    // 2 or 3
+    std::size_t degree() const { return control_.size() - 1; }
+    const std::vector<Point> &control() const { return control_; }
+    // de Casteljau, t in [0, 1]
+    Point at(double t) const;
+
+    static constexpr std::size_t FLATTENING_SLOTS = 4;
+
+    // polyline through points of the curve that stays within tolerance of
+    // it; shared, since the cache may drop it for a newer tolerance
+    std::shared_ptr<const Polyline> flattened(double tolerance) const;
+
+    double length() const override;
+    BoundingBox bbox() const override { return bbox_; }
+
+    using Figure::intersect;
+    Points intersect(const Figure &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Segment &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Circle &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Polyline &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Polygon &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Rectangle &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Arc &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Bezier &other, std::pmr::memory_resource *resource) const override;
+
+    double distance(const Point &point) const override;
+    double distance(const Figure &other) const override;
+    double distance(const Segment &other) const override;
+    double distance(const Circle &other) const override;
+    double distance(const Polyline &other) const override;
+    double distance(const Polygon &other) const override;
+    double distance(const Rectangle &other) const override;
+    double distance(const Arc &other) const override;
+    double distance(const Bezier &other) const override;
+
+    double first_hit(const Ray &ray) const override;
+    Distances hits(const Ray &ray) const override;
+
+private:
+    // newest first, empty slots at the end
+    using Flattenings = std::array<std::pair<double, std::shared_ptr<const Polyline>>, FLATTENING_SLOTS>;
+
+    void compute_bbox();
+
+    std::vector<Point> control_;
+    BoundingBox bbox_;
+    // replaced as a whole when a tolerance is added
+    mutable std::shared_ptr<const Flattenings> flattenings_;
+};
@@ -0,0 +1,204 @@
+#include <cmath>
+#include <stdexcept>
+#include "arc.h"
+#include "bezier.h"
+#include "collision.h"
+#include "polygon.h"
+#include "ray.h"
+#include "rectangle.h"
+#include "transform.h"
+
+namespace {
+
+double step_length(const SweptCircle &swept)
+{
+    return hypot(swept.dx, swept.dy);
+}
+
+// the center's path over the step
+Ray center_path(const SweptCircle &swept)
+{
+    return Ray(swept.circle.center(), swept.dx, swept.dy, step_length(swept));
+}
+
+// time for a distance along the center's path, HUGE_VAL stays
+double to_time(const SweptCircle &swept, double distance)
+{
+    return distance == HUGE_VAL ? HUGE_VAL : distance / step_length(swept);
+}
+
+double segment_contact(const SweptCircle &swept, const Ray &path, const Point &a, const Point &b)
+{
+    double radius = swept.circle.radius();
+    if (swept.circle.distance(Segment(a, b)) <= EPS) {
+        return 0;
+    }
+    if (step_length(swept) == 0) {
+        return HUGE_VAL;
+    }
+
+    double distance = fmin(Circle(a.x(), a.y(), radius).first_hit(path),
+                           Circle(b.x(), b.y(), radius).first_hit(path));
+    double length = a.distance(b);
+    if (length > 0) {
+        double nx = -(b.y() - a.y()) / length * radius;
+        double ny = (b.x() - a.x()) / length * radius;
+        for (double side : {1.0, -1.0}) {
+            Segment offset(a.x() + side * nx, a.y() + side * ny, b.x() + side * nx, b.y() + side * ny);
+            distance = fmin(distance, offset.first_hit(path));
+        }
+    }
+    return to_time(swept, distance);
+}
+
+double arc_contact(const SweptCircle &swept, const Arc &target)
+{
+    if (target.distance(swept.circle) <= EPS) {
+        return 0;
+    }
+    if (step_length(swept) == 0) {
+        return HUGE_VAL;
+    }
+
+    Ray path = center_path(swept);
+    double radius = swept.circle.radius();
+    double start = target.start_angle();
+    double end = start + target.sweep();
+    double distance = fmin(Circle(target.start().x(), target.start().y(), radius).first_hit(path),
+                           Circle(target.end().x(), target.end().y(), radius).first_hit(path));
+    distance = fmin(distance, Arc(target.center().x(), target.center().y(), target.radius() + radius,
+                                  start, end).first_hit(path));
+    //past the center the inner offset lies on the opposite side
+    double inner = target.radius() - radius;
+    if (inner > 0) {
+        distance = fmin(distance, Arc(target.center().x(), target.center().y(), inner, start, end).first_hit(path));
+    } else if (inner < 0) {
+        distance = fmin(distance, Arc(target.center().x(), target.center().y(), -inner,
+                                      start + M_PI, end + M_PI).first_hit(path));
+    }
+    return to_time(swept, distance);
+}
+
+// Under a similarity the circle stays a circle, so the sweep is mapped into
+// the shape's space; a point moving linearly keeps its times under any
+// affine map. Other matrices go through the world-space copy.
+double transformed_contact(const SweptCircle &swept, const Transformed &target)
+{
+    double scale = target.matrix().similarity_scale();
+    if (scale == 0) {
+        return time_of_contact(swept, *target.world());
+    }
+    Point center = target.inverse()(swept.circle.center());
+    Point step = target.inverse().linear(swept.dx, swept.dy);
+    SweptCircle local{Circle(center.x(), center.y(), swept.circle.radius() / scale), step.x(), step.y()};
+    return time_of_contact(local, target.shape());
+}
+
+}//namespace
+
+Circle SweptCircle::at(double t) const
+{
+    return Circle(circle.center().x() + t * dx, circle.center().y() + t * dy, circle.radius());
+}
+
+BoundingBox SweptCircle::bbox() const
+{
+    BoundingBox box = circle.bbox();
+    box.expand(at(1).bbox());
+    return box;
+}
+
+double time_of_contact(const SweptCircle &swept, const Segment &target)
+{
+    return segment_contact(swept, center_path(swept), target.start(), target.end());
+}
+
+double time_of_contact(const SweptCircle &swept, const Circle &target)
+{
+    if (swept.circle.distance(target) <= EPS) {
+        return 0;
+    }
+    if (step_length(swept) == 0) {
+        return HUGE_VAL;
+    }
+
+    Ray path = center_path(swept);
+    const Point &center = target.center();
+    double outer = target.radius() + swept.circle.radius();
+    double inner = fabs(target.radius() - swept.circle.radius());
+    double distance = Circle(center.x(), center.y(), outer).first_hit(path);
+    if (inner > 0) {
+        distance = fmin(distance, Circle(center.x(), center.y(), inner).first_hit(path));
+    }
+    return to_time(swept, distance);
+}
+
+double time_of_contact(const SweptCircle &swept, const Polyline &target)
+{
+    BoundingBox swept_box = swept.bbox();
+    if (target.size() == 0 || !swept_box.intersects(target.bbox())) {
+        return HUGE_VAL;
+    }
+    Ray path = center_path(swept);
+    if (target.size() == 1) {
+        return segment_contact(swept, path, target[0], target[0]);
+    }
+
+    //chain boxes are spanned by their end vertices
+    double result = HUGE_VAL;
+    auto visit = [&](std::size_t first, std::size_t last, auto &self) -> void {
+        BoundingBox box;
+        box.expand(target[first]);
+        box.expand(target[last]);
+        if (result == 0 || !swept_box.intersects(box)) {
+            return;
+        }
+        if (last - first == 1) {
+            result = fmin(result, segment_contact(swept, path, target[first], target[last]));
+            return;
+        }
+        std::size_t middle = (first + last) / 2;
+        self(first, middle, self);
+        self(middle, last, self);
+    };
+    for (const auto &chain : target.chains()) {
+        visit(chain.first, chain.last, visit);
+    }
+    return result;
+}
+
+double time_of_contact(const SweptCircle &swept, const Figure &target)
+{
+    if (auto segment = dynamic_cast<const Segment *>(&target)) {
+        return time_of_contact(swept, *segment);
+    }
+    if (auto circle = dynamic_cast<const Circle *>(&target)) {
+        return time_of_contact(swept, *circle);
+    }
+    if (auto polyline = dynamic_cast<const Polyline *>(&target)) {
+        return time_of_contact(swept, *polyline);
+    }
+    if (auto polygon = dynamic_cast<const Polygon *>(&target)) {
+        double result = HUGE_VAL;
+        for (const auto &ring : polygon->rings()) {
+            result = fmin(result, time_of_contact(swept, ring));
+        }
+        return result;
+    }
+    if (auto rectangle = dynamic_cast<const Rectangle *>(&target)) {
+        const BoundingBox &box = rectangle->box();
+        return time_of_contact(swept, Polyline(std::vector<Point>{
+            {box.min_x(), box.min_y()}, {box.max_x(), box.min_y()}, {box.max_x(), box.max_y()},
+            {box.min_x(), box.max_y()}, {box.min_x(), box.min_y()}}));
+    }
+    if (auto arc = dynamic_cast<const Arc *>(&target)) {
+        return arc_contact(swept, *arc);
+    }
+    if (auto bezier = dynamic_cast<const Bezier *>(&target)) {
+        return time_of_contact(swept, *bezier->flattened(EPS));
+    }
+    if (auto transformed = dynamic_cast<const Transformed *>(&target)) {
+        return transformed_contact(swept, *transformed);
+    }
+    throw std::invalid_argument("contact: unsupported figure type");
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include "figures.h"
+
+// Circle moving by (dx, dy) over one step: its center runs from
+// circle.center() to circle.center() + (dx, dy) as t goes from 0 to 1
+struct SweptCircle
+{
+    Circle circle;
+    double dx;
+    double dy;
+
+    Circle at(double t) const;
+    // covers the circle over the whole step
+    BoundingBox bbox() const;
+};
+
+struct Contact
+{
+    std::size_t id;
+    double time;
+};
+
+// Earliest t in [0, 1] at which the moving circle touches the figure, 0 when
+// they touch already and HUGE_VAL when they stay apart over the step. As for
+// intersect, figures are their curves: a segment inside the circle is
+// touched once an end reaches the circle line.
+//
+// Every contact puts the center at distance radius from the target, so
+// the center's path is cast as a Ray against the target grown by the
+// radius: circles of radius r + R and |r - R|, lines offset to both sides
+// of each segment plus circles around its ends, arcs likewise.
+double time_of_contact(const SweptCircle &swept, const Segment &target);
+double time_of_contact(const SweptCircle &swept, const Circle &target);
+// walks the monotone chains that meet the swept box
+double time_of_contact(const SweptCircle &swept, const Polyline &target);
+// Dispatches on the type: polygons and rectangles count as their boundary,
+// arcs are exact, Bézier curves go through their EPS flattening and
+// transformed figures map the sweep into their shape's space (similarities)
+// or use their world-space copy. Throws std::invalid_argument for other
+// types.
+double time_of_contact(const SweptCircle &swept, const Figure &target);
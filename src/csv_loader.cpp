@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "csv_loader.h"
+#include "mapped_file.h"
+
+namespace {
+
+struct Fragment
+{
+    std::uint64_t polyline_id;
+    std::vector<Point> points;
+};
+
+struct Row
+{
+    Scene::Kind kind;
+    std::size_t index;
+};
+
+// fragments of one polyline id in file order, joined into one polyline
+struct Assembly
+{
+    std::vector<const Fragment *> fragments;
+    std::size_t size = 0;
+    std::optional<Polyline> polyline;
+};
+
+// figures parsed from one chunk, fragments are runs of vertex rows
+struct Chunk
+{
+    std::vector<Segment> segments;
+    std::vector<Circle> circles;
+    std::vector<Fragment> fragments;
+    std::vector<Row> rows;
+    std::string error;
+};
+
+class LineParser
+{
+public:
+    LineParser(const char *begin, const char *end, char delimiter, const char *file_start)
+        : pos_(begin), end_(end), delimiter_(delimiter), file_start_(file_start) {}
+
+    bool at_end() const { return pos_ == end_; }
+
+    bool field_is(const char *name)
+    {
+        std::size_t length = std::strlen(name);
+        if (static_cast<std::size_t>(end_ - pos_) >= length && std::memcmp(pos_, name, length) == 0
+                && (pos_ + length == end_ || pos_[length] == delimiter_)) {
+            pos_ += length;
+            return true;
+        }
+        return false;
+    }
+
+    template <typename Number>
+    Number number()
+    {
+        if (pos_ == end_ || *pos_ != delimiter_) {
+            fail("missing field");
+        }
+        pos_++;
+        while (pos_ != end_ && *pos_ == ' ') {
+            pos_++;
+        }
+        Number value{};
+        auto parsed = std::from_chars(pos_, end_, value);
+        if (parsed.ec != std::errc()) {
+            fail("bad number");
+        }
+        pos_ = parsed.ptr;
+        while (pos_ != end_ && *pos_ == ' ') {
+            pos_++;
+        }
+        return value;
+    }
+
+    void finish()
+    {
+        if (pos_ != end_) {
+            fail("extra fields");
+        }
+    }
+
+    [[noreturn]] void fail(const char *what) const
+    {
+        throw std::runtime_error(std::string("csv: ") + what + " at byte " + std::to_string(pos_ - file_start_));
+    }
+
+private:
+    const char *pos_;
+    const char *end_;
+    char delimiter_;
+    const char *file_start_;
+};
+
+const char *line_end(const char *begin, const char *end)
+{
+    auto newline = static_cast<const char *>(std::memchr(begin, '\n', end - begin));
+    return newline != nullptr ? newline : end;
+}
+
+// A first line is a header when it names no figure and holds no number,
+// e.g. "kind,x,y,..."; any other unknown row is an error.
+bool is_header(const char *line, const char *end, char delimiter)
+{
+    for (const char *field = line; field <= end;) {
+        const char *stop = std::find(field, end, delimiter);
+        const char *start = field;
+        while (start != stop && *start == ' ') {
+            start++;
+        }
+        double value;
+        if (start != stop && std::from_chars(start, stop, value).ec == std::errc()) {
+            return false;
+        }
+        field = stop + 1;
+    }
+    return true;
+}
+
+// runs work(i) for i in [0, count) split between threads
+template <typename Work>
+void parallel_for(std::size_t count, unsigned threads, Work work)
+{
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            for (std::size_t i = count * t / threads; i < count * (t + 1) / threads; i++) {
+                work(i);
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void parse_chunk(const char *begin, const char *end, char delimiter, bool may_have_header,
+                 const char *file_start, Chunk &chunk)
+{
+    bool first_line = true;
+    for (const char *line = begin; line < end;) {
+        const char *next = line_end(line, end);
+        const char *stop = next;
+        if (stop > line && stop[-1] == '\r') {
+            stop--;
+        }
+
+        LineParser parser(line, stop, delimiter, file_start);
+        if (parser.at_end() || *line == '#') {
+            // skip
+        } else if (parser.field_is("segment")) {
+            double x1 = parser.number<double>();
+            double y1 = parser.number<double>();
+            double x2 = parser.number<double>();
+            double y2 = parser.number<double>();
+            parser.finish();
+            chunk.rows.push_back({Scene::Kind::SEGMENT, chunk.segments.size()});
+            chunk.segments.emplace_back(x1, y1, x2, y2);
+        } else if (parser.field_is("circle")) {
+            double x = parser.number<double>();
+            double y = parser.number<double>();
+            double radius = parser.number<double>();
+            parser.finish();
+            chunk.rows.push_back({Scene::Kind::CIRCLE, chunk.circles.size()});
+            chunk.circles.emplace_back(x, y, radius);
+        } else if (parser.field_is("vertex")) {
+            auto id = parser.number<std::uint64_t>();
+            double x = parser.number<double>();
+            double y = parser.number<double>();
+            parser.finish();
+            bool continues = !chunk.rows.empty() && chunk.rows.back().kind == Scene::Kind::POLYLINE
+                    && chunk.fragments.back().polyline_id == id;
+            if (!continues) {
+                chunk.rows.push_back({Scene::Kind::POLYLINE, chunk.fragments.size()});
+                chunk.fragments.push_back({id, {}});
+            }
+            chunk.fragments.back().points.emplace_back(x, y);
+        } else if (!(first_line && may_have_header && is_header(line, stop, delimiter))) {
+            parser.fail("unknown figure");
+        }
+
+        first_line = false;
+        line = next + 1;
+    }
+}
+
+}//namespace
+
+Scene load_csv(const std::string &path, const CsvOptions &options)
+{
+    MappedFile file(path);
+    if (file.size() == 0) {
+        return Scene();
+    }
+    const char *begin = file.data();
+    const char *end = begin + file.size();
+    const char *first_end = line_end(begin, end);
+
+    char delimiter = options.delimiter;
+    if (delimiter == 0) {
+        delimiter = std::memchr(begin, '\t', first_end - begin) != nullptr ? '\t' : ',';
+    }
+
+    unsigned threads = options.threads > 0 ? options.threads : std::thread::hardware_concurrency();
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    // chunk boundaries are moved forward to the next line start and never
+    // before the second line, so the first chunk always holds the header
+    std::vector<const char *> bounds;
+    bounds.push_back(begin);
+    for (unsigned i = 1; i < threads; i++) {
+        const char *bound = begin + file.size() / threads * i;
+        bound = std::max({bound, bounds.back(), std::min(first_end + 1, end)});
+        if (bound > begin && bound < end && bound[-1] != '\n') {
+            bound = line_end(bound, end) + 1;
+        }
+        bounds.push_back(std::min(bound, end));
+    }
+    bounds.push_back(end);
+
+    std::vector<Chunk> chunks(threads);
+    parallel_for(threads, threads, [&](std::size_t i) {
+        try {
+            parse_chunk(bounds[i], bounds[i + 1], delimiter, i == 0, begin, chunks[i]);
+        } catch (const std::exception &e) {
+            chunks[i].error = e.what();
+        }
+    });
+    for (const auto &chunk : chunks) {
+        if (!chunk.error.empty()) {
+            throw std::runtime_error(chunk.error);
+        }
+    }
+
+    // Vertex runs of one polyline may be split between chunks. They are
+    // grouped by id here without copying, joined in parallel and the
+    // polylines then moved into the scene, which is the only serial copy
+    // of a row.
+    std::unordered_map<std::uint64_t, std::size_t> assembly_of;
+    std::vector<Assembly> assemblies;
+    std::vector<std::vector<std::size_t>> fragment_assembly(threads);
+    for (unsigned i = 0; i < threads; i++) {
+        for (const auto &fragment : chunks[i].fragments) {
+            auto found = assembly_of.try_emplace(fragment.polyline_id, assemblies.size());
+            if (found.second) {
+                assemblies.emplace_back();
+            }
+            Assembly &assembly = assemblies[found.first->second];
+            assembly.fragments.push_back(&fragment);
+            assembly.size += fragment.points.size();
+            // only the first fragment of a polyline places it
+            fragment_assembly[i].push_back(found.second ? found.first->second : assemblies.size());
+        }
+    }
+    parallel_for(assemblies.size(), threads, [&](std::size_t i) {
+        std::pmr::vector<Point> points;
+        points.reserve(assemblies[i].size);
+        for (const Fragment *fragment : assemblies[i].fragments) {
+            points.insert(points.end(), fragment->points.begin(), fragment->points.end());
+        }
+        assemblies[i].polyline.emplace(std::move(points));
+    });
+
+    Scene scene;
+    for (unsigned i = 0; i < threads; i++) {
+        const Chunk &chunk = chunks[i];
+        for (const auto &row : chunk.rows) {
+            switch (row.kind) {
+            case Scene::Kind::SEGMENT:
+                scene.add(chunk.segments[row.index]);
+                break;
+            case Scene::Kind::CIRCLE:
+                scene.add(chunk.circles[row.index]);
+                break;
+            default: {
+                std::size_t assembly = fragment_assembly[i][row.index];
+                if (assembly < assemblies.size()) {
+                    scene.add(std::move(*assemblies[assembly].polyline));
+                }
+                break;
+            }
+            }
+        }
+    }
+    return scene;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include "scene.h"
+
+// Bulk loader for CSV/TSV figure feeds, one figure or vertex per row:
+//   segment,x1,y1,x2,y2
+//   circle,x,y,radius
+//   vertex,polyline_id,x,y
+// Vertices of a polyline are joined in file order and the polyline takes
+// the place of its first vertex. Empty lines and '#' comments are skipped,
+// as is a first line naming no figure and holding no number (a header).
+// Any other unknown row is an error.
+struct CsvOptions
+{
+    // 0 detects ',' or '\t' from the first line
+    char delimiter = 0;
+    // 0 uses std::thread::hardware_concurrency()
+    unsigned threads = 0;
+};
+
+// Maps the file, splits it at line boundaries into one chunk per thread and
+// parses the chunks in parallel; polylines are joined in parallel too.
+// Throws std::runtime_error on malformed rows.
+Scene load_csv(const std::string &path, const CsvOptions &options = CsvOptions());
@@ -1,7 +1,16 @@
 #include <cmath>
 #include <vector>
 #include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 #include "figures.h"
+#include "polygon.h"
+#include "rectangle.h"
+#include "arc.h"
+#include "bezier.h"
+#include "ray.h"
 
 //Figure
 //const double Figure::EPS = 0.00001;
@@ -35,21 +44,154 @@ bool Point::operator==(const Point &rhs) const
     return fabs(this->x() - rhs.x()) < EPS && fabs(this->y() - rhs.y()) < EPS;
 }
 
-//Segment
-double Segment::length() const
+//BoundingBox
+bool BoundingBox::intersects(const BoundingBox &other) const
 {
-    return start_.distance(end_);
+    return min_x_ <= other.max_x_ + EPS && other.min_x_ <= max_x_ + EPS
+        && min_y_ <= other.max_y_ + EPS && other.min_y_ <= max_y_ + EPS;
 }
 
-std::vector<Point> Segment::intersect(const Segment &other) const
+bool BoundingBox::contains(const Point &point) const
 {
-    //http://algolist.ru/maths/geom/intersect/lineline2d.php
-    std::vector<Point> result;
+    return min_x_ - EPS <= point.x() && point.x() <= max_x_ + EPS
+        && min_y_ - EPS <= point.y() && point.y() <= max_y_ + EPS;
+}
+
+double BoundingBox::distance(const Point &point) const
+{
+    double dx = fmax(fmax(min_x_ - point.x(), point.x() - max_x_), 0);
+    double dy = fmax(fmax(min_y_ - point.y(), point.y() - max_y_), 0);
+    return sqrt(dx * dx + dy * dy);
+}
 
-    double x1 = start().x();       double y1 = start().y();
-    double x2 = end().x();         double y2 = end().y();
-    double x3 = other.start().x(); double y3 = other.start().y();
-    double x4 = other.end().x();   double y4 = other.end().y();
+bool BoundingBox::clip(const Point &a, const Point &b, double &t0, double &t1, double padding) const
+{
+    double dx = b.x() - a.x();
+    double dy = b.y() - a.y();
+    //distance to each side along the segment, p < 0 enters, p > 0 leaves
+    const double p[] = {-dx, dx, -dy, dy};
+    const double q[] = {a.x() - (min_x_ - padding), (max_x_ + padding) - a.x(),
+                        a.y() - (min_y_ - padding), (max_y_ + padding) - a.y()};
+    t0 = 0;
+    t1 = 1;
+    for (int i = 0; i < 4; i++) {
+        if (p[i] == 0) {
+            if (q[i] < 0) {
+                return false;
+            }
+            continue;
+        }
+        double t = q[i] / p[i];
+        if (p[i] < 0) {
+            t0 = fmax(t0, t);
+        } else {
+            t1 = fmin(t1, t);
+        }
+    }
+    return t0 <= t1;
+}
+
+bool BoundingBox::meets_circle(const Point &center, double radius) const
+{
+    double far_x = fmax(center.x() - min_x_, max_x_ - center.x());
+    double far_y = fmax(center.y() - min_y_, max_y_ - center.y());
+    return distance(center) <= radius + EPS && far_x * far_x + far_y * far_y >= pow(fmax(radius - EPS, 0), 2);
+}
+
+void BoundingBox::expand(const Point &point)
+{
+    min_x_ = fmin(min_x_, point.x());
+    min_y_ = fmin(min_y_, point.y());
+    max_x_ = fmax(max_x_, point.x());
+    max_y_ = fmax(max_y_, point.y());
+}
+
+void BoundingBox::expand(const BoundingBox &other)
+{
+    min_x_ = fmin(min_x_, other.min_x_);
+    min_y_ = fmin(min_y_, other.min_y_);
+    max_x_ = fmax(max_x_, other.max_x_);
+    max_y_ = fmax(max_y_, other.max_y_);
+}
+
+//merge_close_points
+void merge_close_points(Points &points, double tolerance)
+{
+    //pairwise below this size
+    const std::size_t SMALL = 16;
+
+    std::size_t kept = 0;
+    auto close = [&](const Point &a, const Point &b) {
+        return fabs(a.x() - b.x()) < tolerance && fabs(a.y() - b.y()) < tolerance;
+    };
+
+    if (points.size() <= SMALL) {
+        for (std::size_t i = 0; i < points.size(); i++) {
+            bool merged = false;
+            for (std::size_t j = 0; j < kept && !merged; j++) {
+                merged = close(points[i], points[j]);
+            }
+            if (!merged) {
+                points[kept++] = points[i];
+            }
+        }
+        points.erase(points.begin() + kept, points.end());
+        return;
+    }
+
+    // two kept points never share a cell, so a cell maps to at most one
+    struct Slot
+    {
+        std::int64_t x, y;
+        std::size_t index;
+    };
+    const std::size_t EMPTY = static_cast<std::size_t>(-1);
+    std::size_t capacity = 1;
+    while (capacity < 2 * points.size()) {
+        capacity *= 2;
+    }
+    std::pmr::vector<Slot> table(capacity, Slot{0, 0, EMPTY}, points.get_allocator().resource());
+
+    auto slot = [&](std::int64_t x, std::int64_t y) -> Slot & {
+        std::uint64_t hash = static_cast<std::uint64_t>(x) * 0x9E3779B97F4A7C15ull
+                           ^ static_cast<std::uint64_t>(y) * 0xC2B2AE3D27D4EB4Full;
+        std::size_t i = static_cast<std::size_t>(hash ^ (hash >> 29)) & (capacity - 1);
+        while (table[i].index != EMPTY && (table[i].x != x || table[i].y != y)) {
+            i = (i + 1) & (capacity - 1);
+        }
+        return table[i];
+    };
+
+    for (std::size_t i = 0; i < points.size(); i++) {
+        auto x = static_cast<std::int64_t>(floor(points[i].x() / tolerance));
+        auto y = static_cast<std::int64_t>(floor(points[i].y() / tolerance));
+
+        bool merged = false;
+        for (std::int64_t dx = -1; dx <= 1 && !merged; dx++) {
+            for (std::int64_t dy = -1; dy <= 1 && !merged; dy++) {
+                const Slot &neighbor = slot(x + dx, y + dy);
+                merged = neighbor.index != EMPTY && close(points[i], points[neighbor.index]);
+            }
+        }
+        if (!merged) {
+            points[kept] = points[i];
+            slot(x, y) = Slot{x, y, kept};
+            kept++;
+        }
+    }
+    points.erase(points.begin() + kept, points.end());
+}
+
+//Segment
+namespace {
+
+void append_segment_intersection(const Segment &first, const Segment &second, Points &result)
+{
+    //http://algolist.ru/maths/geom/intersect/lineline2d.php
+    double x1 = first.start().x();  double y1 = first.start().y();
+    double x2 = first.end().x();    double y2 = first.end().y();
+    double x3 = second.start().x(); double y3 = second.start().y();
+    double x4 = second.end().x();   double y4 = second.end().y();
 
     double d = (y4 - y3) * (x2 - x1) - (x4 - x3) * (y2 - y1);
 
@@ -61,16 +203,13 @@ std::vector<Point> Segment::intersect(const Segment &other) const
         double intersect_y = y1 + u_a * (y2 - y1);
         result.emplace_back(intersect_x, intersect_y);
     }
-
-    return result;
 }
 
-std::vector<Point> Segment::intersect(const Circle &other) const
+void append_circle_intersection(const Segment &segment, const Circle &circle, Points &result)
 {
     //http://e-maxx.ru/algo/circle_line_intersection
-    std::vector<Point> intersection_points;
-    Point start_f(start().x() - other.center().x(), start().y() - other.center().y());
-    Point end_f(end().x() - other.center().x(), end().y() - other.center().y());
+    Point start_f(segment.start().x() - circle.center().x(), segment.start().y() - circle.center().y());
+    Point end_f(segment.end().x() - circle.center().x(), segment.end().y() - circle.center().y());
 
     double A = start_f.y() - end_f.y();
     double B = end_f.x() - start_f.x();
@@ -79,56 +218,504 @@ std::vector<Point> Segment::intersect(const Circle &other) const
     double x0 = -(A * C) / (A * A + B * B);
     double y0 = -(B * C) / (A * A + B * B);
 
-    double  r = other.radius();
+    double  r = circle.radius();
 
-    Point intersection_point(x0, y0);
+    //only points inside the segment box are kept
+    auto append_in_box = [&](double x, double y) {
+        Point point(x, y);
+        if (point.is_in_box(segment.start(), segment.end())) {
+            result.push_back(point);
+        }
+    };
 
-    if (fabs( C * C - r * r * (A * A + B * B)) < EPS) {
-        intersection_points.emplace_back(x0 + other.center().x(),
-                            y0 + other.center().y());
+    //compare the line's distance from the center, not its square scaled by
+    //the segment length, so short segments are not all taken for tangents
+    double line_distance = fabs(C) / sqrt(A * A + B * B);
+    if (fabs(line_distance - r) < EPS) {
+        append_in_box(x0 + circle.center().x(), y0 + circle.center().y());
 
-    } else if (C * C < r * r * (A * A + B * B) + EPS) {
+    } else if (line_distance < r) {
         double d = r * r - C * C / (A * A + B * B);
         double mult = sqrt(d / (A * A + B * B));
 
-        double ax = x0 + B * mult + other.center().x();
-        double bx = x0 - B * mult + other.center().x();
+        double ax = x0 + B * mult + circle.center().x();
+        double bx = x0 - B * mult + circle.center().x();
 
-        double ay = y0 - A * mult + other.center().y();
-        double by = y0 + A * mult + other.center().y();
+        double ay = y0 - A * mult + circle.center().y();
+        double by = y0 + A * mult + circle.center().y();
 
-        intersection_points.emplace_back(ax, ay);
-        intersection_points.emplace_back(bx, by);
+        append_in_box(ax, ay);
+        append_in_box(bx, by);
     }
+}
 
-    std::vector<Point> result;
-    //TODO: fix
-    //ASK: better way?
-    for(const auto &point : intersection_points) {
-        if (point.is_in_box(start(), end())) {
-            result.push_back(point);
-        }
+
+
+double point_segment_distance(const Point &point, const Point &start, const Point &end)
+{
+    double dx = end.x() - start.x();
+    double dy = end.y() - start.y();
+    double length_2 = dx * dx + dy * dy;
+    if (length_2 == 0) {
+        return point.distance(start);
+    }
+    double t = ((point.x() - start.x()) * dx + (point.y() - start.y()) * dy) / length_2;
+    t = fmax(0, fmin(1, t));
+    return point.distance(Point(start.x() + t * dx, start.y() + t * dy));
+}
+
+double cross(const Point &origin, const Point &a, const Point &b)
+{
+    return (a.x() - origin.x()) * (b.y() - origin.y()) - (a.y() - origin.y()) * (b.x() - origin.x());
+}
+
+double segments_distance(const Point &a1, const Point &a2, const Point &b1, const Point &b2)
+{
+    double d1 = cross(a1, a2, b1);
+    double d2 = cross(a1, a2, b2);
+    double d3 = cross(b1, b2, a1);
+    double d4 = cross(b1, b2, a2);
+    if (((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0))) {
+        return 0;
     }
+    //touching and collinear overlaps come out as 0 here
+    return fmin(fmin(point_segment_distance(a1, b1, b2), point_segment_distance(a2, b1, b2)),
+                fmin(point_segment_distance(b1, a1, a2), point_segment_distance(b2, a1, a2)));
+}
 
+double segment_circle_distance(const Point &start, const Point &end, const Circle &circle)
+{
+    double nearest = point_segment_distance(circle.center(), start, end);
+    double farthest = fmax(circle.center().distance(start), circle.center().distance(end));
+    if (circle.radius() < nearest) {
+        return nearest - circle.radius();
+    }
+    if (circle.radius() > farthest) {
+        return circle.radius() - farthest;
+    }
+    return 0;
+}
+
+// calls distance(start, end) for every polyline segment, stops at 0
+template <typename Distance>
+double polyline_distance(const Polyline &polyline, Distance &&distance)
+{
+    if (polyline.size() == 1) {
+        return distance(polyline[0], polyline[0]);
+    }
+    double result = HUGE_VAL;
+    for (std::size_t i = 1; i < polyline.size() && result > 0; i++) {
+        result = fmin(result, distance(polyline[i - 1], polyline[i]));
+    }
     return result;
 }
 
-std::vector<Point> Segment::intersect(const Polyline &other) const
+// distance along the ray to the segment, HUGE_VAL on a miss
+double segment_hit(const Ray &ray, const Point &start, const Point &end)
 {
-    std::vector<Point> result;
-    std::vector<Segment> segments(other.segments());
+    double ex = end.x() - start.x();
+    double ey = end.y() - start.y();
+    double ox = start.x() - ray.origin().x();
+    double oy = start.y() - ray.origin().y();
+    double denominator = ray.dx() * ey - ray.dy() * ex;
 
-    for (const auto &segment : segments) {
-        std::vector<Point> intersect_points = intersect(segment);
-        result.insert(result.end(), intersect_points.begin(), intersect_points.end());
+    double t;
+    if (fabs(denominator) <= EPS * sqrt(ex * ex + ey * ey)) {
+        //parallel, only a collinear segment is hit at its near end
+        if (fabs(ray.dx() * oy - ray.dy() * ox) > EPS) {
+            return HUGE_VAL;
+        }
+        double t_start = ray.dx() * ox + ray.dy() * oy;
+        double t_end = t_start + ray.dx() * ex + ray.dy() * ey;
+        if (fmax(t_start, t_end) < 0) {
+            return HUGE_VAL;
+        }
+        t = fmax(fmin(t_start, t_end), 0);
+    } else {
+        t = (ox * ey - oy * ex) / denominator;
+        double u = (ox * ray.dy() - oy * ray.dx()) / denominator;
+        if (t < -EPS || u < 0 || u > 1) {
+            return HUGE_VAL;
+        }
+        t = fmax(t, 0);
     }
+    return t <= ray.max_distance() ? t : HUGE_VAL;
+}
+
+void append_circle_hits(const Ray &ray, const Circle &circle, Distances &result)
+{
+    double fx = ray.origin().x() - circle.center().x();
+    double fy = ray.origin().y() - circle.center().y();
+    double b = fx * ray.dx() + fy * ray.dy();
+    double c = fx * fx + fy * fy - circle.radius() * circle.radius();
+    double discriminant = b * b - c;
+    if (discriminant < -EPS) {
+        return;
+    }
+
+    double root = sqrt(fmax(discriminant, 0));
+    for (double t : {-b - root, -b + root}) {
+        if (t >= 0 && t <= ray.max_distance() && (result.empty() || t - result.back() > EPS)) {
+            result.push_back(t);
+        }
+    }
+}
+
+// segments of one chain can only meet at their shared vertices
+using Chain = Polyline::Chain;
+
+int sign(double value)
+{
+    return (value > 0) - (value < 0);
+}
+
+std::vector<Chain> monotone_chains(const Point *points, std::size_t size)
+{
+    std::vector<Chain> chains;
+    if (size < 2) {
+        return chains;
+    }
+
+    Chain chain{0, 0};
+    int sign_x = 0, sign_y = 0;
+    for (std::size_t i = 0; i + 1 < size; i++) {
+        int dx = sign(points[i + 1].x() - points[i].x());
+        int dy = sign(points[i + 1].y() - points[i].y());
+        if ((sign_x != 0 && dx != 0 && dx != sign_x) || (sign_y != 0 && dy != 0 && dy != sign_y)) {
+            chains.push_back(chain);
+            chain.first = i;
+            sign_x = 0;
+            sign_y = 0;
+        }
+        chain.last = i + 1;
+        sign_x = sign_x != 0 ? sign_x : dx;
+        sign_y = sign_y != 0 ? sign_y : dy;
+    }
+    chains.push_back(chain);
+    return chains;
+}
+
+BoundingBox chain_box(const Point *points, std::size_t first, std::size_t last)
+{
+    BoundingBox box;
+    box.expand(points[first]);
+    box.expand(points[last]);
+    return box;
+}
+
+// chain boxes paired with the chain index, ordered by min_x
+std::vector<std::pair<BoundingBox, std::size_t>> sorted_chain_boxes(const Point *points,
+                                                                    const std::vector<Chain> &chains)
+{
+    std::vector<std::pair<BoundingBox, std::size_t>> boxes;
+    boxes.reserve(chains.size());
+    for (std::size_t i = 0; i < chains.size(); i++) {
+        boxes.emplace_back(chain_box(points, chains[i].first, chains[i].last), i);
+    }
+    std::sort(boxes.begin(), boxes.end(), [](const auto &a, const auto &b) {
+        return a.first.min_x() < b.first.min_x();
+    });
+    return boxes;
+}
+
+// Calls visit(i, j) for the segments i of the first run and j of the second
+// whose boxes overlap, halving the longer run until single segments remain.
+// Stops as soon as visit returns true.
+template <typename Visit>
+bool visit_chain_pairs(const Point *a, std::size_t a_first, std::size_t a_last,
+                       const Point *b, std::size_t b_first, std::size_t b_last, Visit &&visit)
+{
+    if (!chain_box(a, a_first, a_last).intersects(chain_box(b, b_first, b_last))) {
+        return false;
+    }
+    if (a_last - a_first == 1 && b_last - b_first == 1) {
+        return visit(a_first, b_first);
+    }
+    if (a_last - a_first >= b_last - b_first) {
+        std::size_t middle = (a_first + a_last) / 2;
+        return visit_chain_pairs(a, a_first, middle, b, b_first, b_last, visit)
+            || visit_chain_pairs(a, middle, a_last, b, b_first, b_last, visit);
+    }
+    std::size_t middle = (b_first + b_last) / 2;
+    return visit_chain_pairs(a, a_first, a_last, b, b_first, middle, visit)
+        || visit_chain_pairs(a, a_first, a_last, b, middle, b_last, visit);
+}
 
+// halves the chains whose boxes the circle line can meet
+void append_polyline_intersection(const Polyline &polyline, const Circle &circle, Points &result)
+{
+    if (!polyline.bbox().meets_circle(circle.center(), circle.radius())) {
+        return;
+    }
+    auto append = [&](std::size_t first, std::size_t last, auto &self) -> void {
+        if (!chain_box(polyline.begin(), first, last).meets_circle(circle.center(), circle.radius())) {
+            return;
+        }
+        if (last - first == 1) {
+            append_circle_intersection(Segment(polyline[first], polyline[last]), circle, result);
+            return;
+        }
+        std::size_t middle = (first + last) / 2;
+        self(first, middle, self);
+        self(middle, last, self);
+    };
+    for (const auto &chain : polyline.chains()) {
+        append(chain.first, chain.last, append);
+    }
+}
+
+// Calls visit(point) for every self-intersection, see Polyline::self_intersections.
+// Stops as soon as visit returns true.
+template <typename Visit>
+bool visit_self_intersections(const Point *points, std::size_t size, const std::vector<Chain> &chains,
+                              Visit &&visit)
+{
+    if (size < 3) {
+        return false;
+    }
+    bool closed = size > 3 && points[0] == points[size - 1];
+
+    //a segment doubling back over its neighbour, reported at the shorter one's far end
+    for (std::size_t i = 0; i + 2 < size; i++) {
+        double ax = points[i + 1].x() - points[i].x(), ay = points[i + 1].y() - points[i].y();
+        double bx = points[i + 2].x() - points[i + 1].x(), by = points[i + 2].y() - points[i + 1].y();
+        double a_length = sqrt(ax * ax + ay * ay), b_length = sqrt(bx * bx + by * by);
+        if (ax * bx + ay * by < 0 && fabs(ax * by - ay * bx) <= EPS * a_length * b_length) {
+            if (visit(a_length <= b_length ? points[i] : points[i + 2])) {
+                return true;
+            }
+        }
+    }
+
+    auto check = [&](std::size_t i, std::size_t j) {
+        if (i > j) {
+            std::swap(i, j);
+        }
+        if (j == i + 1 || (closed && i == 0 && j == size - 2)) {
+            return false;
+        }
+        Points found;
+        append_segment_intersection(Segment(points[i], points[i + 1]), Segment(points[j], points[j + 1]), found);
+        for (const auto &point : found) {
+            if (visit(point)) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    //sweep over the chain boxes by min_x
+    auto boxes = sorted_chain_boxes(points, chains);
+    for (std::size_t k = 0; k < boxes.size(); k++) {
+        const BoundingBox &box = boxes[k].first;
+        for (std::size_t l = k + 1; l < boxes.size() && boxes[l].first.min_x() <= box.max_x() + EPS; l++) {
+            const Chain &first = chains[boxes[k].second];
+            const Chain &second = chains[boxes[l].second];
+            if (box.intersects(boxes[l].first)
+                    && visit_chain_pairs(points, first.first, first.last, points, second.first, second.last, check)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Calls visit(i, j) for the segments i of a and j of b whose boxes overlap,
+// sweeping over the chain boxes of both by min_x
+template <typename Visit>
+void visit_segment_pairs(const Point *a, const std::vector<Chain> &a_chains,
+                         const Point *b, const std::vector<Chain> &b_chains, Visit &&visit)
+{
+    auto a_boxes = sorted_chain_boxes(a, a_chains);
+    auto b_boxes = sorted_chain_boxes(b, b_chains);
+    auto pair = [&](std::size_t i, std::size_t j) {
+        const Chain &first = a_chains[a_boxes[i].second];
+        const Chain &second = b_chains[b_boxes[j].second];
+        if (a_boxes[i].first.intersects(b_boxes[j].first)) {
+            visit_chain_pairs(a, first.first, first.last, b, second.first, second.last, [&](std::size_t k, std::size_t l) {
+                visit(k, l);
+                return false;
+            });
+        }
+    };
+
+    std::size_t i = 0, j = 0;
+    while (i < a_boxes.size() && j < b_boxes.size()) {
+        if (a_boxes[i].first.min_x() <= b_boxes[j].first.min_x()) {
+            for (std::size_t k = j; k < b_boxes.size() && b_boxes[k].first.min_x() <= a_boxes[i].first.max_x() + EPS; k++) {
+                pair(i, k);
+            }
+            i++;
+        } else {
+            for (std::size_t k = i; k < a_boxes.size() && a_boxes[k].first.min_x() <= b_boxes[j].first.max_x() + EPS; k++) {
+                pair(k, j);
+            }
+            j++;
+        }
+    }
+}
+
+// Value built on first use and published atomically: concurrent readers may
+// race to build it, one result wins and the others are dropped
+template <typename T, typename Build>
+const T &lazy_cache(std::shared_ptr<T> &slot, Build &&build)
+{
+    auto cached = std::atomic_load(&slot);
+    if (!cached) {
+        auto built = std::make_shared<T>(build());
+        cached = built;
+        std::shared_ptr<T> expected;
+        if (!std::atomic_compare_exchange_strong(&slot, &expected, built)) {
+            cached = expected;
+        }
+    }
+    return *cached;
+}
+
+// cached value an edit may change, copied first when other polylines share
+// it; null when it was never built
+template <typename T>
+T *unshared(std::shared_ptr<T> &slot)
+{
+    if (slot && slot.use_count() > 1) {
+        slot = std::make_shared<T>(*slot);
+    }
+    return slot.get();
+}
+
+}//namespace
+
+double Segment::length() const
+{
+    return start_.distance(end_);
+}
+
+BoundingBox Segment::bbox() const
+{
+    return BoundingBox(fmin(start_.x(), end_.x()), fmin(start_.y(), end_.y()),
+                       fmax(start_.x(), end_.x()), fmax(start_.y(), end_.y()));
+}
+
+Points Segment::intersect(const Segment &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    append_segment_intersection(*this, other, result);
     return result;
 }
 
-std::vector<Point> Segment::intersect(const Figure &other) const {
+Points Segment::intersect(const Circle &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    if (bbox().meets_circle(other.center(), other.radius())) {
+        append_circle_intersection(*this, other, result);
+    }
+    return result;
+}
 
-    return other.intersect(*this);
+Points Segment::intersect(const Polyline &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    if (!other.bbox().intersects(start_, end_)) {
+        return result;
+    }
+    Point ends[] = {start_, end_};
+    for (const auto &chain : other.chains()) {
+        if (!chain_box(other.begin(), chain.first, chain.last).intersects(start_, end_)) {
+            continue;
+        }
+        visit_chain_pairs(ends, 0, 1, other.begin(), chain.first, chain.last, [&](std::size_t, std::size_t j) {
+            append_segment_intersection(*this, Segment(other[j], other[j + 1]), result);
+            return false;
+        });
+    }
+    return result;
+}
+
+Points Segment::intersect(const Figure &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Segment::intersect(const Polygon &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Segment::intersect(const Rectangle &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Segment::intersect(const Arc &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Segment::intersect(const Bezier &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+double Segment::distance(const Point &point) const
+{
+    return point_segment_distance(point, start_, end_);
+}
+
+double Segment::distance(const Figure &other) const
+{
+    return other.distance(*this);
+}
+
+double Segment::distance(const Segment &other) const
+{
+    return segments_distance(start_, end_, other.start_, other.end_);
+}
+
+double Segment::distance(const Circle &other) const
+{
+    return segment_circle_distance(start_, end_, other);
+}
+
+double Segment::distance(const Polyline &other) const
+{
+    return polyline_distance(other, [&](const Point &start, const Point &end) {
+        return segments_distance(start_, end_, start, end);
+    });
+}
+
+double Segment::distance(const Polygon &other) const
+{
+    return other.distance(*this);
+}
+
+double Segment::distance(const Rectangle &other) const
+{
+    return other.distance(*this);
+}
+
+double Segment::distance(const Arc &other) const
+{
+    return other.distance(*this);
+}
+
+double Segment::distance(const Bezier &other) const
+{
+    return other.distance(*this);
+}
+
+double Segment::first_hit(const Ray &ray) const
+{
+    return segment_hit(ray, start_, end_);
+}
+
+Distances Segment::hits(const Ray &ray) const
+{
+    Distances result;
+    double t = segment_hit(ray, start_, end_);
+    if (t < HUGE_VAL) {
+        result.push_back(t);
+    }
+    return result;
 }
 
 //Circle
@@ -137,15 +724,21 @@ double Circle::length() const
     return 2 * M_PI * radius_;
 }
 
-std::vector<Point> Circle::intersect(const Segment &other) const
+BoundingBox Circle::bbox() const
 {
-    return other.intersect(*this);
+    return BoundingBox(center_.x() - radius_, center_.y() - radius_,
+                       center_.x() + radius_, center_.y() + radius_);
 }
 
-std::vector<Point> Circle::intersect(const Circle &other) const
+Points Circle::intersect(const Segment &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Circle::intersect(const Circle &other, std::pmr::memory_resource *resource) const
 {
     //http://www.litunovskiy.com/gamedev/intersection_of_two_circles/
-    std::vector<Point> result;
+    Points result(resource);
     double distance = center().distance(other.center());
 
     bool nesting = fabs(other.radius() - radius()) > distance;
@@ -174,69 +767,575 @@ std::vector<Point> Circle::intersect(const Circle &other) const
     return result;
 }
 
-std::vector<Point> Circle::intersect(const Polyline &other) const
+Points Circle::intersect(const Polyline &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    append_polyline_intersection(other, *this, result);
+    return result;
+}
+
+Points Circle::intersect(const Figure &other, std::pmr::memory_resource *resource) const
 {
-    std::vector<Point> result;
-    std::vector<Segment> segments(other.segments());
+    return other.intersect(*this, resource);
+}
 
-    for (const auto &segment : segments) {
-        std::vector<Point> intersect_points = intersect(segment);
-        result.insert(result.end(), intersect_points.begin(), intersect_points.end());
+Points Circle::intersect(const Polygon &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Circle::intersect(const Rectangle &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Circle::intersect(const Arc &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Circle::intersect(const Bezier &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+bool Circle::encloses(const Point &point) const
+{
+    return center_.distance(point) < radius_;
+}
+
+double Circle::distance(const Point &point) const
+{
+    return fabs(center_.distance(point) - radius_);
+}
+
+double Circle::distance(const Figure &other) const
+{
+    return other.distance(*this);
+}
+
+double Circle::distance(const Segment &other) const
+{
+    return other.distance(*this);
+}
+
+double Circle::distance(const Circle &other) const
+{
+    double distance = center_.distance(other.center_);
+    if (distance > radius_ + other.radius_) {
+        return distance - radius_ - other.radius_;
+    }
+    if (distance < fabs(radius_ - other.radius_)) {
+        return fabs(radius_ - other.radius_) - distance;
     }
+    return 0;
+}
 
-    return result;
+double Circle::distance(const Polyline &other) const
+{
+    return polyline_distance(other, [&](const Point &start, const Point &end) {
+        return segment_circle_distance(start, end, *this);
+    });
+}
+
+double Circle::distance(const Polygon &other) const
+{
+    return other.distance(*this);
+}
+
+double Circle::distance(const Rectangle &other) const
+{
+    return other.distance(*this);
+}
+
+double Circle::distance(const Arc &other) const
+{
+    return other.distance(*this);
+}
+
+double Circle::distance(const Bezier &other) const
+{
+    return other.distance(*this);
+}
+
+double Circle::first_hit(const Ray &ray) const
+{
+    Distances result;
+    append_circle_hits(ray, *this, result);
+    return result.empty() ? HUGE_VAL : result.front();
 }
 
-std::vector<Point> Circle::intersect(const Figure &other) const
+Distances Circle::hits(const Ray &ray) const
 {
-    return other.intersect(*this);
+    Distances result;
+    append_circle_hits(ray, *this, result);
+    return result;
 }
 
 //Polyline
+static_assert(sizeof(Point) == 2 * sizeof(double) && std::is_standard_layout<Point>::value,
+              "Point must match a packed pair of doubles");
+
+Polyline::Polyline(const Point *points, std::size_t size)
+    : data_(points), size_(size), owning_(false)
+{
+    compute_bbox();
+}
+
+Polyline::Polyline(const Polyline &other)
+    : points_(other.points_), data_(other.data_), size_(other.size_), owning_(other.owning_),
+      bbox_(other.bbox_), chains_(std::atomic_load(&other.chains_)),
+      lengths_(std::atomic_load(&other.lengths_))
+{
+    rebind();
+}
+
+Polyline::Polyline(Polyline &&other) noexcept
+    : points_(std::move(other.points_)), data_(other.data_), size_(other.size_), owning_(other.owning_),
+      bbox_(other.bbox_), chains_(std::move(other.chains_)),
+      lengths_(std::move(other.lengths_))
+{
+    rebind();
+    other.rebind();
+}
+
+Polyline &Polyline::operator=(const Polyline &other)
+{
+    points_ = other.points_;
+    data_ = other.data_;
+    size_ = other.size_;
+    owning_ = other.owning_;
+    bbox_ = other.bbox_;
+    chains_ = std::atomic_load(&other.chains_);
+    lengths_ = std::atomic_load(&other.lengths_);
+    rebind();
+    return *this;
+}
+
+Polyline &Polyline::operator=(Polyline &&other) noexcept
+{
+    points_ = std::move(other.points_);
+    data_ = other.data_;
+    size_ = other.size_;
+    owning_ = other.owning_;
+    bbox_ = other.bbox_;
+    chains_ = std::move(other.chains_);
+    lengths_ = std::move(other.lengths_);
+    rebind();
+    other.rebind();
+    return *this;
+}
+
+void Polyline::rebind()
+{
+    if (owning_) {
+        data_ = points_.data();
+        size_ = points_.size();
+    }
+}
+
+void Polyline::make_owning()
+{
+    if (!owning_) {
+        points_.assign(data_, data_ + size_);
+        owning_ = true;
+        rebind();
+    }
+}
+
+void Polyline::append(const Point &point)
+{
+    make_owning();
+    points_.push_back(point);
+    rebind();
+    bbox_.expand(point);
+
+    if (auto *lengths = unshared(lengths_)) {
+        lengths->push_back(lengths->empty() ? 0 : lengths->back() + data_[size_ - 2].distance(point));
+    }
+    auto *chains = unshared(chains_);
+    if (chains && size_ >= 2) {
+        const Point &previous = data_[size_ - 2];
+        if (chains->empty()) {
+            chains->push_back({0, 1});
+            return;
+        }
+        //a chain's direction signs are those of its end to end displacement
+        Chain &last = chains->back();
+        int chain_x = sign(data_[last.last].x() - data_[last.first].x());
+        int chain_y = sign(data_[last.last].y() - data_[last.first].y());
+        int dx = sign(point.x() - previous.x());
+        int dy = sign(point.y() - previous.y());
+        if ((chain_x != 0 && dx != 0 && dx != chain_x) || (chain_y != 0 && dy != 0 && dy != chain_y)) {
+            chains->push_back({size_ - 2, size_ - 1});
+        } else {
+            last.last = size_ - 1;
+        }
+    }
+}
+
+void Polyline::insert(std::size_t index, const Point &point)
+{
+    if (index > size_) {
+        throw std::out_of_range("polyline: insert position " + std::to_string(index) + " past the end");
+    }
+    if (index == size_) {
+        append(point);
+        return;
+    }
+    make_owning();
+    points_.insert(points_.begin() + index, point);
+    rebind();
+    bbox_.expand(point);
+    chains_.reset();
+
+    if (auto *lengths = unshared(lengths_)) {
+        //the points after the new one move by the same amount
+        auto &values = *lengths;
+        values.insert(values.begin() + index, 0.0);
+        values[index] = index > 0 ? values[index - 1] + data_[index - 1].distance(data_[index]) : 0;
+        double delta = values[index] + data_[index].distance(data_[index + 1]) - values[index + 1];
+        for (std::size_t i = index + 1; i < size_; i++) {
+            values[i] += delta;
+        }
+    }
+}
+
+void Polyline::erase(std::size_t index, std::size_t count)
+{
+    if (index > size_ || count > size_ - index) {
+        throw std::out_of_range("polyline: erase range past the end");
+    }
+    if (count == 0) {
+        return;
+    }
+    make_owning();
+
+    //the box only shrinks when a point on its border goes
+    bool border = false;
+    for (std::size_t i = index; i < index + count && !border; i++) {
+        border = data_[i].x() <= bbox_.min_x() || data_[i].x() >= bbox_.max_x()
+              || data_[i].y() <= bbox_.min_y() || data_[i].y() >= bbox_.max_y();
+    }
+    points_.erase(points_.begin() + index, points_.begin() + index + count);
+    rebind();
+    if (border) {
+        compute_bbox();
+    }
+    chains_.reset();
+
+    if (auto *lengths = unshared(lengths_)) {
+        auto &values = *lengths;
+        values.erase(values.begin() + index, values.begin() + index + count);
+        if (index < size_) {
+            double target = index > 0 ? values[index - 1] + data_[index - 1].distance(data_[index]) : 0;
+            double delta = target - values[index];
+            for (std::size_t i = index; i < size_; i++) {
+                values[i] += delta;
+            }
+        }
+    }
+}
+
+void Polyline::compute_bbox()
+{
+    bbox_ = BoundingBox();
+    for (std::size_t i = 0; i < size_; i++) {
+        bbox_.expand(data_[i]);
+    }
+}
+
 double Polyline::length() const
 {
-    double total_length = 0;
-    for (int i = 1; i < (int) points_.size(); i++) {
-        total_length += points_[i - 1].distance(points_[i]);
+    return size_ > 0 ? cumulative_lengths().back() : 0;
+}
+
+std::pmr::vector<Segment> Polyline::segments(std::pmr::memory_resource *resource) const
+{
+    std::pmr::vector<Segment> result(resource);
+
+    result.reserve(size_);
+
+    for (std::size_t i = 1; i < size_; i++) {
+        result.emplace_back(data_[i-1], data_[i]);
     }
-    return total_length;
+
+    return result;
 }
 
-std::vector<Segment> Polyline::segments() const
+Points Polyline::intersect(const Segment &other, std::pmr::memory_resource *resource) const
 {
-    std::vector<Point> segment_points(points());
-    std::vector<Segment> result;
+    return other.intersect(*this, resource);
+}
 
-    result.reserve(points().size());
+Points Polyline::intersect(const Circle &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
 
-    for (ulong i = 1; i < segment_points.size(); i++) {
-        result.emplace_back(segment_points[i-1], segment_points[i]);
+Points Polyline::intersect(const Polyline &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    visit_segment_pairs(data_, chains(), other.begin(), other.chains(), [&](std::size_t i, std::size_t j) {
+        append_segment_intersection(Segment(data_[i], data_[i + 1]), Segment(other[j], other[j + 1]), result);
+    });
+    return result;
+}
+
+Points Polyline::intersect(const Figure &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Polyline::self_intersections(std::pmr::memory_resource *resource, Duplicates duplicates) const
+{
+    Points result(resource);
+    visit_self_intersections(data_, size_, chains(), [&](const Point &point) {
+        result.push_back(point);
+        return false;
+    });
+    if (duplicates == Duplicates::MERGE) {
+        merge_close_points(result);
     }
+    return result;
+}
 
+bool Polyline::is_simple() const
+{
+    return !visit_self_intersections(data_, size_, chains(), [](const Point &) { return true; });
+}
+
+const std::vector<Polyline::Chain> &Polyline::chains() const
+{
+    return lazy_cache(chains_, [&]() { return monotone_chains(data_, size_); });
+}
+
+const std::vector<double> &Polyline::cumulative_lengths() const
+{
+    return lazy_cache(lengths_, [&]() {
+        std::vector<double> lengths;
+        lengths.reserve(size_);
+        double total_length = 0;
+        for (std::size_t i = 0; i < size_; i++) {
+            if (i > 0) {
+                total_length += data_[i - 1].distance(data_[i]);
+            }
+            lengths.push_back(total_length);
+        }
+        return lengths;
+    });
+}
+
+Point Polyline::point_at(double distance) const
+{
+    if (size_ == 0) {
+        throw std::invalid_argument("point_at: empty polyline");
+    }
+    const auto &lengths = cumulative_lengths();
+    if (distance <= 0) {
+        return data_[0];
+    }
+    if (distance >= lengths.back()) {
+        return data_[size_ - 1];
+    }
+
+    //first vertex past the distance, its segment holds the point
+    std::size_t i = std::upper_bound(lengths.begin(), lengths.end(), distance) - lengths.begin();
+    double t = (distance - lengths[i - 1]) / (lengths[i] - lengths[i - 1]);
+    return Point(data_[i - 1].x() + t * (data_[i].x() - data_[i - 1].x()),
+                 data_[i - 1].y() + t * (data_[i].y() - data_[i - 1].y()));
+}
+
+Polyline Polyline::sub_polyline(double from, double to, std::pmr::memory_resource *resource) const
+{
+    if (from > to) {
+        std::swap(from, to);
+    }
+    std::pmr::vector<Point> points(resource);
+    if (size_ == 0) {
+        return Polyline(std::move(points));
+    }
+
+    const auto &lengths = cumulative_lengths();
+    from = fmax(from, 0);
+    to = fmin(to, lengths.back());
+    std::size_t first = std::upper_bound(lengths.begin(), lengths.end(), from) - lengths.begin();
+    std::size_t last = std::lower_bound(lengths.begin(), lengths.end(), to) - lengths.begin();
+
+    points.reserve(last - std::min(first, last) + 2);
+    points.push_back(point_at(from));
+    for (std::size_t i = first; i < last; i++) {
+        points.push_back(data_[i]);
+    }
+    points.push_back(point_at(to));
+    return Polyline(std::move(points));
+}
+
+double Polyline::project(const Point &point) const
+{
+    if (size_ == 0) {
+        throw std::invalid_argument("project: empty polyline");
+    }
+    const auto &lengths = cumulative_lengths();
+    double best_distance = point.distance(data_[0]);
+    double result = 0;
+
+    // halves a chain run, nearer half first, skipping boxes beyond the best
+    auto search = [&](std::size_t first, std::size_t last, auto &self) -> void {
+        if (chain_box(data_, first, last).distance(point) >= best_distance) {
+            return;
+        }
+        if (last - first == 1) {
+            double dx = data_[last].x() - data_[first].x();
+            double dy = data_[last].y() - data_[first].y();
+            double length_2 = dx * dx + dy * dy;
+            double t = length_2 == 0 ? 0
+                    : fmax(0, fmin(1, ((point.x() - data_[first].x()) * dx + (point.y() - data_[first].y()) * dy) / length_2));
+            double distance = point.distance(Point(data_[first].x() + t * dx, data_[first].y() + t * dy));
+            if (distance < best_distance) {
+                best_distance = distance;
+                result = lengths[first] + t * (lengths[last] - lengths[first]);
+            }
+            return;
+        }
+        std::size_t middle = (first + last) / 2;
+        if (chain_box(data_, first, middle).distance(point) <= chain_box(data_, middle, last).distance(point)) {
+            self(first, middle, self);
+            self(middle, last, self);
+        } else {
+            self(middle, last, self);
+            self(first, middle, self);
+        }
+    };
+
+    std::vector<std::pair<double, Chain>> order;
+    for (const auto &chain : chains()) {
+        order.emplace_back(chain_box(data_, chain.first, chain.last).distance(point), chain);
+    }
+    std::sort(order.begin(), order.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+    for (const auto &entry : order) {
+        if (entry.first >= best_distance) {
+            break;
+        }
+        search(entry.second.first, entry.second.last, search);
+    }
     return result;
 }
 
-std::vector<Point> Polyline::intersect(const Segment &other) const
+Points Polyline::intersect(const Polygon &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Polyline::intersect(const Rectangle &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Polyline::intersect(const Arc &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Polyline::intersect(const Bezier &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+double Polyline::distance(const Point &point) const
+{
+    return polyline_distance(*this, [&](const Point &start, const Point &end) {
+        return point_segment_distance(point, start, end);
+    });
+}
+
+double Polyline::distance(const Figure &other) const
+{
+    return other.distance(*this);
+}
+
+double Polyline::distance(const Segment &other) const
+{
+    return other.distance(*this);
+}
+
+double Polyline::distance(const Circle &other) const
+{
+    return other.distance(*this);
+}
+
+double Polyline::distance(const Polyline &other) const
+{
+    return polyline_distance(*this, [&](const Point &start, const Point &end) {
+        return polyline_distance(other, [&](const Point &other_start, const Point &other_end) {
+            return segments_distance(start, end, other_start, other_end);
+        });
+    });
+}
+
+double Polyline::distance(const Polygon &other) const
+{
+    return other.distance(*this);
+}
+
+double Polyline::distance(const Rectangle &other) const
 {
-    return other.intersect(*this);
+    return other.distance(*this);
 }
 
-std::vector<Point> Polyline::intersect(const Circle &other) const
+double Polyline::distance(const Arc &other) const
 {
-    return other.intersect(*this);
+    return other.distance(*this);
 }
 
-std::vector<Point> Polyline::intersect(const Polyline &other) const
+double Polyline::distance(const Bezier &other) const
 {
-    std::vector<Point> result;
-    for (const auto &segment : segments()) {
-        std::vector<Point> intersect_points = segment.intersect(other);
-        result.insert(result.end(), intersect_points.begin(), intersect_points.end());
+    return other.distance(*this);
+}
+
+double Polyline::first_hit(const Ray &ray) const
+{
+    if (size_ == 1) {
+        return segment_hit(ray, data_[0], data_[0]);
+    }
+    double result = HUGE_VAL;
+    if (ray.enter(bbox_, HUGE_VAL) == HUGE_VAL) {
+        return result;
+    }
+    for (std::size_t i = 1; i < size_; i++) {
+        result = fmin(result, segment_hit(ray, data_[i - 1], data_[i]));
     }
     return result;
 }
 
-std::vector<Point> Polyline::intersect(const Figure &other) const
+Distances Polyline::hits(const Ray &ray) const
 {
-    return other.intersect(*this);
+    Distances result;
+    if (size_ == 1) {
+        double t = segment_hit(ray, data_[0], data_[0]);
+        if (t < HUGE_VAL) {
+            result.push_back(t);
+        }
+        return result;
+    }
+    if (ray.enter(bbox_, HUGE_VAL) == HUGE_VAL) {
+        return result;
+    }
+    for (std::size_t i = 1; i < size_; i++) {
+        double t = segment_hit(ray, data_[i - 1], data_[i]);
+        if (t < HUGE_VAL) {
+            result.push_back(t);
+        }
+    }
+
+    //a ray through a vertex hits both joined segments
+    std::sort(result.begin(), result.end());
+    auto last = std::unique(result.begin(), result.end(), [](double a, double b) { return b - a <= EPS; });
+    result.erase(last, result.end());
+    return result;
 }
+
+//PolylineView
+PolylineView::PolylineView(const double *coords, std::size_t count)
+    //Point is an implicit-lifetime type laid out as two doubles
+    : Polyline(reinterpret_cast<const Point *>(coords), count) {}
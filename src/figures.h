@@ -4,30 +4,20 @@
 #include <utility>
 #include <vector>
 #include <cmath>
+#include <memory>
+#include <memory_resource>
+#include "small_vector.h"
 
 #define EPS 0.00001
 
-class Point;
 class Segment;
 class Circle;
 class Polyline;
-
-class Figure
-{
-public:
-    virtual ~Figure() = default;
-
-    virtual double length() const = 0;
-
-    virtual std::vector<Point> intersect(const Figure &other) const = 0;
-    virtual std::vector<Point> intersect(const Segment &other) const = 0;
-    virtual std::vector<Point> intersect(const Circle &other) const = 0;
-    virtual std::vector<Point> intersect(const Polyline &other) const = 0;
-//
-//protected:
-//    static const double EPS;
-};
-
+class Polygon;
+class Rectangle;
+class Arc;
+class Bezier;
+class Ray;
 
 class Point
 {
@@ -48,6 +38,124 @@ private:
 };
 
 
+class BoundingBox
+{
+public:
+    // empty box, expanding it with a point makes it that point
+    BoundingBox() = default;
+    BoundingBox(double min_x, double min_y, double max_x, double max_y)
+        : min_x_(min_x), min_y_(min_y), max_x_(max_x), max_y_(max_y) {}
+
+    double min_x() const { return min_x_; }
+    double min_y() const { return min_y_; }
+    double max_x() const { return max_x_; }
+    double max_y() const { return max_y_; }
+
+    bool empty() const { return min_x_ > max_x_; }
+    Point center() const { return Point((min_x_ + max_x_) / 2, (min_y_ + max_y_) / 2); }
+
+    bool intersects(const BoundingBox &other) const;
+    bool contains(const Point &point) const;
+    // 0 inside the box
+    double distance(const Point &point) const;
+
+    // Liang–Barsky clipping: the part of segment a-b in the box is
+    // a + t (b - a) for t in [t0, t1], false when the segment misses the
+    // box grown by padding
+    bool clip(const Point &a, const Point &b, double &t0, double &t1, double padding = EPS) const;
+    bool intersects(const Point &a, const Point &b) const
+    {
+        double t0, t1;
+        return clip(a, b, t0, t1);
+    }
+    // whether a circle line can meet the box: the disc overlaps it and does
+    // not hold it whole
+    bool meets_circle(const Point &center, double radius) const;
+
+    void expand(const Point &point);
+    void expand(const BoundingBox &other);
+
+private:
+    double min_x_ = HUGE_VAL, min_y_ = HUGE_VAL;
+    double max_x_ = -HUGE_VAL, max_y_ = -HUGE_VAL;
+};
+
+
+// Segment and Circle results never hold more than two points and stay inline,
+// only polyline results spill to the memory resource
+using Points = SmallVector<Point, 2>;
+// distances along a ray, ascending
+using Distances = SmallVector<double, 2>;
+
+// Merges points closer than the tolerance on both axes (Point::operator== for
+// EPS), keeping the first of each group in order. Larger results go through
+// a spatial hash of tolerance-sized cells, so it takes expected O(k).
+void merge_close_points(Points &points, double tolerance = EPS);
+
+// whether intersect drops repeated points, e.g. a polyline joint reported by
+// both segments meeting at it
+enum class Duplicates { KEEP, MERGE };
+
+class Figure
+{
+public:
+    virtual ~Figure() = default;
+
+    virtual double length() const = 0;
+    virtual BoundingBox bbox() const = 0;
+
+    // result is allocated from the default memory resource
+    template <typename Other>
+    Points intersect(const Other &other) const
+    {
+        return intersect(other, std::pmr::get_default_resource());
+    }
+
+    template <typename Other>
+    Points intersect(const Other &other, std::pmr::memory_resource *resource, Duplicates duplicates) const
+    {
+        Points result = intersect(other, resource);
+        if (duplicates == Duplicates::MERGE) {
+            merge_close_points(result);
+        }
+        return result;
+    }
+
+    virtual Points intersect(const Figure &other, std::pmr::memory_resource *resource) const = 0;
+    virtual Points intersect(const Segment &other, std::pmr::memory_resource *resource) const = 0;
+    virtual Points intersect(const Circle &other, std::pmr::memory_resource *resource) const = 0;
+    virtual Points intersect(const Polyline &other, std::pmr::memory_resource *resource) const = 0;
+    virtual Points intersect(const Polygon &other, std::pmr::memory_resource *resource) const = 0;
+    virtual Points intersect(const Rectangle &other, std::pmr::memory_resource *resource) const = 0;
+    virtual Points intersect(const Arc &other, std::pmr::memory_resource *resource) const = 0;
+    virtual Points intersect(const Bezier &other, std::pmr::memory_resource *resource) const = 0;
+
+    // distance between the curves, 0 when they touch
+    virtual double distance(const Point &point) const = 0;
+    virtual double distance(const Figure &other) const = 0;
+    virtual double distance(const Segment &other) const = 0;
+    virtual double distance(const Circle &other) const = 0;
+    virtual double distance(const Polyline &other) const = 0;
+    virtual double distance(const Polygon &other) const = 0;
+    virtual double distance(const Rectangle &other) const = 0;
+    virtual double distance(const Arc &other) const = 0;
+    virtual double distance(const Bezier &other) const = 0;
+
+    // distance along the ray to the first point on the curve, HUGE_VAL when
+    // the ray misses it before max_distance
+    virtual double first_hit(const Ray &ray) const = 0;
+    // every crossing, a collinear overlap counts once at its near end
+    virtual Distances hits(const Ray &ray) const = 0;
+
+    // whether the region the figure bounds (circle disc, polygon,
+    // rectangle) holds the point; open curves bound none
+    virtual bool encloses(const Point &) const { return false; }
+//
+//protected:
+//    static const double EPS;
+};
+
+
 class Segment : public Figure
 {
 public:
@@ -57,11 +165,30 @@ public:
     Segment(Point start, Point end) : start_(start), end_(end) {}
 
     double length() const override;
+    BoundingBox bbox() const override;
+
+    using Figure::intersect;
+    Points intersect(const Figure &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Segment &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Circle &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Polyline &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Polygon &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Rectangle &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Arc &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Bezier &other, std::pmr::memory_resource *resource) const override;
 
-    std::vector<Point> intersect(const Figure &other) const override;
-    std::vector<Point> intersect(const Segment &other) const override;
-    std::vector<Point> intersect(const Circle &other) const override;
-    std::vector<Point> intersect(const Polyline &other) const override;
+    double distance(const Point &point) const override;
+    double distance(const Figure &other) const override;
+    double distance(const Segment &other) const override;
+    double distance(const Circle &other) const override;
+    double distance(const Polyline &other) const override;
+    double distance(const Polygon &other) const override;
+    double distance(const Rectangle &other) const override;
+    double distance(const Arc &other) const override;
+    double distance(const Bezier &other) const override;
+
+    double first_hit(const Ray &ray) const override;
+    Distances hits(const Ray &ray) const override;
 
     Point start() const { return start_; }
     Point end() const { return end_; }
@@ -77,12 +204,32 @@ public:
         : center_(x, y),
           radius_(radius > 0 ? radius : 0) {}
 
-    std::vector<Point> intersect(const Figure &other) const override;
-    std::vector<Point> intersect(const Segment &other) const override;
-    std::vector<Point> intersect(const Circle &other) const override;
-    std::vector<Point> intersect(const Polyline &other) const override;
+    using Figure::intersect;
+    Points intersect(const Figure &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Segment &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Circle &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Polyline &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Polygon &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Rectangle &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Arc &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Bezier &other, std::pmr::memory_resource *resource) const override;
+
+    double distance(const Point &point) const override;
+    double distance(const Figure &other) const override;
+    double distance(const Segment &other) const override;
+    double distance(const Circle &other) const override;
+    double distance(const Polyline &other) const override;
+    double distance(const Polygon &other) const override;
+    double distance(const Rectangle &other) const override;
+    double distance(const Arc &other) const override;
+    double distance(const Bezier &other) const override;
+
+    double first_hit(const Ray &ray) const override;
+    Distances hits(const Ray &ray) const override;
+    bool encloses(const Point &point) const override;
 
     double length() const override;
+    BoundingBox bbox() const override;
     double radius() const { return radius_; }
 
     Point center() const { return center_; }
@@ -95,17 +242,135 @@ private:
 class Polyline : public Figure
 {
 public:
-    explicit Polyline(const std::vector<Point> &points) : points_(points) {};
+    explicit Polyline(const std::vector<Point> &points,
+                      std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : points_(points.begin(), points.end(), resource) { rebind(); compute_bbox(); }
+
+    explicit Polyline(std::pmr::vector<Point> points) : points_(std::move(points)) { rebind(); compute_bbox(); }
+
+    Polyline(const Polyline &other);
+    Polyline(Polyline &&other) noexcept;
+    Polyline &operator=(const Polyline &other);
+    Polyline &operator=(Polyline &&other) noexcept;
+
+    using Figure::intersect;
+    Points intersect(const Figure &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Segment &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Circle &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Polyline &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Polygon &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Rectangle &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Arc &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Bezier &other, std::pmr::memory_resource *resource) const override;
 
-    std::vector<Point> intersect(const Figure &other) const override;
-    std::vector<Point> intersect(const Segment &other) const override;
-    std::vector<Point> intersect(const Circle &other) const override;
-    std::vector<Point> intersect(const Polyline &other) const override;
+    double distance(const Point &point) const override;
+    double distance(const Figure &other) const override;
+    double distance(const Segment &other) const override;
+    double distance(const Circle &other) const override;
+    double distance(const Polyline &other) const override;
+    double distance(const Polygon &other) const override;
+    double distance(const Rectangle &other) const override;
+    double distance(const Arc &other) const override;
+    double distance(const Bezier &other) const override;
+
+    double first_hit(const Ray &ray) const override;
+    Distances hits(const Ray &ray) const override;
 
     double length() const override;
+    BoundingBox bbox() const override { return bbox_; }
+
+    std::size_t size() const { return size_; }
+    const Point &operator[](std::size_t i) const { return data_[i]; }
+    const Point *begin() const { return data_; }
+    const Point *end() const { return data_ + size_; }
+
+    bool is_view() const { return !owning_; }
+    std::pmr::polymorphic_allocator<Point> get_allocator() const { return points_.get_allocator(); }
+
+    std::pmr::vector<Segment> segments(
+            std::pmr::memory_resource *resource = std::pmr::get_default_resource()) const;
+
+    // Crossings and touches of non-adjacent segments, plus the far end of a
+    // segment folding back over its neighbour. Joints of adjacent segments,
+    // including the closing vertex of a ring, are not reported; a crossing
+    // through a vertex is reported for both segments at it. Segments are
+    // grouped into monotone chains and only overlapping chains are split, so
+    // typical tracks take O((n + k) log n) instead of O(n^2).
+    Points self_intersections(std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+                              Duplicates duplicates = Duplicates::KEEP) const;
+    // stops at the first self-intersection
+    bool is_simple() const;
+
+    // maximal run of segments (vertices first..last) keeping the signs of dx
+    // and dy: the bbox of any sub-run is spanned by its end vertices
+    struct Chain
+    {
+        std::size_t first;
+        std::size_t last;
+    };
+
+    // Monotone chain decomposition, built in O(n) on first use and shared by
+    // copies. Intersections against other polylines and segments halve only
+    // the chains whose boxes overlap instead of testing every segment.
+    const std::vector<Chain> &chains() const;
+
+    // Distance along the line to every vertex, built on first use like
+    // chains(); length() is its last value.
+    const std::vector<double> &cumulative_lengths() const;
+    // Linear referencing, distances along the line clamped to [0, length()].
+    // point_at and sub_polyline binary search the vertex, project prunes
+    // the chains by their box distance. point_at and project throw
+    // std::invalid_argument on an empty polyline.
+    Point point_at(double distance) const;
+    // owning copy between the two distances, either order
+    Polyline sub_polyline(double from, double to,
+                          std::pmr::memory_resource *resource = std::pmr::get_default_resource()) const;
+    // distance along the line to the point of it nearest to the given point
+    double project(const Point &point) const;
+
+    // Editing turns a view into an owning polyline over a copy of its
+    // points. append is amortized O(1) and extends the bbox, cumulative
+    // lengths and last chain in place. insert and erase shift the points
+    // like the vector does, patch the bbox and lengths, and leave chains()
+    // to be rebuilt on next use. References returned by chains() and
+    // cumulative_lengths() do not survive an edit. Out of range positions
+    // throw std::out_of_range.
+    void append(const Point &point);
+    void insert(std::size_t index, const Point &point);
+    void erase(std::size_t index, std::size_t count = 1);
+
+protected:
+    // borrows the points, they must outlive the polyline
+    Polyline(const Point *points, std::size_t size);
+    Polyline(const Point *points, std::size_t size, const BoundingBox &bbox)
+        : data_(points), size_(size), owning_(false), bbox_(bbox) {}
 
-    const std::vector<Point> &points() const { return points_; }
-    std::vector<Segment> segments() const;
 private:
-    std::vector<Point> points_;
+    void rebind();
+    void compute_bbox();
+    void make_owning();
+
+    std::pmr::vector<Point> points_;
+    const Point *data_ = nullptr;
+    std::size_t size_ = 0;
+    bool owning_ = true;
+    BoundingBox bbox_;
+    // shared by copies, an edit copies them first unless it is the only owner
+    mutable std::shared_ptr<std::vector<Chain>> chains_;
+    mutable std::shared_ptr<std::vector<double>> lengths_;
+};
+
+// Non-owning polyline over external memory, e.g. an mmap'd file region.
+// Usable wherever a Polyline is; the coordinates must outlive the view.
+class PolylineView : public Polyline
+{
+public:
+    PolylineView(const Point *points, std::size_t size) : Polyline(points, size) {}
+
+    // bbox precomputed by the caller, the points are not walked
+    PolylineView(const Point *points, std::size_t size, const BoundingBox &bbox)
+        : Polyline(points, size, bbox) {}
+
+    // count packed (x, y) double pairs
+    PolylineView(const double *coords, std::size_t count);
 };
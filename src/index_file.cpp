@@ -0,0 +1,166 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+#include "index_file.h"
+
+namespace {
+
+const char INDEX_MAGIC[8] = {'F', 'I', 'G', 'R', 'T', 'R', 'E', 'E'};
+const std::uint32_t INDEX_VERSION = 2;
+const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+const std::uint64_t ALIGNMENT = 64;
+
+struct Header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint64_t file_size;
+    std::uint64_t figure_count;
+    std::uint64_t source_size;
+    std::int64_t source_mtime;
+    std::uint64_t nodes_offset;
+    std::uint64_t node_count;
+    std::uint64_t entries_offset;
+    std::uint64_t entry_count;
+    std::uint64_t checksum;
+};
+
+std::uint64_t align(std::uint64_t offset)
+{
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+void fail(const std::string &what)
+{
+    throw IndexFileError("index file: " + what);
+}
+
+// size and modification time of the source file, zero without one
+void stamp(const std::string &source, std::uint64_t &size, std::int64_t &mtime)
+{
+    size = 0;
+    mtime = 0;
+    if (!source.empty()) {
+        size = std::filesystem::file_size(source);
+        mtime = static_cast<std::int64_t>(std::filesystem::last_write_time(source).time_since_epoch().count());
+    }
+}
+
+}//namespace
+
+std::uint64_t index_checksum(const void *data, std::size_t size, std::uint64_t seed)
+{
+    // FNV-1a over 64-bit words, the tail is zero padded
+    const std::uint64_t PRIME = 0x100000001b3ULL;
+    std::uint64_t hash = 0xcbf29ce484222325ULL ^ seed;
+    auto bytes = static_cast<const unsigned char *>(data);
+
+    std::size_t i = 0;
+    for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * PRIME;
+    }
+    if (i < size) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, bytes + i, size - i);
+        hash = (hash ^ word) * PRIME;
+    }
+    return hash ^ size;
+}
+
+void write_index(const RTree &index, std::size_t figure_count, const std::string &path, const std::string &source)
+{
+    std::size_t nodes_size = index.node_count() * sizeof(RTree::Node);
+    std::size_t entries_size = index.entry_count() * sizeof(RTree::Entry);
+
+    Header header{};
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.figure_count = figure_count;
+    stamp(source, header.source_size, header.source_mtime);
+    header.nodes_offset = align(sizeof(Header));
+    header.node_count = index.node_count();
+    header.entries_offset = align(header.nodes_offset + nodes_size);
+    header.entry_count = index.entry_count();
+    header.file_size = header.entries_offset + entries_size;
+    header.checksum = index_checksum(index.entries(), entries_size,
+                                     index_checksum(index.nodes(), nodes_size));
+
+    //readers may have the old snapshot mapped, so the new one is written
+    //next to it and renamed over it once complete
+    std::string temporary = path + ".tmp." + std::to_string(::getpid());
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        fail("cannot open " + temporary);
+    }
+
+    static const char zeros[ALIGNMENT] = {};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(zeros, static_cast<std::streamsize>(header.nodes_offset - sizeof(header)));
+    out.write(reinterpret_cast<const char *>(index.nodes()), static_cast<std::streamsize>(nodes_size));
+    out.write(zeros, static_cast<std::streamsize>(header.entries_offset - header.nodes_offset - nodes_size));
+    out.write(reinterpret_cast<const char *>(index.entries()), static_cast<std::streamsize>(entries_size));
+    out.close();
+    std::error_code error;
+    if (!out) {
+        std::filesystem::remove(temporary, error);
+        fail("cannot write " + temporary);
+    }
+
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::string reason = error.message();
+        std::filesystem::remove(temporary, error);
+        fail("cannot replace " + path + ": " + reason);
+    }
+}
+
+MappedIndex::MappedIndex(const std::string &path, std::size_t figure_count, const std::string &source)
+    : file_(path)
+{
+    Header header{};
+    if (file_.size() < sizeof(header)) {
+        fail("truncated header");
+    }
+    std::memcpy(&header, file_.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+        fail("not an index file");
+    }
+    if (header.version != INDEX_VERSION || header.byte_order != BYTE_ORDER_MARK) {
+        fail("unsupported version or byte order");
+    }
+    if (header.file_size != file_.size()
+            || header.nodes_offset % ALIGNMENT != 0 || header.entries_offset % ALIGNMENT != 0
+            || header.nodes_offset > file_.size() || header.entries_offset > file_.size()
+            || header.node_count > (file_.size() - header.nodes_offset) / sizeof(RTree::Node)
+            || header.entry_count > (file_.size() - header.entries_offset) / sizeof(RTree::Entry)) {
+        fail("bad layout");
+    }
+    if (header.figure_count != figure_count) {
+        fail("built for " + std::to_string(header.figure_count) + " figures, not " + std::to_string(figure_count));
+    }
+    std::uint64_t source_size;
+    std::int64_t source_mtime;
+    stamp(source, source_size, source_mtime);
+    if (!source.empty() && (header.source_size != source_size || header.source_mtime != source_mtime)) {
+        fail("built for another version of " + source);
+    }
+
+    auto nodes = reinterpret_cast<const RTree::Node *>(file_.data() + header.nodes_offset);
+    auto entries = reinterpret_cast<const RTree::Entry *>(file_.data() + header.entries_offset);
+    std::size_t nodes_size = header.node_count * sizeof(RTree::Node);
+    std::size_t entries_size = header.entry_count * sizeof(RTree::Entry);
+    if (index_checksum(entries, entries_size, index_checksum(nodes, nodes_size)) != header.checksum) {
+        fail("checksum mismatch");
+    }
+
+    index_ = RTree::view(nodes, header.node_count, entries, header.entry_count);
+    if (!index_.is_valid(figure_count)) {
+        fail("bad index");
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include "mapped_file.h"
+#include "rtree.h"
+
+// Standalone R-tree snapshot, kept next to the figure data (e.g.
+// "basemap.bin.rtree"). Layout, native byte order, offsets from the file start:
+//   header | nodes (64-byte aligned) | entries (64-byte aligned)
+// The header holds the figure count the tree was built for, the size and
+// modification time of the source file it was built from and a checksum of
+// both arrays.
+
+// Malformed, stale or unwritable snapshot. Failures to open or map the file
+// are std::system_error.
+class IndexFileError : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+std::uint64_t index_checksum(const void *data, std::size_t size, std::uint64_t seed = 0);
+
+// source, when given, is the file the figures were read from. The snapshot
+// goes to a temporary file beside path that is then renamed over it, so a
+// reader never maps a partial file and one that mapped the old snapshot
+// keeps it.
+void write_index(const RTree &index, std::size_t figure_count, const std::string &path,
+                 const std::string &source = std::string());
+
+// Maps a snapshot and uses it without rebuilding. Throws IndexFileError when
+// the file is malformed, the checksum does not match, it was built for a
+// different figure count or, when source is given, the source file changed
+// size or modification time since.
+class MappedIndex
+{
+public:
+    MappedIndex(const std::string &path, std::size_t figure_count, const std::string &source = std::string());
+
+    const RTree &index() const { return index_; }
+
+private:
+    MappedFile file_;
+    RTree index_;
+};
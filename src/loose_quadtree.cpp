@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cmath>
+#include "loose_quadtree.h"
+
+LooseQuadtree::LooseQuadtree(const BoundingBox &world, unsigned max_depth)
+    : max_depth_(std::min(max_depth, MAX_DEPTH))
+{
+    double half = fmax(world.max_x() - world.min_x(), world.max_y() - world.min_y()) / 2;
+    Point center = world.center();
+    new_node(NONE, center.x(), center.y(), half > 0 ? half : 1);
+}
+
+std::int32_t LooseQuadtree::new_node(std::int32_t parent, double center_x, double center_y, double half)
+{
+    unsigned depth = parent == NONE ? 0 : nodes_[parent].depth + 1;
+    Node node{center_x, center_y, half, depth, parent, {NONE, NONE, NONE, NONE}, NONE, 0};
+    if (!free_nodes_.empty()) {
+        std::int32_t index = free_nodes_.back();
+        free_nodes_.pop_back();
+        nodes_[index] = node;
+        return index;
+    }
+    nodes_.push_back(node);
+    return static_cast<std::int32_t>(nodes_.size() - 1);
+}
+
+bool LooseQuadtree::fits(std::int32_t node_index, const BoundingBox &box) const
+{
+    const Node &node = nodes_[node_index];
+    Point center = box.center();
+    double size = fmax(box.max_x() - box.min_x(), box.max_y() - box.min_y());
+    return fabs(center.x() - node.center_x) <= node.half
+        && fabs(center.y() - node.center_y) <= node.half
+        && size <= 2 * node.half;
+}
+
+bool LooseQuadtree::is_target(std::int32_t node, const BoundingBox &box) const
+{
+    if (node == 0 && !fits(0, box)) {
+        return true;
+    }
+    double size = fmax(box.max_x() - box.min_x(), box.max_y() - box.min_y());
+    return fits(node, box) && (size > nodes_[node].half || nodes_[node].depth == max_depth_);
+}
+
+std::int32_t LooseQuadtree::target_node(const BoundingBox &box)
+{
+    std::int32_t node = 0;
+    if (!fits(node, box)) {
+        return node;
+    }
+
+    Point center = box.center();
+    double size = fmax(box.max_x() - box.min_x(), box.max_y() - box.min_y());
+    // children cells are half as big, the figure has to fit one of them
+    while (nodes_[node].depth < max_depth_ && size <= nodes_[node].half) {
+        double child_half = nodes_[node].half / 2;
+        int quadrant = (center.x() >= nodes_[node].center_x ? 1 : 0) + (center.y() >= nodes_[node].center_y ? 2 : 0);
+        std::int32_t child = nodes_[node].children[quadrant];
+        if (child == NONE) {
+            double child_x = nodes_[node].center_x + (quadrant & 1 ? child_half : -child_half);
+            double child_y = nodes_[node].center_y + (quadrant & 2 ? child_half : -child_half);
+            child = new_node(node, child_x, child_y, child_half);
+            nodes_[node].children[quadrant] = child;
+        }
+        node = child;
+    }
+    return node;
+}
+
+void LooseQuadtree::link(std::int32_t item, std::int32_t node)
+{
+    Item &entry = items_[item];
+    entry.node = node;
+    entry.prev = NONE;
+    entry.next = nodes_[node].first_item;
+    if (entry.next != NONE) {
+        items_[entry.next].prev = item;
+    }
+    nodes_[node].first_item = item;
+
+    for (std::int32_t i = node; i != NONE; i = nodes_[i].parent) {
+        nodes_[i].count++;
+    }
+}
+
+void LooseQuadtree::unlink(std::int32_t item)
+{
+    Item &entry = items_[item];
+    std::int32_t node = entry.node;
+    if (entry.prev != NONE) {
+        items_[entry.prev].next = entry.next;
+    } else {
+        nodes_[node].first_item = entry.next;
+    }
+    if (entry.next != NONE) {
+        items_[entry.next].prev = entry.prev;
+    }
+
+    for (std::int32_t i = node; i != NONE; i = nodes_[i].parent) {
+        nodes_[i].count--;
+    }
+
+    // empty leaves go back to the pool, the root stays
+    while (node != 0 && nodes_[node].count == 0
+            && std::all_of(std::begin(nodes_[node].children), std::end(nodes_[node].children),
+                           [](std::int32_t child) { return child == NONE; })) {
+        std::int32_t parent = nodes_[node].parent;
+        std::replace(std::begin(nodes_[parent].children), std::end(nodes_[parent].children), node, NONE);
+        free_nodes_.push_back(node);
+        node = parent;
+    }
+}
+
+void LooseQuadtree::insert(std::size_t id, const Figure &figure)
+{
+    if (contains(id)) {
+        update(id, figure);
+        return;
+    }
+    if (id >= item_of_.size()) {
+        item_of_.resize(id + 1, NONE);
+    }
+
+    std::int32_t item;
+    if (!free_items_.empty()) {
+        item = free_items_.back();
+        free_items_.pop_back();
+    } else {
+        items_.emplace_back();
+        item = static_cast<std::int32_t>(items_.size() - 1);
+    }
+    items_[item].box = figure.bbox();
+    items_[item].figure = &figure;
+    items_[item].id = id;
+    item_of_[id] = item;
+
+    link(item, target_node(items_[item].box));
+    count_++;
+}
+
+void LooseQuadtree::update(std::size_t id)
+{
+    if (contains(id)) {
+        update(id, *items_[item_of_[id]].figure);
+    }
+}
+
+void LooseQuadtree::update(std::size_t id, const Figure &figure)
+{
+    if (!contains(id)) {
+        insert(id, figure);
+        return;
+    }
+
+    std::int32_t item = item_of_[id];
+    BoundingBox box = figure.bbox();
+    items_[item].figure = &figure;
+    items_[item].box = box;
+
+    // small moves usually stay in the same node
+    if (is_target(items_[item].node, box)) {
+        return;
+    }
+    unlink(item);
+    link(item, target_node(box));
+}
+
+void LooseQuadtree::remove(std::size_t id)
+{
+    if (!contains(id)) {
+        return;
+    }
+    std::int32_t item = item_of_[id];
+    unlink(item);
+    free_items_.push_back(item);
+    item_of_[id] = NONE;
+    count_--;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "figures.h"
+
+// Dynamic loose quadtree over figures that appear, move and disappear.
+// A figure lives in the deepest node whose loose bounds (twice the cell)
+// still hold it, so insert, remove and update walk one root-to-node path.
+// Nodes and entries live in pooled arrays with free lists. Figures are
+// referenced, not copied, and must outlive their entries; ids are small
+// dense integers.
+class LooseQuadtree
+{
+public:
+    static constexpr unsigned MAX_DEPTH = 24;
+
+    explicit LooseQuadtree(const BoundingBox &world, unsigned max_depth = 12);
+
+    void insert(std::size_t id, const Figure &figure);
+    // the figure moved or changed in place
+    void update(std::size_t id);
+    void update(std::size_t id, const Figure &figure);
+    void remove(std::size_t id);
+
+    bool contains(std::size_t id) const { return id < item_of_.size() && item_of_[id] != NONE; }
+    std::size_t size() const { return count_; }
+    std::size_t node_count() const { return nodes_.size() - free_nodes_.size(); }
+
+    // calls visit(id) for every figure whose bbox intersects the box
+    template <typename Visitor>
+    void query(const BoundingBox &box, Visitor &&visit) const;
+
+    // calls visit(id) for every figure intersecting the given one
+    template <typename Visitor>
+    void query(const Figure &figure, Visitor &&visit) const;
+
+private:
+    static constexpr std::int32_t NONE = -1;
+
+    struct Node
+    {
+        double center_x, center_y, half;
+        unsigned depth;
+        std::int32_t parent;
+        std::int32_t children[4];
+        std::int32_t first_item;
+        std::size_t count;
+    };
+
+    struct Item
+    {
+        BoundingBox box;
+        const Figure *figure;
+        std::size_t id;
+        std::int32_t node;
+        std::int32_t prev, next;
+    };
+
+    BoundingBox loose_bounds(const Node &node) const
+    {
+        double half = 2 * node.half;
+        return BoundingBox(node.center_x - half, node.center_y - half,
+                           node.center_x + half, node.center_y + half);
+    }
+
+    std::int32_t target_node(const BoundingBox &box);
+    bool fits(std::int32_t node, const BoundingBox &box) const;
+    bool is_target(std::int32_t node, const BoundingBox &box) const;
+    std::int32_t new_node(std::int32_t parent, double center_x, double center_y, double half);
+    void link(std::int32_t item, std::int32_t node);
+    void unlink(std::int32_t item);
+
+    std::vector<Node> nodes_;
+    std::vector<std::int32_t> free_nodes_;
+    std::vector<Item> items_;
+    std::vector<std::int32_t> free_items_;
+    std::vector<std::int32_t> item_of_;
+    unsigned max_depth_;
+    std::size_t count_ = 0;
+};
+
+template <typename Visitor>
+void LooseQuadtree::query(const BoundingBox &box, Visitor &&visit) const
+{
+    std::int32_t stack[4 * MAX_DEPTH + 1];
+    std::size_t top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        std::int32_t index = stack[--top];
+        const Node &node = nodes_[index];
+        // the root also holds figures outside the world bounds
+        if (node.count == 0 || (index != 0 && !loose_bounds(node).intersects(box))) {
+            continue;
+        }
+        for (std::int32_t i = node.first_item; i != NONE; i = items_[i].next) {
+            if (items_[i].box.intersects(box)) {
+                visit(items_[i].id);
+            }
+        }
+        for (std::int32_t child : node.children) {
+            if (child != NONE) {
+                stack[top++] = child;
+            }
+        }
+    }
+}
+
+template <typename Visitor>
+void LooseQuadtree::query(const Figure &figure, Visitor &&visit) const
+{
+    query(figure.bbox(), [&](std::size_t id) {
+        if (!figure.intersect(*items_[item_of_[id]].figure).empty()) {
+            visit(id);
+        }
+    });
+}
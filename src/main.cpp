@@ -1,19 +1,515 @@
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
 #include <iostream>
-#include "figures.h"
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
 #include <vector>
+#include "arena.h"
+#include "figures.h"
+#include "index_file.h"
+#include "scene.h"
+#include "scene_file.h"
+#include "scene_source.h"
+#include "spatial_join.h"
+#include "sweep_and_prune.h"
+#include "wkt.h"
+
+namespace {
+
+const char USAGE[] =
+        "usage: figures [options] [file...]\n"
+        "Reads figures from the files (or stdin) and streams intersections to stdout as\n"
+        "'<id> <id> MULTIPOINT (...)' lines.\n"
+        "\n"
+        "  --mode=pairs|self|query|join\n"
+        "                           pairs: 1st x 2nd, 3rd x 4th, ... (default)\n"
+        "                           self:  every intersecting pair of the input\n"
+        "                           query: every input figure against --basemap\n"
+        "                           join:  as query, loading the whole input and\n"
+        "                                  joining it tile by tile; pairs come in\n"
+        "                                  no particular order\n"
+        "  --basemap=FILE           basemap for query and join modes\n"
+        "  --format=wkt|bin|csv     input format, by default from the file extension\n"
+        "  --broad-phase=rtree|sweep|none\n"
+        "                           candidate search for self and query modes,\n"
+        "                           sweep is for self mode only\n"
+        "  --index-cache            load the R-tree of a single input from FILE.rtree,\n"
+        "                           or build and save it there\n"
+        "  --threads=N              worker threads (default: all cores)\n"
+        "  --batch=N                figures per streamed batch, and figures or pairs\n"
+        "                           per flushed output chunk (default: 4096)\n"
+        "  --join-memory=MB         tile entries kept in memory by join mode before\n"
+        "                           they spill to the temp directory (default: no limit)\n";
+
+const std::string OPTION_NAMES[] = {"mode", "basemap", "format", "broad-phase", "threads", "batch", "join-memory"};
+
+enum class Mode { PAIRS, SELF, QUERY, JOIN };
+enum class BroadPhase { RTREE, SWEEP, NONE };
+
+struct Options
+{
+    Mode mode = Mode::PAIRS;
+    InputFormat format = InputFormat::AUTO;
+    BroadPhase broad_phase = BroadPhase::RTREE;
+    bool index_cache = false;
+    unsigned threads = 0;
+    std::size_t batch = 4096;
+    std::size_t join_memory = 0;
+    std::string basemap;
+    std::vector<std::string> inputs;
+};
+
+Options parse_options(int argc, char **argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            options.inputs.push_back(arg);
+            continue;
+        }
+
+        std::string key = arg.substr(2);
+        std::string value;
+        std::size_t equals = key.find('=');
+        if (equals != std::string::npos) {
+            value = key.substr(equals + 1);
+            key = key.substr(0, equals);
+        } else if (key == "index-cache") {
+            options.index_cache = true;
+            continue;
+        } else if (key != "help") {
+            if (std::find(std::begin(OPTION_NAMES), std::end(OPTION_NAMES), key) == std::end(OPTION_NAMES)) {
+                throw std::invalid_argument("unknown option --" + key);
+            }
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("missing value for --" + key);
+            }
+            value = argv[++i];
+        }
+
+        if (key == "help") {
+            std::cout << USAGE;
+            std::exit(0);
+        } else if (key == "mode") {
+            if (value == "pairs") {
+                options.mode = Mode::PAIRS;
+            } else if (value == "self") {
+                options.mode = Mode::SELF;
+            } else if (value == "query") {
+                options.mode = Mode::QUERY;
+            } else if (value == "join") {
+                options.mode = Mode::JOIN;
+            } else {
+                throw std::invalid_argument("unknown mode " + value);
+            }
+        } else if (key == "format") {
+            if (value == "wkt") {
+                options.format = InputFormat::WKT;
+            } else if (value == "bin") {
+                options.format = InputFormat::BIN;
+            } else if (value == "csv") {
+                options.format = InputFormat::CSV;
+            } else {
+                throw std::invalid_argument("unknown format " + value);
+            }
+        } else if (key == "broad-phase") {
+            if (value == "rtree") {
+                options.broad_phase = BroadPhase::RTREE;
+            } else if (value == "sweep") {
+                options.broad_phase = BroadPhase::SWEEP;
+            } else if (value == "none") {
+                options.broad_phase = BroadPhase::NONE;
+            } else {
+                throw std::invalid_argument("unknown broad phase " + value);
+            }
+        } else if (key == "threads") {
+            options.threads = static_cast<unsigned>(std::stoul(value));
+        } else if (key == "batch") {
+            options.batch = std::max<std::size_t>(1, std::stoul(value));
+        } else if (key == "join-memory") {
+            options.join_memory = std::stoul(value) << 20;
+        } else if (key == "basemap") {
+            options.basemap = value;
+        } else {
+            throw std::invalid_argument("unknown option --" + key);
+        }
+    }
+
+    if (options.threads == 0) {
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if ((options.mode == Mode::QUERY || options.mode == Mode::JOIN) && options.basemap.empty()) {
+        throw std::invalid_argument("query and join modes need --basemap");
+    }
+    if (options.mode != Mode::SELF && options.broad_phase == BroadPhase::SWEEP) {
+        throw std::invalid_argument("sweep broad phase needs self mode");
+    }
+    return options;
+}
+
+// Worker threads started once per run, each keeping its thread arena warm
+// across chunks. run(count, chunk, work) calls work(begin, end, out) over
+// [0, count) in chunks of up to chunk items, each split between the
+// threads; the outputs of a chunk are written in order and flushed before
+// the next one starts, so buffered output stays bounded.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(unsigned threads) : outputs_(std::max(threads, 1u)), errors_(outputs_.size())
+    {
+        for (unsigned thread = 1; thread < outputs_.size(); thread++) {
+            workers_.emplace_back([this, thread]() { loop(thread); });
+        }
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        started_.notify_all();
+        for (auto &worker : workers_) {
+            worker.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    template <typename Work>
+    void run(std::size_t count, std::size_t chunk, Work work)
+    {
+        chunk = std::max<std::size_t>(chunk, 1);
+        std::size_t threads = outputs_.size();
+        for (std::size_t first = 0; first < count; first += chunk) {
+            std::size_t size = std::min(chunk, count - first);
+            task_ = [&](unsigned thread) {
+                std::ostringstream out;
+                ArenaScope arena;
+                work(first + size * thread / threads, first + size * (thread + 1) / threads, out, arena.resource());
+                outputs_[thread] = out.str();
+            };
+            dispatch();
+
+            for (auto &error : errors_) {
+                if (error) {
+                    std::rethrow_exception(std::exchange(error, nullptr));
+                }
+            }
+            for (auto &output : outputs_) {
+                std::cout << output;
+                output.clear();
+            }
+            std::cout.flush();
+        }
+    }
+
+private:
+    // runs task_ on every thread, this one included, and waits for all
+    void dispatch()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            round_++;
+            pending_ = workers_.size();
+        }
+        started_.notify_all();
+        execute(0);
+        std::unique_lock<std::mutex> lock(mutex_);
+        finished_.wait(lock, [&]() { return pending_ == 0; });
+    }
+
+    void execute(unsigned thread)
+    {
+        try {
+            task_(thread);
+        } catch (...) {
+            errors_[thread] = std::current_exception();
+        }
+    }
+
+    void loop(unsigned thread)
+    {
+        std::size_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                started_.wait(lock, [&]() { return stopping_ || round_ != seen; });
+                if (stopping_) {
+                    return;
+                }
+                seen = round_;
+            }
+            execute(thread);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0) {
+                finished_.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::string> outputs_;
+    std::vector<std::exception_ptr> errors_;
+    std::vector<std::thread> workers_;
+    std::function<void(unsigned)> task_;
+    std::mutex mutex_;
+    std::condition_variable started_;
+    std::condition_variable finished_;
+    std::size_t round_ = 0;
+    std::size_t pending_ = 0;
+    bool stopping_ = false;
+};
+
+// All inputs as one scene. A single binary scene is used in place together
+// with its prebuilt index. With --index-cache the R-tree of a single input
+// is loaded from a snapshot next to it, or built and saved there.
+class LoadedScene
+{
+public:
+    LoadedScene(const std::vector<std::string> &inputs, const Options &options)
+    {
+        bool single = inputs.size() == 1 && inputs[0] != "-";
+        if (single && detect_format(inputs[0], options.format) == InputFormat::BIN) {
+            mapped_ = std::make_unique<MappedScene>(inputs[0]);
+            scene_ = &mapped_->scene();
+        } else {
+            SceneSource source(inputs, options.format);
+            Scene batch;
+            while (source.next(options.batch, batch)) {
+                for (std::size_t id = 0; id < batch.size(); id++) {
+                    copy_figure(batch, id, loaded_);
+                }
+            }
+            sources_ = source.take_mappings();
+            scene_ = &loaded_;
+        }
+
+        if (options.broad_phase != BroadPhase::RTREE || scene_->has_index()) {
+            return;
+        }
+        if (!single || !options.index_cache) {
+            scene_->build_index();
+            return;
+        }
+
+        // a missing, stale or corrupt snapshot is rebuilt, other I/O errors are reported
+        std::string cache = inputs[0] + ".rtree";
+        try {
+            index_ = std::make_unique<MappedIndex>(cache, scene_->size(), inputs[0]);
+            scene_->set_index(index_->index());
+            return;
+        } catch (const IndexFileError &) {
+        } catch (const std::system_error &error) {
+            if (error.code() != std::errc::no_such_file_or_directory) {
+                throw;
+            }
+        }
+        scene_->build_index();
+        write_index(scene_->index(), scene_->size(), cache, inputs[0]);
+    }
+
+    const Scene &scene() const { return *scene_; }
+
+private:
+    std::unique_ptr<MappedScene> mapped_;
+    std::unique_ptr<MappedIndex> index_;
+    // binary inputs that loaded_ polylines point into, declared first so
+    // they are unmapped last
+    std::vector<std::unique_ptr<MappedScene>> sources_;
+    Scene loaded_;
+    Scene *scene_ = nullptr;
+};
+
+void write_intersection(std::ostream &out, std::size_t first, std::size_t second, const Points &points)
+{
+    out << first << ' ' << second << ' ';
+    WktWriter(out).write(points);
+}
+
+// calls visit(id) for every figure of the scene whose bbox overlaps the box
+template <typename Visitor>
+void candidates(const Scene &scene, BroadPhase broad_phase, const BoundingBox &box, Visitor &&visit)
+{
+    if (broad_phase == BroadPhase::RTREE) {
+        scene.index().query(box, visit);
+        return;
+    }
+    for (std::size_t id = 0; id < scene.size(); id++) {
+        if (scene[id].bbox().intersects(box)) {
+            visit(id);
+        }
+    }
+}
+
+void run_pairs(const Options &options)
+{
+    WorkerPool workers(options.threads);
+    SceneSource source(options.inputs, options.format);
+    Scene batch;
+    std::size_t offset = 0;
+    // even batch size keeps pairs together
+    std::size_t batch_size = options.batch + options.batch % 2;
+
+    while (source.next(batch_size, batch)) {
+        workers.run(batch.size() / 2, batch.size() / 2, [&](std::size_t begin, std::size_t end, std::ostream &out, std::pmr::memory_resource *resource) {
+            for (std::size_t pair = begin; pair < end; pair++) {
+                Points points = batch[2 * pair].intersect(batch[2 * pair + 1], resource);
+                if (!points.empty()) {
+                    write_intersection(out, offset + 2 * pair, offset + 2 * pair + 1, points);
+                }
+            }
+        });
+        offset += batch.size();
+    }
+    // only the last batch can be odd
+    if (offset % 2 != 0) {
+        throw std::runtime_error("pairs mode needs an even number of figures, figure "
+                                 + std::to_string(offset - 1) + " has no partner");
+    }
+}
+
+void run_self(const Options &options)
+{
+    LoadedScene loaded(options.inputs, options);
+    const Scene &scene = loaded.scene();
+    WorkerPool workers(options.threads);
+
+    if (options.broad_phase == BroadPhase::SWEEP) {
+        SweepAndPrune sweep;
+        for (std::size_t id = 0; id < scene.size(); id++) {
+            sweep.insert(id, scene[id].bbox());
+        }
+        sweep.step();
+
+        const auto &pairs = sweep.pairs();
+        workers.run(pairs.size(), options.batch, [&](std::size_t begin, std::size_t end, std::ostream &out, std::pmr::memory_resource *resource) {
+            for (std::size_t i = begin; i < end; i++) {
+                Points points = scene[pairs[i].first].intersect(scene[pairs[i].second], resource);
+                if (!points.empty()) {
+                    write_intersection(out, pairs[i].first, pairs[i].second, points);
+                }
+            }
+        });
+        return;
+    }
+
+    workers.run(scene.size(), options.batch, [&](std::size_t begin, std::size_t end, std::ostream &out, std::pmr::memory_resource *resource) {
+        for (std::size_t id = begin; id < end; id++) {
+            candidates(scene, options.broad_phase, scene[id].bbox(), [&](std::size_t other) {
+                if (other > id) {
+                    Points points = scene[id].intersect(scene[other], resource);
+                    if (!points.empty()) {
+                        write_intersection(out, id, other, points);
+                    }
+                }
+            });
+        }
+    });
+}
+
+void run_query(const Options &options)
+{
+    LoadedScene loaded({options.basemap}, options);
+    const Scene &basemap = loaded.scene();
+
+    WorkerPool workers(options.threads);
+    SceneSource source(options.inputs, options.format);
+    Scene batch;
+    std::size_t offset = 0;
+    while (source.next(options.batch, batch)) {
+        workers.run(batch.size(), batch.size(), [&](std::size_t begin, std::size_t end, std::ostream &out, std::pmr::memory_resource *resource) {
+            for (std::size_t id = begin; id < end; id++) {
+                candidates(basemap, options.broad_phase, batch[id].bbox(), [&](std::size_t other) {
+                    Points points = batch[id].intersect(basemap[other], resource);
+                    if (!points.empty()) {
+                        write_intersection(out, offset + id, other, points);
+                    }
+                });
+            }
+        });
+        offset += batch.size();
+    }
+}
+
+void run_join(Options options)
+{
+    // the join partitions the inputs itself
+    options.broad_phase = BroadPhase::NONE;
+    LoadedScene loaded_input(options.inputs, options);
+    LoadedScene loaded_basemap({options.basemap}, options);
+    const Scene &input = loaded_input.scene();
+    const Scene &basemap = loaded_basemap.scene();
+
+    JoinOptions join_options;
+    join_options.threads = options.threads;
+    join_options.memory_budget = options.join_memory;
 
-int main() {
-    std::cout << "main.cpp" << std::endl;
+    // each worker writes its pairs as the join finds them, so the narrow
+    // phase runs once and at most --batch pairs per worker wait in memory
+    std::mutex output;
+    std::vector<std::ostringstream> outs(options.threads);
+    std::vector<std::size_t> buffered(options.threads);
+    auto flush = [&](unsigned worker) {
+        std::lock_guard<std::mutex> lock(output);
+        std::cout << outs[worker].str();
+        std::cout.flush();
+        outs[worker].str(std::string());
+        buffered[worker] = 0;
+    };
+    spatial_join(input, basemap, join_options,
+                 [&](unsigned worker, std::size_t a, std::size_t b, const Points &points) {
+        write_intersection(outs[worker], a, b, points);
+        if (++buffered[worker] == options.batch) {
+            flush(worker);
+        }
+    });
+    for (unsigned worker = 0; worker < options.threads; worker++) {
+        flush(worker);
+    }
+}
 
-    std::vector<Figure*> fgs;
+}//namespace
 
-    Circle c1(0, 2, 2);
-    Circle c2(4, 2, 2);
+int main(int argc, char **argv)
+{
+    std::ios::sync_with_stdio(false);
 
-    fgs.push_back(&c1);
-    fgs.push_back(&c2);
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << "figures: " << e.what() << "\n" << USAGE;
+        return 2;
+    }
 
-    std::vector<Point>intrses = (fgs[0])->intersect(*fgs[1]);
-//    std::vector<Point>intrses(fgs[0].intersect(fgs[1]));
+    try {
+        switch (options.mode) {
+        case Mode::PAIRS:
+            run_pairs(options);
+            break;
+        case Mode::SELF:
+            run_self(options);
+            break;
+        case Mode::QUERY:
+            run_query(options);
+            break;
+        case Mode::JOIN:
+            run_join(options);
+            break;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "figures: " << e.what() << std::endl;
+        return 1;
+    }
     return 0;
-}
\ No newline at end of file
+}
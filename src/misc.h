@@ -4,6 +4,6 @@
 
 namespace misc {
 
-bool contains_point(const std::vector<Point> &vec, const Point &p);
+bool contains_point(const Points &vec, const Point &p);
 
 }//namespace misc
\ No newline at end of file
@@ -0,0 +1,387 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "arc.h"
+#include "bezier.h"
+#include "polygon.h"
+#include "ray.h"
+#include "rectangle.h"
+
+namespace {
+
+Polyline closed_ring(const std::vector<Point> &points)
+{
+    std::vector<Point> ring(points);
+    if (!ring.empty() && !(ring.front() == ring.back())) {
+        ring.push_back(ring.front());
+    }
+    if (ring.size() < 4) {
+        throw std::invalid_argument("polygon: a ring needs at least three points");
+    }
+    return Polyline(ring);
+}
+
+double signed_area(const Polyline &ring)
+{
+    double area = 0;
+    for (std::size_t i = 1; i < ring.size(); i++) {
+        area += ring[i - 1].x() * ring[i].y() - ring[i].x() * ring[i - 1].y();
+    }
+    return area / 2;
+}
+
+// A point on any connected figure: its curve crosses the horizontal line
+// through the middle of its bbox, so a ray along that line hits it
+Point point_on(const Figure &figure)
+{
+    BoundingBox box = figure.bbox();
+    Ray ray(Point(box.min_x() - 1, box.center().y()), 1, 0);
+    double distance = figure.first_hit(ray);
+    return distance < HUGE_VAL ? ray.at(distance) : box.center();
+}
+
+}//namespace
+
+Polygon::Polygon(const std::vector<Point> &outer, const std::vector<std::vector<Point>> &holes)
+{
+    rings_.reserve(holes.size() + 1);
+    rings_.push_back(closed_ring(outer));
+    for (const auto &hole : holes) {
+        rings_.push_back(closed_ring(hole));
+    }
+
+    area_ = fabs(signed_area(rings_.front()));
+    for (std::size_t i = 1; i < rings_.size(); i++) {
+        area_ -= fabs(signed_area(rings_[i]));
+    }
+    build_slabs();
+}
+
+void Polygon::build_slabs()
+{
+    for (const auto &ring : rings_) {
+        for (const auto &point : ring) {
+            slab_y_.push_back(point.y());
+        }
+    }
+    std::sort(slab_y_.begin(), slab_y_.end());
+    slab_y_.erase(std::unique(slab_y_.begin(), slab_y_.end()), slab_y_.end());
+
+    auto slab = [&](double y) {
+        return static_cast<std::size_t>(std::lower_bound(slab_y_.begin(), slab_y_.end(), y) - slab_y_.begin());
+    };
+
+    //count the edges per slab, then place them
+    std::size_t slabs = slab_y_.size() - 1;
+    slab_first_.assign(slabs + 1, 0);
+    std::vector<Edge> edges;
+    for (const auto &ring : rings_) {
+        for (std::size_t i = 1; i < ring.size(); i++) {
+            Edge edge{ring[i - 1], ring[i]};
+            if (edge.start.y() == edge.end.y()) {
+                horizontal_.push_back(edge);
+                continue;
+            }
+            if (edge.start.y() > edge.end.y()) {
+                std::swap(edge.start, edge.end);
+            }
+            edges.push_back(edge);
+            for (std::size_t s = slab(edge.start.y()); s < slab(edge.end.y()); s++) {
+                slab_first_[s + 1]++;
+            }
+        }
+    }
+    for (std::size_t s = 0; s < slabs; s++) {
+        slab_first_[s + 1] += slab_first_[s];
+    }
+
+    slab_edges_.assign(slab_first_.back(), Edge{Point(0, 0), Point(0, 0)});
+    std::vector<std::uint32_t> fill(slab_first_.begin(), slab_first_.end() - 1);
+    for (const auto &edge : edges) {
+        for (std::size_t s = slab(edge.start.y()); s < slab(edge.end.y()); s++) {
+            slab_edges_[fill[s]++] = edge;
+        }
+    }
+
+    //edges do not cross, so the order at mid height holds for the whole slab
+    for (std::size_t s = 0; s < slabs; s++) {
+        double middle = (slab_y_[s] + slab_y_[s + 1]) / 2;
+        std::sort(slab_edges_.begin() + slab_first_[s], slab_edges_.begin() + slab_first_[s + 1],
+                  [&](const Edge &a, const Edge &b) { return a.x_at(middle) < b.x_at(middle); });
+    }
+
+    std::sort(horizontal_.begin(), horizontal_.end(), [](const Edge &a, const Edge &b) {
+        return a.start.y() < b.start.y();
+    });
+}
+
+bool Polygon::on_horizontal_edge(const Point &point) const
+{
+    auto first = std::lower_bound(horizontal_.begin(), horizontal_.end(), point.y() - EPS,
+                                  [](const Edge &edge, double y) { return edge.start.y() < y; });
+    for (auto edge = first; edge != horizontal_.end() && edge->start.y() <= point.y() + EPS; ++edge) {
+        if (point.x() >= fmin(edge->start.x(), edge->end.x()) - EPS
+                && point.x() <= fmax(edge->start.x(), edge->end.x()) + EPS) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Polygon::contains(const Point &point) const
+{
+    if (!bbox().contains(point)) {
+        return false;
+    }
+    if (on_horizontal_edge(point)) {
+        return true;
+    }
+
+    if (slab_y_.size() < 2) {
+        return false;
+    }
+    //points on the top vertex height belong to the last slab
+    std::size_t slab = std::upper_bound(slab_y_.begin(), slab_y_.end(), point.y()) - slab_y_.begin();
+    if (slab == 0) {
+        return false;
+    }
+    slab = std::min(slab - 1, slab_y_.size() - 2);
+
+    auto first = slab_edges_.begin() + slab_first_[slab];
+    auto last = slab_edges_.begin() + slab_first_[slab + 1];
+    auto right = std::partition_point(first, last, [&](const Edge &edge) {
+        return edge.x_at(point.y()) < point.x();
+    });
+    if ((right != last && right->x_at(point.y()) - point.x() <= EPS)
+            || (right != first && point.x() - (right - 1)->x_at(point.y()) <= EPS)) {
+        return true;
+    }
+    return (right - first) % 2 == 1;
+}
+
+bool Polygon::contains(const Figure &other) const
+{
+    BoundingBox box = other.bbox();
+    if (!bbox().contains(Point(box.min_x(), box.min_y())) || !bbox().contains(Point(box.max_x(), box.max_y()))) {
+        return false;
+    }
+    if (!intersect(other).empty() || !contains(point_on(other))) {
+        return false;
+    }
+    for (std::size_t i = 1; i < rings_.size(); i++) {
+        if (other.encloses(rings_[i][0])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Polygon::overlaps(const Figure &other) const
+{
+    if (!bbox().intersects(other.bbox())) {
+        return false;
+    }
+    return !intersect(other).empty() || contains(point_on(other)) || other.encloses(outer()[0]);
+}
+
+double Polygon::length() const
+{
+    double length = 0;
+    for (const auto &ring : rings_) {
+        length += ring.length();
+    }
+    return length;
+}
+
+Points Polygon::intersect(const Figure &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Polygon::intersect(const Segment &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    if (!bbox().intersects(other.start(), other.end())) {
+        return result;
+    }
+    for (const auto &ring : rings_) {
+        Points points = other.intersect(ring, resource);
+        result.insert(result.end(), points.begin(), points.end());
+    }
+    return result;
+}
+
+Points Polygon::intersect(const Circle &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    if (!bbox().meets_circle(other.center(), other.radius())) {
+        return result;
+    }
+    for (const auto &ring : rings_) {
+        Points points = other.intersect(ring, resource);
+        result.insert(result.end(), points.begin(), points.end());
+    }
+    return result;
+}
+
+Points Polygon::intersect(const Polyline &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    if (!bbox().intersects(other.bbox())) {
+        return result;
+    }
+    for (const auto &ring : rings_) {
+        Points points = ring.intersect(other, resource);
+        result.insert(result.end(), points.begin(), points.end());
+    }
+    return result;
+}
+
+Points Polygon::intersect(const Polygon &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    if (!bbox().intersects(other.bbox())) {
+        return result;
+    }
+    for (const auto &ring : other.rings_) {
+        Points points = intersect(ring, resource);
+        result.insert(result.end(), points.begin(), points.end());
+    }
+    return result;
+}
+
+Points Polygon::intersect(const Rectangle &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    if (!bbox().intersects(other.box())) {
+        return result;
+    }
+    for (const auto &ring : rings_) {
+        Points points = other.intersect(ring, resource);
+        result.insert(result.end(), points.begin(), points.end());
+    }
+    return result;
+}
+
+Points Polygon::intersect(const Arc &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    if (!bbox().intersects(other.bbox())) {
+        return result;
+    }
+    for (const auto &ring : rings_) {
+        Points points = other.intersect(ring, resource);
+        result.insert(result.end(), points.begin(), points.end());
+    }
+    return result;
+}
+
+Points Polygon::intersect(const Bezier &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    if (!bbox().intersects(other.bbox())) {
+        return result;
+    }
+    for (const auto &ring : rings_) {
+        Points points = other.intersect(ring, resource);
+        result.insert(result.end(), points.begin(), points.end());
+    }
+    return result;
+}
+
+double Polygon::distance(const Point &point) const
+{
+    double result = HUGE_VAL;
+    for (const auto &ring : rings_) {
+        result = fmin(result, ring.distance(point));
+    }
+    return result;
+}
+
+double Polygon::distance(const Figure &other) const
+{
+    return other.distance(*this);
+}
+
+double Polygon::distance(const Segment &other) const
+{
+    double result = HUGE_VAL;
+    for (std::size_t i = 0; i < rings_.size() && result > 0; i++) {
+        result = fmin(result, rings_[i].distance(other));
+    }
+    return result;
+}
+
+double Polygon::distance(const Circle &other) const
+{
+    double result = HUGE_VAL;
+    for (std::size_t i = 0; i < rings_.size() && result > 0; i++) {
+        result = fmin(result, rings_[i].distance(other));
+    }
+    return result;
+}
+
+double Polygon::distance(const Polyline &other) const
+{
+    double result = HUGE_VAL;
+    for (std::size_t i = 0; i < rings_.size() && result > 0; i++) {
+        result = fmin(result, rings_[i].distance(other));
+    }
+    return result;
+}
+
+double Polygon::distance(const Polygon &other) const
+{
+    double result = HUGE_VAL;
+    for (std::size_t i = 0; i < other.rings_.size() && result > 0; i++) {
+        result = fmin(result, distance(other.rings_[i]));
+    }
+    return result;
+}
+
+double Polygon::distance(const Rectangle &other) const
+{
+    double result = HUGE_VAL;
+    for (std::size_t i = 0; i < rings_.size() && result > 0; i++) {
+        result = fmin(result, other.distance(rings_[i]));
+    }
+    return result;
+}
+
+double Polygon::distance(const Arc &other) const
+{
+    double result = HUGE_VAL;
+    for (std::size_t i = 0; i < rings_.size() && result > 0; i++) {
+        result = fmin(result, other.distance(rings_[i]));
+    }
+    return result;
+}
+
+double Polygon::distance(const Bezier &other) const
+{
+    double result = HUGE_VAL;
+    for (std::size_t i = 0; i < rings_.size() && result > 0; i++) {
+        result = fmin(result, other.distance(rings_[i]));
+    }
+    return result;
+}
+
+double Polygon::first_hit(const Ray &ray) const
+{
+    double result = HUGE_VAL;
+    for (const auto &ring : rings_) {
+        result = fmin(result, ring.first_hit(ray));
+    }
+    return result;
+}
+
+Distances Polygon::hits(const Ray &ray) const
+{
+    Distances result;
+    for (const auto &ring : rings_) {
+        Distances distances = ring.hits(ray);
+        result.insert(result.end(), distances.begin(), distances.end());
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
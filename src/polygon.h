@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "figures.h"
+
+// Closed region bounded by an outer ring and optional holes. As a Figure it
+// is its boundary, like Circle is its curve: intersect, distance and ray
+// hits work on the rings and length() is the perimeter. contains() and
+// overlaps() take the interior into account.
+//
+// Point location goes through a slab index built with the polygon: the
+// distinct vertex y values cut the plane into horizontal slabs, and the
+// edges crossing each slab are kept sorted left to right. A query binary
+// searches the slab and then the edges in it, O(log n). The index holds
+// one entry per edge and slab it crosses, so it suits zone-like rings that
+// a horizontal line cuts a few times.
+class Polygon : public Figure
+{
+public:
+    // Rings are closed automatically and must not cross themselves or each
+    // other. Throws std::invalid_argument for a ring of fewer than three
+    // points.
+    explicit Polygon(const std::vector<Point> &outer, const std::vector<std::vector<Point>> &holes = {});
+
+    // closed polylines, the outer ring first
+    const std::vector<Polyline> &rings() const { return rings_; }
+    const Polyline &outer() const { return rings_.front(); }
+
+    double length() const override;
+    BoundingBox bbox() const override { return rings_.front().bbox(); }
+    // outer area less the holes
+    double area() const { return area_; }
+
+    using Figure::intersect;
+    Points intersect(const Figure &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Segment &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Circle &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Polyline &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Polygon &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Rectangle &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Arc &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Bezier &other, std::pmr::memory_resource *resource) const override;
+
+    double distance(const Point &point) const override;
+    double distance(const Figure &other) const override;
+    double distance(const Segment &other) const override;
+    double distance(const Circle &other) const override;
+    double distance(const Polyline &other) const override;
+    double distance(const Polygon &other) const override;
+    double distance(const Rectangle &other) const override;
+    double distance(const Arc &other) const override;
+    double distance(const Bezier &other) const override;
+
+    double first_hit(const Ray &ray) const override;
+    Distances hits(const Ray &ray) const override;
+    bool encloses(const Point &point) const override { return contains(point); }
+
+    // inside or on the boundary
+    bool contains(const Point &point) const;
+    // The figure lies inside without meeting the boundary. Figures that
+    // enclose a region count as that region, so a hole inside them fails
+    // the test.
+    bool contains(const Figure &other) const;
+    // the figure meets the region: crosses the boundary, lies inside or, as
+    // a region, holds the polygon
+    bool overlaps(const Figure &other) const;
+
+private:
+    struct Edge
+    {
+        Point start;
+        Point end;
+
+        double x_at(double y) const
+        {
+            return start.x() + (y - start.y()) * (end.x() - start.x()) / (end.y() - start.y());
+        }
+    };
+
+    void build_slabs();
+    bool on_horizontal_edge(const Point &point) const;
+
+    std::vector<Polyline> rings_;
+    double area_ = 0;
+
+    // slab i spans [slab_y_[i], slab_y_[i + 1]), its edges are
+    // slab_edges_[slab_first_[i], slab_first_[i + 1])
+    std::vector<double> slab_y_;
+    std::vector<std::uint32_t> slab_first_;
+    std::vector<Edge> slab_edges_;
+    // horizontal edges sorted by y, the slabs leave them out
+    std::vector<Edge> horizontal_;
+};
@@ -0,0 +1,32 @@
+#include <algorithm>
+#include "ray.h"
+
+Ray::Ray(const Point &origin, double dx, double dy, double max_distance)
+    : origin_(origin), dx_(dx), dy_(dy), max_distance_(max_distance)
+{
+    double length = sqrt(dx * dx + dy * dy);
+    if (length > 0) {
+        dx_ /= length;
+        dy_ /= length;
+    }
+}
+
+Ray Ray::towards(const Point &from, const Point &to)
+{
+    return Ray(from, to.x() - from.x(), to.y() - from.y(), from.distance(to));
+}
+
+double Ray::enter(const BoundingBox &box, double limit) const
+{
+    //slab test, 1/0 gives infinities that the min/max sort out
+    double inv_x = 1 / dx_;
+    double inv_y = 1 / dy_;
+    double tx1 = (box.min_x() - EPS - origin_.x()) * inv_x;
+    double tx2 = (box.max_x() + EPS - origin_.x()) * inv_x;
+    double ty1 = (box.min_y() - EPS - origin_.y()) * inv_y;
+    double ty2 = (box.max_y() + EPS - origin_.y()) * inv_y;
+
+    double near = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)), 0.0);
+    double far = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)), std::min(limit, max_distance_));
+    return near <= far ? near : HUGE_VAL;
+}
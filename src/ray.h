@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include "figures.h"
+
+// Half-line from the origin along a unit direction, optionally cut at
+// max_distance (e.g. line of sight to a target)
+class Ray
+{
+public:
+    Ray(const Point &origin, double dx, double dy, double max_distance = HUGE_VAL);
+
+    // ray from one point to another, cut at the target
+    static Ray towards(const Point &from, const Point &to);
+
+    const Point &origin() const { return origin_; }
+    double dx() const { return dx_; }
+    double dy() const { return dy_; }
+    double max_distance() const { return max_distance_; }
+
+    Point at(double distance) const
+    {
+        return Point(origin_.x() + dx_ * distance, origin_.y() + dy_ * distance);
+    }
+
+    // distance at which the ray enters the box, HUGE_VAL when it misses the
+    // box before limit
+    double enter(const BoundingBox &box, double limit) const;
+
+private:
+    Point origin_;
+    double dx_, dy_;
+    double max_distance_;
+};
+
+struct RayHit
+{
+    std::size_t id;
+    double distance;
+};
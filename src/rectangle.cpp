@@ -0,0 +1,315 @@
+#include <algorithm>
+#include <cmath>
+#include "arc.h"
+#include "bezier.h"
+#include "polygon.h"
+#include "ray.h"
+#include "rectangle.h"
+
+namespace {
+
+bool near_border(const BoundingBox &box, const Point &point)
+{
+    return fabs(point.x() - box.min_x()) <= EPS || fabs(point.x() - box.max_x()) <= EPS
+        || fabs(point.y() - box.min_y()) <= EPS || fabs(point.y() - box.max_y()) <= EPS;
+}
+
+Point point_at(const Point &a, const Point &b, double t)
+{
+    return Point(a.x() + t * (b.x() - a.x()), a.y() + t * (b.y() - a.y()));
+}
+
+// Where segment a-b meets the border: the ends of its part in the box that
+// are not strictly inside. The exact box gives the points, the EPS-padded
+// one catches segments that pass within EPS of it.
+void append_border_points(const BoundingBox &box, const Point &a, const Point &b, Points &result)
+{
+    double t0, t1;
+    if (!box.clip(a, b, t0, t1, 0)) {
+        if (box.clip(a, b, t0, t1)) {
+            result.push_back(point_at(a, b, (t0 + t1) / 2));
+        }
+        return;
+    }
+    Point entry = point_at(a, b, t0);
+    Point exit = point_at(a, b, t1);
+    bool entry_on_border = t0 > 0 || near_border(box, a);
+    if (entry_on_border) {
+        result.push_back(entry);
+    }
+    if ((t1 < 1 || near_border(box, b)) && !(entry_on_border && entry == exit)) {
+        result.push_back(exit);
+    }
+}
+
+// the box shrunk by EPS holds the other box
+bool strictly_inside(const BoundingBox &box, const BoundingBox &other)
+{
+    return other.min_x() > box.min_x() + EPS && other.max_x() < box.max_x() - EPS
+        && other.min_y() > box.min_y() + EPS && other.max_y() < box.max_y() - EPS;
+}
+
+}//namespace
+
+Rectangle::Rectangle(double x1, double y1, double x2, double y2)
+    : box_(fmin(x1, x2), fmin(y1, y2), fmax(x1, x2), fmax(y1, y2)) {}
+
+Segment Rectangle::edge(int i) const
+{
+    switch (i) {
+    case 0:
+        return Segment(box_.min_x(), box_.min_y(), box_.max_x(), box_.min_y());
+    case 1:
+        return Segment(box_.max_x(), box_.min_y(), box_.max_x(), box_.max_y());
+    case 2:
+        return Segment(box_.max_x(), box_.max_y(), box_.min_x(), box_.max_y());
+    default:
+        return Segment(box_.min_x(), box_.max_y(), box_.min_x(), box_.min_y());
+    }
+}
+
+bool Rectangle::contains(const Figure &other) const
+{
+    //figures reach their bbox, so one strictly inside cannot touch the border
+    return strictly_inside(box_, other.bbox());
+}
+
+bool Rectangle::overlaps(const Figure &other) const
+{
+    BoundingBox box = other.bbox();
+    if (!box_.intersects(box)) {
+        return false;
+    }
+    if (strictly_inside(box_, box) || !intersect(other).empty()) {
+        return true;
+    }
+    //a connected figure partly outside and missing the border lies outside
+    return other.encloses(Point(box_.min_x(), box_.min_y()));
+}
+
+std::vector<Polyline> Rectangle::clip(const Polyline &polyline, std::pmr::memory_resource *resource) const
+{
+    std::vector<Polyline> pieces;
+    std::pmr::vector<Point> piece(resource);
+    auto flush = [&]() {
+        if (piece.size() >= 2) {
+            pieces.emplace_back(std::move(piece));
+        }
+        piece = std::pmr::vector<Point>(resource);
+    };
+
+    for (std::size_t i = 1; i < polyline.size(); i++) {
+        const Point &a = polyline[i - 1];
+        const Point &b = polyline[i];
+        double t0, t1;
+        if (!box_.clip(a, b, t0, t1, 0)) {
+            flush();
+            continue;
+        }
+        if (piece.empty()) {
+            piece.push_back(point_at(a, b, t0));
+        }
+        piece.push_back(point_at(a, b, t1));
+        if (t1 < 1) {
+            flush();
+        }
+    }
+    flush();
+    return pieces;
+}
+
+Points Rectangle::intersect(const Figure &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Rectangle::intersect(const Segment &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    append_border_points(box_, other.start(), other.end(), result);
+    return result;
+}
+
+Points Rectangle::intersect(const Circle &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    if (!box_.meets_circle(other.center(), other.radius())) {
+        return result;
+    }
+    for (int i = 0; i < 4; i++) {
+        Points points = edge(i).intersect(other, resource);
+        result.insert(result.end(), points.begin(), points.end());
+    }
+    return result;
+}
+
+Points Rectangle::intersect(const Polyline &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    if (!box_.intersects(other.bbox()) || strictly_inside(box_, other.bbox())) {
+        return result;
+    }
+
+    //chain boxes are spanned by their end vertices
+    auto append = [&](std::size_t first, std::size_t last, auto &self) -> void {
+        BoundingBox box;
+        box.expand(other[first]);
+        box.expand(other[last]);
+        if (!box_.intersects(box) || strictly_inside(box_, box)) {
+            return;
+        }
+        if (last - first == 1) {
+            append_border_points(box_, other[first], other[last], result);
+            return;
+        }
+        std::size_t middle = (first + last) / 2;
+        self(first, middle, self);
+        self(middle, last, self);
+    };
+    for (const auto &chain : other.chains()) {
+        append(chain.first, chain.last, append);
+    }
+    return result;
+}
+
+Points Rectangle::intersect(const Polygon &other, std::pmr::memory_resource *resource) const
+{
+    return other.intersect(*this, resource);
+}
+
+Points Rectangle::intersect(const Rectangle &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    if (!box_.intersects(other.box_)) {
+        return result;
+    }
+    for (int i = 0; i < 4; i++) {
+        Segment side = other.edge(i);
+        append_border_points(box_, side.start(), side.end(), result);
+    }
+    return result;
+}
+
+Points Rectangle::intersect(const Arc &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    if (!box_.intersects(other.bbox())) {
+        return result;
+    }
+    for (int i = 0; i < 4; i++) {
+        Points points = other.intersect(edge(i), resource);
+        result.insert(result.end(), points.begin(), points.end());
+    }
+    return result;
+}
+
+Points Rectangle::intersect(const Bezier &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    if (!box_.intersects(other.bbox())) {
+        return result;
+    }
+    for (int i = 0; i < 4; i++) {
+        Points points = other.intersect(edge(i), resource);
+        result.insert(result.end(), points.begin(), points.end());
+    }
+    return result;
+}
+
+double Rectangle::distance(const Point &point) const
+{
+    if (!box_.contains(point)) {
+        return box_.distance(point);
+    }
+    return fmax(0, fmin(fmin(point.x() - box_.min_x(), box_.max_x() - point.x()),
+                        fmin(point.y() - box_.min_y(), box_.max_y() - point.y())));
+}
+
+double Rectangle::distance(const Figure &other) const
+{
+    return other.distance(*this);
+}
+
+double Rectangle::distance(const Segment &other) const
+{
+    double result = HUGE_VAL;
+    for (int i = 0; i < 4 && result > 0; i++) {
+        result = fmin(result, edge(i).distance(other));
+    }
+    return result;
+}
+
+double Rectangle::distance(const Circle &other) const
+{
+    double result = HUGE_VAL;
+    for (int i = 0; i < 4 && result > 0; i++) {
+        result = fmin(result, edge(i).distance(other));
+    }
+    return result;
+}
+
+double Rectangle::distance(const Polyline &other) const
+{
+    double result = HUGE_VAL;
+    for (int i = 0; i < 4 && result > 0; i++) {
+        result = fmin(result, edge(i).distance(other));
+    }
+    return result;
+}
+
+double Rectangle::distance(const Polygon &other) const
+{
+    return other.distance(*this);
+}
+
+double Rectangle::distance(const Rectangle &other) const
+{
+    double result = HUGE_VAL;
+    for (int i = 0; i < 4 && result > 0; i++) {
+        result = fmin(result, distance(other.edge(i)));
+    }
+    return result;
+}
+
+double Rectangle::distance(const Arc &other) const
+{
+    double result = HUGE_VAL;
+    for (int i = 0; i < 4 && result > 0; i++) {
+        result = fmin(result, other.distance(edge(i)));
+    }
+    return result;
+}
+
+double Rectangle::distance(const Bezier &other) const
+{
+    double result = HUGE_VAL;
+    for (int i = 0; i < 4 && result > 0; i++) {
+        result = fmin(result, other.distance(edge(i)));
+    }
+    return result;
+}
+
+double Rectangle::first_hit(const Ray &ray) const
+{
+    double result = HUGE_VAL;
+    for (int i = 0; i < 4; i++) {
+        result = fmin(result, edge(i).first_hit(ray));
+    }
+    return result;
+}
+
+Distances Rectangle::hits(const Ray &ray) const
+{
+    Distances result;
+    for (int i = 0; i < 4; i++) {
+        double distance = edge(i).first_hit(ray);
+        if (distance < HUGE_VAL) {
+            result.push_back(distance);
+        }
+    }
+    //a ray through a corner hits both sides at it
+    std::sort(result.begin(), result.end());
+    auto last = std::unique(result.begin(), result.end(), [](double a, double b) { return b - a <= EPS; });
+    result.erase(last, result.end());
+    return result;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+#include "figures.h"
+
+// Axis-aligned rectangle, e.g. a query window. Like Polygon it is its
+// boundary as a Figure, while contains() and overlaps() see the region.
+// Segments are clipped with Liang–Barsky and circles tested in closed form
+// through the BoundingBox kernels, which the other figures reuse as their
+// prefilters.
+class Rectangle : public Figure
+{
+public:
+    // any two opposite corners
+    Rectangle(double x1, double y1, double x2, double y2);
+    explicit Rectangle(const BoundingBox &box) : box_(box) {}
+
+    const BoundingBox &box() const { return box_; }
+    double width() const { return box_.max_x() - box_.min_x(); }
+    double height() const { return box_.max_y() - box_.min_y(); }
+    double area() const { return width() * height(); }
+
+    double length() const override { return 2 * (width() + height()); }
+    BoundingBox bbox() const override { return box_; }
+
+    using Figure::intersect;
+    Points intersect(const Figure &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Segment &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Circle &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Polyline &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Polygon &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Rectangle &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Arc &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Bezier &other, std::pmr::memory_resource *resource) const override;
+
+    double distance(const Point &point) const override;
+    double distance(const Figure &other) const override;
+    double distance(const Segment &other) const override;
+    double distance(const Circle &other) const override;
+    double distance(const Polyline &other) const override;
+    double distance(const Polygon &other) const override;
+    double distance(const Rectangle &other) const override;
+    double distance(const Arc &other) const override;
+    double distance(const Bezier &other) const override;
+
+    double first_hit(const Ray &ray) const override;
+    Distances hits(const Ray &ray) const override;
+    bool encloses(const Point &point) const override { return box_.contains(point); }
+
+    // inside or on the boundary
+    bool contains(const Point &point) const { return box_.contains(point); }
+    // the figure lies inside without meeting the boundary
+    bool contains(const Figure &other) const;
+    // the figure meets the region: crosses the boundary, lies inside or, as
+    // a region, holds the rectangle
+    bool overlaps(const Figure &other) const;
+
+    // parts of the polyline inside the rectangle, in order
+    std::vector<Polyline> clip(const Polyline &polyline,
+                               std::pmr::memory_resource *resource = std::pmr::get_default_resource()) const;
+
+private:
+    // counterclockwise from the bottom side
+    Segment edge(int i) const;
+
+    BoundingBox box_;
+};
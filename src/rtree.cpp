@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include "rtree.h"
+
+namespace {
+
+// Sort-Tile-Recursive order: vertical slices by center x, each slice by center y
+template <typename Item>
+void sort_tiles(std::vector<Item> &items)
+{
+    auto center_x = [](const Item &item) { return item.box.min_x() + item.box.max_x(); };
+    auto center_y = [](const Item &item) { return item.box.min_y() + item.box.max_y(); };
+
+    std::sort(items.begin(), items.end(),
+              [&](const Item &a, const Item &b) { return center_x(a) < center_x(b); });
+
+    std::size_t node_count = (items.size() + RTree::NODE_CAPACITY - 1) / RTree::NODE_CAPACITY;
+    auto slice_count = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(node_count))));
+    std::size_t slice_size = slice_count * RTree::NODE_CAPACITY;
+
+    for (std::size_t start = 0; start < items.size(); start += slice_size) {
+        auto end = items.begin() + std::min(items.size(), start + slice_size);
+        std::sort(items.begin() + start, end,
+                  [&](const Item &a, const Item &b) { return center_y(a) < center_y(b); });
+    }
+}
+
+// groups consecutive items into parent nodes
+template <typename Item>
+std::vector<RTree::Node> pack(const std::vector<Item> &items, std::size_t offset, bool leaf)
+{
+    std::vector<RTree::Node> parents;
+    parents.reserve((items.size() + RTree::NODE_CAPACITY - 1) / RTree::NODE_CAPACITY);
+
+    for (std::size_t start = 0; start < items.size(); start += RTree::NODE_CAPACITY) {
+        std::size_t end = std::min(items.size(), start + RTree::NODE_CAPACITY);
+        RTree::Node node{};
+        for (std::size_t i = start; i < end; i++) {
+            node.box.expand(items[i].box);
+        }
+        node.first = static_cast<std::uint32_t>(offset + start);
+        node.count = static_cast<std::uint32_t>(end - start);
+        node.leaf = leaf ? 1 : 0;
+        parents.push_back(node);
+    }
+    return parents;
+}
+
+}//namespace
+
+RTree::RTree(std::vector<Entry> entries) : own_entries_(std::move(entries))
+{
+    if (!own_entries_.empty()) {
+        sort_tiles(own_entries_);
+        std::vector<Node> level = pack(own_entries_, 0, true);
+
+        while (level.size() > 1) {
+            sort_tiles(level);
+            std::size_t offset = own_nodes_.size();
+            own_nodes_.insert(own_nodes_.end(), level.begin(), level.end());
+            level = pack(level, offset, false);
+        }
+        own_nodes_.push_back(level.front());
+    }
+    rebind();
+}
+
+RTree::RTree(const RTree &other) : own_nodes_(other.own_nodes_), own_entries_(other.own_entries_)
+{
+    if (other.own_nodes_.empty()) {
+        nodes_ = other.nodes_;
+        node_count_ = other.node_count_;
+        entries_ = other.entries_;
+        entry_count_ = other.entry_count_;
+    } else {
+        rebind();
+    }
+}
+
+RTree::RTree(RTree &&other) noexcept
+    : own_nodes_(std::move(other.own_nodes_)), own_entries_(std::move(other.own_entries_)),
+      nodes_(other.nodes_), node_count_(other.node_count_),
+      entries_(other.entries_), entry_count_(other.entry_count_)
+{
+    other.nodes_ = nullptr;
+    other.node_count_ = 0;
+    other.entries_ = nullptr;
+    other.entry_count_ = 0;
+}
+
+RTree &RTree::operator=(const RTree &other)
+{
+    if (this != &other) {
+        RTree copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+RTree &RTree::operator=(RTree &&other) noexcept
+{
+    if (this != &other) {
+        own_nodes_ = std::move(other.own_nodes_);
+        own_entries_ = std::move(other.own_entries_);
+        nodes_ = other.nodes_;
+        node_count_ = other.node_count_;
+        entries_ = other.entries_;
+        entry_count_ = other.entry_count_;
+        other.nodes_ = nullptr;
+        other.node_count_ = 0;
+        other.entries_ = nullptr;
+        other.entry_count_ = 0;
+    }
+    return *this;
+}
+
+RTree RTree::view(const Node *nodes, std::size_t node_count, const Entry *entries, std::size_t entry_count)
+{
+    RTree tree;
+    tree.nodes_ = nodes;
+    tree.node_count_ = node_count;
+    tree.entries_ = entries;
+    tree.entry_count_ = entry_count;
+    return tree;
+}
+
+std::vector<std::size_t> RTree::query(const BoundingBox &box) const
+{
+    std::vector<std::size_t> result;
+    query(box, [&](std::size_t id) { result.push_back(id); });
+    return result;
+}
+
+bool RTree::is_valid(std::size_t figure_count) const
+{
+    // children come before their parent, so levels are known bottom-up
+    std::vector<std::uint8_t> depth(node_count_);
+    for (std::size_t i = 0; i < node_count_; i++) {
+        const Node &node = nodes_[i];
+        std::size_t limit = node.leaf ? entry_count_ : i;
+        if (node.count > NODE_CAPACITY || (!node.leaf && node.count == 0)
+                || node.first > limit || node.count > limit - node.first) {
+            return false;
+        }
+        depth[i] = 1;
+        if (!node.leaf) {
+            for (std::uint32_t child = node.first; child < node.first + node.count; child++) {
+                depth[i] = std::max<std::uint8_t>(depth[i], depth[child] + 1);
+            }
+            if (depth[i] > MAX_DEPTH) {
+                return false;
+            }
+        }
+    }
+    for (std::size_t i = 0; i < entry_count_; i++) {
+        if (entries_[i].id >= figure_count) {
+            return false;
+        }
+    }
+    return node_count_ > 0 || entry_count_ == 0;
+}
+
+void RTree::rebind()
+{
+    nodes_ = own_nodes_.data();
+    node_count_ = own_nodes_.size();
+    entries_ = own_entries_.data();
+    entry_count_ = own_entries_.size();
+}
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <vector>
+#include "figures.h"
+#include "ray.h"
+
+// Static R-tree packed with Sort-Tile-Recursive bulk loading. Nodes and
+// entries are flat arrays of plain records, so a tree can also be a view
+// over memory it does not own (e.g. a mapped scene file).
+class RTree
+{
+public:
+    static constexpr std::size_t NODE_CAPACITY = 16;
+    // levels of a valid tree, enough for 16^16 entries; bounds the fixed
+    // traversal stacks to NODE_CAPACITY pending nodes per level
+    static constexpr std::size_t MAX_DEPTH = 16;
+
+    struct Entry
+    {
+        BoundingBox box;
+        std::uint64_t id;
+    };
+
+    struct Neighbor
+    {
+        std::size_t id;
+        double distance;
+    };
+
+    struct Node
+    {
+        BoundingBox box;
+        // children are nodes[first, first + count) or entries[first, first + count) for leaves
+        std::uint32_t first;
+        std::uint32_t count;
+        std::uint32_t leaf;
+        std::uint32_t reserved;
+    };
+
+    RTree() = default;
+    explicit RTree(std::vector<Entry> entries);
+
+    RTree(const RTree &other);
+    RTree(RTree &&other) noexcept;
+    RTree &operator=(const RTree &other);
+    RTree &operator=(RTree &&other) noexcept;
+
+    // borrows the arrays, they must outlive the tree
+    static RTree view(const Node *nodes, std::size_t node_count,
+                      const Entry *entries, std::size_t entry_count);
+
+    std::size_t size() const { return entry_count_; }
+    bool empty() const { return entry_count_ == 0; }
+    BoundingBox bounds() const { return node_count_ > 0 ? root().box : BoundingBox(); }
+
+    const Node *nodes() const { return nodes_; }
+    std::size_t node_count() const { return node_count_; }
+    const Entry *entries() const { return entries_; }
+    std::size_t entry_count() const { return entry_count_; }
+
+    // structural check of a borrowed tree: nodes hold at most NODE_CAPACITY
+    // children, inner nodes at least one, child ranges stay in bounds and
+    // point to earlier nodes, the tree is at most MAX_DEPTH levels deep and
+    // ids are below figure_count
+    bool is_valid(std::size_t figure_count) const;
+
+    // root is the last node
+    const Node &root() const { return nodes_[node_count_ - 1]; }
+
+    // calls visit(id) for every entry whose box intersects the query box
+    template <typename Visitor>
+    void query(const BoundingBox &box, Visitor &&visit) const;
+
+    std::vector<std::size_t> query(const BoundingBox &box) const;
+
+    // calls visit(id) for every entry whose box the ray crosses
+    template <typename Visitor>
+    void query(const Ray &ray, Visitor &&visit) const;
+
+    // Front-to-back traversal for the nearest hit. hit(id) is the exact
+    // distance along the ray to an entry, HUGE_VAL for a miss; subtrees
+    // entered beyond the best hit so far are skipped.
+    template <typename Hit>
+    std::optional<RayHit> raycast(const Ray &ray, Hit &&hit) const;
+
+    // Nearest hits of up to PACKET_SIZE rays walking the tree together: a
+    // node is opened once for the whole packet when any of its rays can
+    // still improve on its best hit. hit(ray, id) is as above for rays[ray].
+    static constexpr std::size_t PACKET_SIZE = 8;
+    template <typename Hit>
+    void raycast(const Ray *rays, std::size_t count, Hit &&hit, std::optional<RayHit> *results) const;
+
+    // Best-first search for the k entries nearest to the point, closest
+    // first. distance(id) is the exact distance of an entry; subtrees and
+    // entries are visited in order of their bbox distance and pruned by it.
+    template <typename Distance>
+    std::vector<Neighbor> nearest(const Point &point, std::size_t k, Distance &&distance) const;
+
+private:
+    void rebind();
+
+    std::vector<Node> own_nodes_;
+    std::vector<Entry> own_entries_;
+    const Node *nodes_ = nullptr;
+    std::size_t node_count_ = 0;
+    const Entry *entries_ = nullptr;
+    std::size_t entry_count_ = 0;
+};
+
+template <typename Visitor>
+void RTree::query(const BoundingBox &box, Visitor &&visit) const
+{
+    if (node_count_ == 0) {
+        return;
+    }
+
+    // at most NODE_CAPACITY pending nodes per level
+    std::uint32_t stack[NODE_CAPACITY * MAX_DEPTH];
+    std::size_t top = 0;
+    stack[top++] = static_cast<std::uint32_t>(node_count_ - 1);
+
+    while (top > 0) {
+        const Node &node = nodes_[stack[--top]];
+        if (!node.box.intersects(box)) {
+            continue;
+        }
+        if (node.leaf) {
+            for (std::uint32_t i = node.first; i < node.first + node.count; i++) {
+                if (entries_[i].box.intersects(box)) {
+                    visit(static_cast<std::size_t>(entries_[i].id));
+                }
+            }
+        } else {
+            for (std::uint32_t i = node.first; i < node.first + node.count; i++) {
+                stack[top++] = i;
+            }
+        }
+    }
+}
+
+template <typename Visitor>
+void RTree::query(const Ray &ray, Visitor &&visit) const
+{
+    if (node_count_ == 0) {
+        return;
+    }
+
+    std::uint32_t stack[NODE_CAPACITY * MAX_DEPTH];
+    std::size_t top = 0;
+    stack[top++] = static_cast<std::uint32_t>(node_count_ - 1);
+
+    while (top > 0) {
+        const Node &node = nodes_[stack[--top]];
+        if (ray.enter(node.box, HUGE_VAL) == HUGE_VAL) {
+            continue;
+        }
+        if (node.leaf) {
+            for (std::uint32_t i = node.first; i < node.first + node.count; i++) {
+                if (ray.enter(entries_[i].box, HUGE_VAL) < HUGE_VAL) {
+                    visit(static_cast<std::size_t>(entries_[i].id));
+                }
+            }
+        } else {
+            for (std::uint32_t i = node.first; i < node.first + node.count; i++) {
+                stack[top++] = i;
+            }
+        }
+    }
+}
+
+template <typename Hit>
+std::optional<RayHit> RTree::raycast(const Ray &ray, Hit &&hit) const
+{
+    struct Candidate
+    {
+        double distance;
+        std::uint32_t node;
+
+        bool operator>(const Candidate &other) const { return distance > other.distance; }
+    };
+
+    std::optional<RayHit> result;
+    if (node_count_ == 0) {
+        return result;
+    }
+
+    double best = HUGE_VAL;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+    double enter = ray.enter(root().box, best);
+    if (enter < HUGE_VAL) {
+        queue.push({enter, static_cast<std::uint32_t>(node_count_ - 1)});
+    }
+
+    while (!queue.empty() && queue.top().distance <= best) {
+        const Node &node = nodes_[queue.top().node];
+        queue.pop();
+
+        for (std::uint32_t i = node.first; i < node.first + node.count; i++) {
+            if (node.leaf) {
+                if (ray.enter(entries_[i].box, best) == HUGE_VAL) {
+                    continue;
+                }
+                std::size_t id = static_cast<std::size_t>(entries_[i].id);
+                double distance = hit(id);
+                if (distance < HUGE_VAL && (!result || distance < best || (distance == best && id < result->id))) {
+                    best = distance;
+                    result = RayHit{id, distance};
+                }
+            } else {
+                enter = ray.enter(nodes_[i].box, best);
+                if (enter < HUGE_VAL) {
+                    queue.push({enter, i});
+                }
+            }
+        }
+    }
+    return result;
+}
+
+template <typename Hit>
+void RTree::raycast(const Ray *rays, std::size_t count, Hit &&hit, std::optional<RayHit> *results) const
+{
+    std::fill(results, results + count, std::nullopt);
+    if (node_count_ == 0) {
+        return;
+    }
+
+    for (std::size_t first = 0; first < count; first += PACKET_SIZE) {
+        std::size_t size = std::min(PACKET_SIZE, count - first);
+
+        //structure of arrays so the slab tests of a packet vectorize
+        double origin_x[PACKET_SIZE], origin_y[PACKET_SIZE];
+        double inverse_x[PACKET_SIZE], inverse_y[PACKET_SIZE];
+        double best[PACKET_SIZE];
+        bool active[PACKET_SIZE];
+        for (std::size_t r = 0; r < size; r++) {
+            const Ray &ray = rays[first + r];
+            origin_x[r] = ray.origin().x();
+            origin_y[r] = ray.origin().y();
+            inverse_x[r] = 1 / ray.dx();
+            inverse_y[r] = 1 / ray.dy();
+            best[r] = ray.max_distance();
+        }
+
+        // marks the rays entering the box before their best hit
+        auto enter = [&](const BoundingBox &box) {
+            bool any = false;
+            for (std::size_t r = 0; r < size; r++) {
+                double tx1 = (box.min_x() - EPS - origin_x[r]) * inverse_x[r];
+                double tx2 = (box.max_x() + EPS - origin_x[r]) * inverse_x[r];
+                double ty1 = (box.min_y() - EPS - origin_y[r]) * inverse_y[r];
+                double ty2 = (box.max_y() + EPS - origin_y[r]) * inverse_y[r];
+                double near = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)), 0.0);
+                double far = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)), best[r]);
+                active[r] = near <= far;
+                any |= active[r];
+            }
+            return any;
+        };
+
+        std::uint32_t stack[NODE_CAPACITY * MAX_DEPTH];
+        std::size_t top = 0;
+        stack[top++] = static_cast<std::uint32_t>(node_count_ - 1);
+
+        while (top > 0) {
+            const Node &node = nodes_[stack[--top]];
+            if (!enter(node.box)) {
+                continue;
+            }
+            if (!node.leaf) {
+                for (std::uint32_t i = node.first; i < node.first + node.count; i++) {
+                    stack[top++] = i;
+                }
+                continue;
+            }
+            for (std::uint32_t i = node.first; i < node.first + node.count; i++) {
+                if (!enter(entries_[i].box)) {
+                    continue;
+                }
+                std::size_t id = static_cast<std::size_t>(entries_[i].id);
+                for (std::size_t r = 0; r < size; r++) {
+                    if (!active[r]) {
+                        continue;
+                    }
+                    double distance = hit(first + r, id);
+                    std::optional<RayHit> &result = results[first + r];
+                    if (distance < HUGE_VAL
+                            && (!result || distance < best[r] || (distance == best[r] && id < result->id))) {
+                        best[r] = distance;
+                        result = RayHit{id, distance};
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <typename Distance>
+std::vector<RTree::Neighbor> RTree::nearest(const Point &point, std::size_t k, Distance &&distance) const
+{
+    enum Kind { NODE, ENTRY, EXACT };
+    struct Candidate
+    {
+        double distance;
+        Kind kind;
+        std::size_t index;
+
+        bool operator>(const Candidate &other) const { return distance > other.distance; }
+    };
+
+    std::vector<Neighbor> result;
+    if (node_count_ == 0 || k == 0) {
+        return result;
+    }
+
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+    queue.push({root().box.distance(point), NODE, node_count_ - 1});
+
+    while (!queue.empty() && result.size() < k) {
+        Candidate candidate = queue.top();
+        queue.pop();
+
+        if (candidate.kind == EXACT) {
+            result.push_back({candidate.index, candidate.distance});
+        } else if (candidate.kind == ENTRY) {
+            std::size_t id = static_cast<std::size_t>(entries_[candidate.index].id);
+            queue.push({distance(id), EXACT, id});
+        } else {
+            const Node &node = nodes_[candidate.index];
+            for (std::uint32_t i = node.first; i < node.first + node.count; i++) {
+                const BoundingBox &box = node.leaf ? entries_[i].box : nodes_[i].box;
+                queue.push({box.distance(point), node.leaf ? ENTRY : NODE, i});
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include "scene.h"
+
+std::size_t Scene::add(const Segment &segment)
+{
+    segments_.push_back(segment);
+    return add_ref(Kind::SEGMENT, segments_.size() - 1, segments_.back());
+}
+
+std::size_t Scene::add(const Circle &circle)
+{
+    circles_.push_back(circle);
+    return add_ref(Kind::CIRCLE, circles_.size() - 1, circles_.back());
+}
+
+std::size_t Scene::add(const Polyline &polyline)
+{
+    polylines_.push_back(polyline);
+    return add_ref(Kind::POLYLINE, polylines_.size() - 1, polylines_.back());
+}
+
+std::size_t Scene::add(Polyline &&polyline)
+{
+    polylines_.push_back(std::move(polyline));
+    return add_ref(Kind::POLYLINE, polylines_.size() - 1, polylines_.back());
+}
+
+std::size_t Scene::add(std::unique_ptr<Figure> figure)
+{
+    others_.push_back(std::move(figure));
+    return add_ref(Kind::OTHER, others_.size() - 1, *others_.back());
+}
+
+void Scene::reserve(std::size_t count)
+{
+    figures_.reserve(figures_.size() + count);
+    refs_.reserve(refs_.size() + count);
+}
+
+std::size_t Scene::add_ref(Kind kind, std::size_t index, const Figure &figure)
+{
+    figures_.push_back(&figure);
+    refs_.push_back({kind, index});
+    return figures_.size() - 1;
+}
+
+void Scene::build_index()
+{
+    std::vector<RTree::Entry> entries;
+    entries.reserve(figures_.size());
+    for (std::size_t id = 0; id < figures_.size(); id++) {
+        entries.push_back({figures_[id]->bbox(), id});
+    }
+    index_ = RTree(std::move(entries));
+}
+
+std::vector<RTree::Neighbor> Scene::nearest(const Point &point, std::size_t k) const
+{
+    return index_.nearest(point, k, [&](std::size_t id) { return figures_[id]->distance(point); });
+}
+
+std::optional<RayHit> Scene::first_hit(const Ray &ray) const
+{
+    return index_.raycast(ray, [&](std::size_t id) { return figures_[id]->first_hit(ray); });
+}
+
+std::vector<RayHit> Scene::hits(const Ray &ray) const
+{
+    std::vector<RayHit> result;
+    index_.query(ray, [&](std::size_t id) {
+        for (double distance : figures_[id]->hits(ray)) {
+            result.push_back({id, distance});
+        }
+    });
+    std::sort(result.begin(), result.end(), [](const RayHit &a, const RayHit &b) {
+        return a.distance < b.distance || (a.distance == b.distance && a.id < b.id);
+    });
+    return result;
+}
+
+std::vector<std::optional<RayHit>> Scene::first_hits(const std::vector<Ray> &rays) const
+{
+    std::vector<std::optional<RayHit>> result(rays.size());
+    index_.raycast(rays.data(), rays.size(), [&](std::size_t ray, std::size_t id) {
+        return figures_[id]->first_hit(rays[ray]);
+    }, result.data());
+    return result;
+}
+
+std::optional<Contact> Scene::first_contact(const SweptCircle &swept) const
+{
+    std::optional<Contact> result;
+    index_.query(swept.bbox(), [&](std::size_t id) {
+        double time;
+        switch (refs_[id].kind) {
+        case Kind::SEGMENT:
+            time = time_of_contact(swept, segment(id));
+            break;
+        case Kind::CIRCLE:
+            time = time_of_contact(swept, circle(id));
+            break;
+        case Kind::POLYLINE:
+            time = time_of_contact(swept, polyline(id));
+            break;
+        default:
+            time = time_of_contact(swept, *figures_[id]);
+        }
+        if (time != HUGE_VAL && (!result || time < result->time || (time == result->time && id < result->id))) {
+            result = Contact{id, time};
+        }
+    });
+    return result;
+}
+
+std::vector<std::optional<Contact>> Scene::first_contacts(const std::vector<SweptCircle> &swept) const
+{
+    std::vector<std::optional<Contact>> result;
+    result.reserve(swept.size());
+    for (const auto &circle : swept) {
+        result.push_back(first_contact(circle));
+    }
+    return result;
+}
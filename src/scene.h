@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "collision.h"
+#include "figures.h"
+#include "rtree.h"
+
+// Collection of figures addressed by id (insertion order). Segments, circles
+// and polylines are kept in per-type tables, so adding them does not
+// allocate per figure; other figure types are owned through pointers.
+class Scene
+{
+public:
+    enum class Kind { SEGMENT, CIRCLE, POLYLINE, OTHER };
+
+    Scene() = default;
+    Scene(const Scene &) = delete;
+    Scene &operator=(const Scene &) = delete;
+    Scene(Scene &&) = default;
+    Scene &operator=(Scene &&) = default;
+
+    std::size_t add(const Segment &segment);
+    std::size_t add(const Circle &circle);
+    // a PolylineView stays a view
+    std::size_t add(const Polyline &polyline);
+    std::size_t add(Polyline &&polyline);
+    std::size_t add(std::unique_ptr<Figure> figure);
+    // room for count more figures in the id tables
+    void reserve(std::size_t count);
+
+    std::size_t size() const { return figures_.size(); }
+    bool empty() const { return figures_.empty(); }
+    const Figure &operator[](std::size_t id) const { return *figures_[id]; }
+
+    Kind kind(std::size_t id) const { return refs_[id].kind; }
+    const Segment &segment(std::size_t id) const { return segments_[refs_[id].index]; }
+    const Circle &circle(std::size_t id) const { return circles_[refs_[id].index]; }
+    const Polyline &polyline(std::size_t id) const { return polylines_[refs_[id].index]; }
+
+    void build_index();
+    void set_index(RTree index) { index_ = std::move(index); }
+    const RTree &index() const { return index_; }
+    bool has_index() const { return !index_.empty(); }
+
+    // k figures nearest to the point through the index, closest first
+    std::vector<RTree::Neighbor> nearest(const Point &point, std::size_t k) const;
+
+    // ray queries through the index: the nearest hit, or every hit ordered
+    // by distance (then id)
+    std::optional<RayHit> first_hit(const Ray &ray) const;
+    std::vector<RayHit> hits(const Ray &ray) const;
+    // nearest hits of a bundle of rays, traversed in packets; suits coherent
+    // rays such as a fan from one origin
+    std::vector<std::optional<RayHit>> first_hits(const std::vector<Ray> &rays) const;
+
+    // Earliest figure the moving circle touches during the step (ties go to
+    // the lower id), through the index with the swept box. See
+    // time_of_contact() for the supported figure types.
+    std::optional<Contact> first_contact(const SweptCircle &swept) const;
+    // one query per moving circle, e.g. every agent for a tick
+    std::vector<std::optional<Contact>> first_contacts(const std::vector<SweptCircle> &swept) const;
+
+private:
+    struct Ref
+    {
+        Kind kind;
+        std::size_t index;
+    };
+
+    std::size_t add_ref(Kind kind, std::size_t index, const Figure &figure);
+
+    std::deque<Segment> segments_;
+    std::deque<Circle> circles_;
+    std::deque<Polyline> polylines_;
+    std::vector<std::unique_ptr<Figure>> others_;
+
+    std::vector<const Figure *> figures_;
+    std::vector<Ref> refs_;
+    RTree index_;
+};
@@ -0,0 +1,261 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include "scene_file.h"
+
+namespace {
+
+const char SCENE_MAGIC[8] = {'F', 'I', 'G', 'S', 'C', 'E', 'N', 'E'};
+const std::uint32_t SCENE_VERSION = 1;
+const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+const std::size_t SECTION_ALIGNMENT = 64;
+
+struct Section
+{
+    std::uint64_t offset;
+    std::uint64_t count;
+};
+
+struct Header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint64_t file_size;
+    Section segments;
+    Section circles;
+    Section polylines;
+    Section points;
+    Section figures;
+    Section index_nodes;
+    Section index_entries;
+};
+
+struct SegmentRecord
+{
+    double x1, y1, x2, y2;
+};
+
+struct CircleRecord
+{
+    double x, y, radius;
+};
+
+struct PolylineRecord
+{
+    std::uint64_t first_point;
+    std::uint64_t point_count;
+    BoundingBox bbox;
+};
+
+struct FigureRecord
+{
+    std::uint32_t kind;
+    std::uint32_t reserved;
+    std::uint64_t index;
+};
+
+class SectionWriter
+{
+public:
+    explicit SectionWriter(std::ofstream &out) : out_(out) {}
+
+    template <typename Record>
+    Section write(const Record *records, std::size_t count)
+    {
+        pad();
+        Section section{offset_, count};
+        write_bytes(records, count * sizeof(Record));
+        return section;
+    }
+
+    template <typename Record>
+    Section write(const std::vector<Record> &records)
+    {
+        return write(records.data(), records.size());
+    }
+
+    void write_bytes(const void *data, std::size_t size)
+    {
+        out_.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+        offset_ += size;
+    }
+
+    std::uint64_t offset() const { return offset_; }
+
+private:
+    void pad()
+    {
+        static const char zeros[SECTION_ALIGNMENT] = {};
+        std::size_t padding = (SECTION_ALIGNMENT - offset_ % SECTION_ALIGNMENT) % SECTION_ALIGNMENT;
+        write_bytes(zeros, padding);
+    }
+
+    std::ofstream &out_;
+    std::uint64_t offset_ = 0;
+};
+
+void fail(const std::string &what)
+{
+    throw std::runtime_error("scene file: " + what);
+}
+
+template <typename Record>
+const Record *section_data(const MappedFile &file, const Section &section, const char *name)
+{
+    if (section.count == 0) {
+        return nullptr;
+    }
+    if (section.offset % SECTION_ALIGNMENT != 0
+            || section.offset > file.size()
+            || section.count > (file.size() - section.offset) / sizeof(Record)) {
+        fail(std::string("bad ") + name + " section");
+    }
+    return reinterpret_cast<const Record *>(file.data() + section.offset);
+}
+
+}//namespace
+
+void write_scene(const Scene &scene, const std::string &path)
+{
+    std::vector<SegmentRecord> segments;
+    std::vector<CircleRecord> circles;
+    std::vector<PolylineRecord> polylines;
+    std::vector<Point> points;
+    std::vector<FigureRecord> figures;
+
+    figures.reserve(scene.size());
+    for (std::size_t id = 0; id < scene.size(); id++) {
+        switch (scene.kind(id)) {
+        case Scene::Kind::SEGMENT: {
+            const Segment &segment = scene.segment(id);
+            figures.push_back({static_cast<std::uint32_t>(Scene::Kind::SEGMENT), 0, segments.size()});
+            segments.push_back({segment.start().x(), segment.start().y(), segment.end().x(), segment.end().y()});
+            break;
+        }
+        case Scene::Kind::CIRCLE: {
+            const Circle &circle = scene.circle(id);
+            figures.push_back({static_cast<std::uint32_t>(Scene::Kind::CIRCLE), 0, circles.size()});
+            circles.push_back({circle.center().x(), circle.center().y(), circle.radius()});
+            break;
+        }
+        case Scene::Kind::POLYLINE: {
+            const Polyline &polyline = scene.polyline(id);
+            figures.push_back({static_cast<std::uint32_t>(Scene::Kind::POLYLINE), 0, polylines.size()});
+            polylines.push_back({points.size(), polyline.size(), polyline.bbox()});
+            points.insert(points.end(), polyline.begin(), polyline.end());
+            break;
+        }
+        default:
+            throw std::invalid_argument("scene file: unsupported figure type");
+        }
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        fail("cannot open " + path);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, SCENE_MAGIC, sizeof(SCENE_MAGIC));
+    header.version = SCENE_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+
+    SectionWriter writer(out);
+    writer.write_bytes(&header, sizeof(header));
+    header.segments = writer.write(segments);
+    header.circles = writer.write(circles);
+    header.polylines = writer.write(polylines);
+    header.points = writer.write(points);
+    header.figures = writer.write(figures);
+
+    if (scene.has_index()) {
+        const RTree &index = scene.index();
+        header.index_nodes = writer.write(index.nodes(), index.node_count());
+        header.index_entries = writer.write(index.entries(), index.entry_count());
+    }
+    header.file_size = writer.offset();
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (!out) {
+        fail("cannot write " + path);
+    }
+}
+
+MappedScene::MappedScene(const std::string &path) : file_(path)
+{
+    Header header{};
+    if (file_.size() < sizeof(header)) {
+        fail("truncated header");
+    }
+    std::memcpy(&header, file_.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, SCENE_MAGIC, sizeof(SCENE_MAGIC)) != 0) {
+        fail("not a scene file");
+    }
+    if (header.version != SCENE_VERSION) {
+        fail("unsupported version " + std::to_string(header.version));
+    }
+    if (header.byte_order != BYTE_ORDER_MARK) {
+        fail("byte order mismatch");
+    }
+    if (header.file_size != file_.size()) {
+        fail("size mismatch");
+    }
+
+    auto segments = section_data<SegmentRecord>(file_, header.segments, "segments");
+    auto circles = section_data<CircleRecord>(file_, header.circles, "circles");
+    auto polylines = section_data<PolylineRecord>(file_, header.polylines, "polylines");
+    auto points = section_data<Point>(file_, header.points, "points");
+    auto figures = section_data<FigureRecord>(file_, header.figures, "figures");
+
+    scene_.reserve(header.figures.count);
+    for (std::uint64_t i = 0; i < header.figures.count; i++) {
+        const FigureRecord &figure = figures[i];
+        switch (static_cast<Scene::Kind>(figure.kind)) {
+        case Scene::Kind::SEGMENT: {
+            if (figure.index >= header.segments.count) {
+                fail("bad segment reference");
+            }
+            const SegmentRecord &record = segments[figure.index];
+            scene_.add(Segment(record.x1, record.y1, record.x2, record.y2));
+            break;
+        }
+        case Scene::Kind::CIRCLE: {
+            if (figure.index >= header.circles.count) {
+                fail("bad circle reference");
+            }
+            const CircleRecord &record = circles[figure.index];
+            scene_.add(Circle(record.x, record.y, record.radius));
+            break;
+        }
+        case Scene::Kind::POLYLINE: {
+            if (figure.index >= header.polylines.count) {
+                fail("bad polyline reference");
+            }
+            const PolylineRecord &record = polylines[figure.index];
+            if (record.first_point > header.points.count
+                    || record.point_count > header.points.count - record.first_point) {
+                fail("bad polyline points");
+            }
+            scene_.add(PolylineView(points + record.first_point, record.point_count, record.bbox));
+            break;
+        }
+        default:
+            fail("bad figure kind");
+        }
+    }
+
+    if (header.index_nodes.count > 0) {
+        auto nodes = section_data<RTree::Node>(file_, header.index_nodes, "index nodes");
+        auto entries = section_data<RTree::Entry>(file_, header.index_entries, "index entries");
+        RTree index = RTree::view(nodes, header.index_nodes.count, entries, header.index_entries.count);
+        if (!index.is_valid(header.figures.count)) {
+            fail("bad index");
+        }
+        scene_.set_index(std::move(index));
+    }
+}
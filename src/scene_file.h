@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include "mapped_file.h"
+#include "scene.h"
+
+// Binary scene file, native byte order. Sections follow the header, each
+// aligned to 64 bytes and addressed by its offset from the file start:
+//   header | segments | circles | polylines | points | figures | [index nodes | index entries]
+// Polyline coordinates are stored as packed (x, y) double pairs.
+
+// The scene index is written when the scene has one. Throws
+// std::invalid_argument for figure types the format does not cover.
+void write_scene(const Scene &scene, const std::string &path);
+
+// Scene over a mapped scene file: polylines are views into the mapping and
+// the index section, when present, is used as is. Segments and circles are
+// built from their records when the file is opened: as Figures they carry a
+// vtable pointer, which a file cannot hold, and a record is already all the
+// object holds besides it. Throws std::runtime_error on malformed files.
+class MappedScene
+{
+public:
+    explicit MappedScene(const std::string &path);
+
+    const Scene &scene() const { return scene_; }
+    Scene &scene() { return scene_; }
+
+private:
+    MappedFile file_;
+    Scene scene_;
+};
@@ -0,0 +1,128 @@
+#include "scene_source.h"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include "csv_loader.h"
+#include "transform.h"
+
+namespace {
+
+bool ends_with(const std::string &text, const char *suffix)
+{
+    std::size_t length = std::strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+void add_current(WktReader &reader, Scene &scene)
+{
+    switch (reader.kind()) {
+    case Scene::Kind::CIRCLE:
+        scene.add(reader.circle());
+        break;
+    case Scene::Kind::POLYLINE:
+        scene.add(Polyline(std::pmr::vector<Point>(reader.polyline().begin(), reader.polyline().end())));
+        break;
+    case Scene::Kind::OTHER:
+        scene.add(reader.release_other());
+        break;
+    default:
+        scene.add(reader.segment());
+        break;
+    }
+}
+
+}//namespace
+
+InputFormat detect_format(const std::string &path, InputFormat format)
+{
+    if (format != InputFormat::AUTO) {
+        return format;
+    }
+    if (ends_with(path, ".bin")) {
+        return InputFormat::BIN;
+    }
+    if (ends_with(path, ".csv") || ends_with(path, ".tsv")) {
+        return InputFormat::CSV;
+    }
+    return InputFormat::WKT;
+}
+
+void copy_figure(const Scene &from, std::size_t id, Scene &to)
+{
+    switch (from.kind(id)) {
+    case Scene::Kind::SEGMENT:
+        to.add(from.segment(id));
+        break;
+    case Scene::Kind::CIRCLE:
+        to.add(from.circle(id));
+        break;
+    case Scene::Kind::POLYLINE:
+        to.add(from.polyline(id));
+        break;
+    default:
+        to.add(transform(from[id], Affine()));
+        break;
+    }
+}
+
+SceneSource::SceneSource(const std::vector<std::string> &inputs, InputFormat format)
+    : inputs_(inputs), format_(format)
+{
+    if (inputs_.empty()) {
+        inputs_.emplace_back("-");
+    }
+}
+
+bool SceneSource::next(std::size_t count, Scene &batch)
+{
+    batch = Scene();
+    while (batch.size() < count) {
+        if (reader_) {
+            if (reader_->next()) {
+                add_current(*reader_, batch);
+                continue;
+            }
+            reader_.reset();
+            file_.reset();
+        } else if (scene_ != nullptr && scene_position_ < scene_->size()) {
+            copy_figure(*scene_, scene_position_++, batch);
+            continue;
+        } else if (!open_next()) {
+            break;
+        }
+    }
+    return !batch.empty();
+}
+
+bool SceneSource::open_next()
+{
+    scene_ = nullptr;
+    if (next_input_ == inputs_.size()) {
+        return false;
+    }
+    const std::string &path = inputs_[next_input_++];
+    switch (path == "-" ? InputFormat::WKT : detect_format(path, format_)) {
+    case InputFormat::BIN:
+        mapped_.push_back(std::make_unique<MappedScene>(path));
+        scene_ = &mapped_.back()->scene();
+        break;
+    case InputFormat::CSV:
+        loaded_ = load_csv(path);
+        scene_ = &loaded_;
+        break;
+    default:
+        if (path == "-") {
+            reader_ = std::make_unique<WktReader>(std::cin);
+        } else {
+            file_ = std::make_unique<std::ifstream>(path);
+            if (!*file_) {
+                throw std::runtime_error("cannot open " + path);
+            }
+            reader_ = std::make_unique<WktReader>(*file_);
+        }
+        break;
+    }
+    scene_position_ = 0;
+    return true;
+}
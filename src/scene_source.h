@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "scene.h"
+#include "scene_file.h"
+#include "wkt.h"
+
+enum class InputFormat { AUTO, WKT, BIN, CSV };
+
+// The given format, or for AUTO the one of the file extension: .bin, .csv
+// and .tsv, WKT otherwise.
+InputFormat detect_format(const std::string &path, InputFormat format);
+
+// Copies a figure between scenes, views stay views: the file they point
+// into must stay mapped while the copy is used. Figures of kind OTHER are
+// copied with transform() and the identity matrix.
+void copy_figure(const Scene &from, std::size_t id, Scene &to);
+
+// Figures of all inputs in order, handed out in bounded batches; "-" reads
+// WKT from stdin. WKT is streamed, binary scenes are mapped and CSV feeds
+// are bulk loaded. Batch polylines from binary scenes view the mapped
+// files, which stay mapped as long as the source or whoever takes them over
+// with take_mappings().
+class SceneSource
+{
+public:
+    SceneSource(const std::vector<std::string> &inputs, InputFormat format);
+
+    // replaces batch with up to count figures, false when the input is exhausted
+    bool next(std::size_t count, Scene &batch);
+
+    // the mapped binary inputs, for figures copied out of the batches
+    std::vector<std::unique_ptr<MappedScene>> take_mappings() { return std::move(mapped_); }
+
+private:
+    bool open_next();
+
+    std::vector<std::string> inputs_;
+    InputFormat format_;
+    std::size_t next_input_ = 0;
+
+    std::unique_ptr<std::ifstream> file_;
+    std::unique_ptr<WktReader> reader_;
+    std::vector<std::unique_ptr<MappedScene>> mapped_;
+    Scene loaded_;
+    const Scene *scene_ = nullptr;
+    std::size_t scene_position_ = 0;
+};
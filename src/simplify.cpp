@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <utility>
+#include "simplify.h"
+
+namespace {
+
+std::vector<std::size_t> douglas_peucker(const Point *points, std::size_t size, double tolerance)
+{
+    std::vector<std::size_t> result;
+    if (size <= 2) {
+        for (std::size_t i = 0; i < size; i++) {
+            result.push_back(i);
+        }
+        return result;
+    }
+
+    std::vector<bool> kept(size, false);
+    kept[0] = kept[size - 1] = true;
+
+    std::vector<std::pair<std::size_t, std::size_t>> stack;
+    stack.emplace_back(0, size - 1);
+    while (!stack.empty()) {
+        auto range = stack.back();
+        stack.pop_back();
+
+        Segment chord(points[range.first], points[range.second]);
+        double farthest = -1;
+        std::size_t split = range.first;
+        for (std::size_t i = range.first + 1; i < range.second; i++) {
+            double distance = chord.distance(points[i]);
+            if (distance > farthest) {
+                farthest = distance;
+                split = i;
+            }
+        }
+        if (farthest > tolerance) {
+            kept[split] = true;
+            stack.emplace_back(range.first, split);
+            stack.emplace_back(split, range.second);
+        }
+    }
+
+    for (std::size_t i = 0; i < size; i++) {
+        if (kept[i]) {
+            result.push_back(i);
+        }
+    }
+    return result;
+}
+
+double triangle_area(const Point &a, const Point &b, const Point &c)
+{
+    return fabs((b.x() - a.x()) * (c.y() - a.y()) - (c.x() - a.x()) * (b.y() - a.y())) / 2;
+}
+
+}//namespace
+
+std::vector<std::size_t> douglas_peucker(const Polyline &polyline, double tolerance)
+{
+    return douglas_peucker(polyline.begin(), polyline.size(), tolerance);
+}
+
+std::vector<std::size_t> visvalingam(const Polyline &polyline, double min_area)
+{
+    std::size_t size = polyline.size();
+    std::vector<std::size_t> result;
+    if (size <= 2) {
+        for (std::size_t i = 0; i < size; i++) {
+            result.push_back(i);
+        }
+        return result;
+    }
+
+    // vertices left form a linked list, stale heap entries are skipped by
+    // comparing their area with the current one
+    std::vector<std::size_t> previous(size), next(size);
+    std::vector<double> areas(size, HUGE_VAL);
+    std::vector<bool> removed(size, false);
+
+    using Candidate = std::pair<double, std::size_t>;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> heap;
+    for (std::size_t i = 0; i < size; i++) {
+        previous[i] = i - 1;
+        next[i] = i + 1;
+        if (i > 0 && i + 1 < size) {
+            areas[i] = triangle_area(polyline[i - 1], polyline[i], polyline[i + 1]);
+            heap.emplace(areas[i], i);
+        }
+    }
+
+    double last_area = 0;
+    while (!heap.empty() && heap.top().first < min_area) {
+        Candidate candidate = heap.top();
+        heap.pop();
+        std::size_t i = candidate.second;
+        if (removed[i] || candidate.first != areas[i]) {
+            continue;
+        }
+
+        removed[i] = true;
+        // an area never drops below the one removed before it, so the
+        // order stays that of increasing significance
+        last_area = std::max(last_area, candidate.first);
+        std::size_t before = previous[i];
+        std::size_t after = next[i];
+        next[before] = after;
+        previous[after] = before;
+
+        for (std::size_t neighbor : {before, after}) {
+            if (neighbor == 0 || neighbor == size - 1) {
+                continue;
+            }
+            areas[neighbor] = std::max(last_area, triangle_area(polyline[previous[neighbor]], polyline[neighbor],
+                                                                polyline[next[neighbor]]));
+            heap.emplace(areas[neighbor], neighbor);
+        }
+    }
+
+    for (std::size_t i = 0; i < size; i++) {
+        if (!removed[i]) {
+            result.push_back(i);
+        }
+    }
+    return result;
+}
+
+Polyline simplify(const Polyline &polyline, double tolerance, std::pmr::memory_resource *resource)
+{
+    std::pmr::vector<Point> points(resource);
+    for (std::size_t i : douglas_peucker(polyline, tolerance)) {
+        points.push_back(polyline[i]);
+    }
+    return Polyline(std::move(points));
+}
+
+//PolylinePyramid
+PolylinePyramid::PolylinePyramid(const Polyline &source, double base_tolerance, std::size_t max_levels)
+    : source_(source)
+{
+    std::vector<Point> points(source.begin(), source.end());
+    std::vector<std::size_t> vertices;
+    for (std::size_t i = 0; i < source.size(); i++) {
+        vertices.push_back(i);
+    }
+
+    double tolerance = base_tolerance > 0 ? base_tolerance : EPS;
+    while (levels_.size() < max_levels && vertices.size() > 2) {
+        std::vector<std::size_t> kept = douglas_peucker(points.data(), points.size(), tolerance);
+        if (kept.size() == points.size()) {
+            tolerance *= 2;
+            continue;
+        }
+
+        std::vector<Point> level_points;
+        std::vector<std::size_t> level_vertices;
+        for (std::size_t i : kept) {
+            level_points.push_back(points[i]);
+            level_vertices.push_back(vertices[i]);
+        }
+        Level level{Polyline(level_points), std::move(level_vertices), {}, 0};
+
+        //deviations against the source, not the level below
+        for (std::size_t k = 0; k + 1 < level.vertices.size(); k++) {
+            Segment segment(source[level.vertices[k]], source[level.vertices[k + 1]]);
+            double deviation = 0;
+            for (std::size_t i = level.vertices[k] + 1; i < level.vertices[k + 1]; i++) {
+                deviation = std::max(deviation, segment.distance(source[i]));
+            }
+            level.deviations.push_back(deviation);
+            level.tolerance = std::max(level.tolerance, deviation);
+        }
+
+        points = std::move(level_points);
+        vertices = level.vertices;
+        levels_.push_back(std::move(level));
+        tolerance *= 2;
+    }
+}
+
+Points PolylinePyramid::intersect(const Figure &other, std::pmr::memory_resource *resource) const
+{
+    Points result(resource);
+    BoundingBox other_box = other.bbox();
+    if (levels_.empty()) {
+        for (std::size_t i = 0; i + 1 < source_.size(); i++) {
+            refine(0, i, other, other_box, result);
+        }
+        return result;
+    }
+
+    const Level &coarsest = levels_.back();
+    for (std::size_t k = 0; k + 1 < coarsest.vertices.size(); k++) {
+        refine(levels_.size(), k, other, other_box, result);
+    }
+    return result;
+}
+
+// level 0 is the source, level i > 0 is levels_[i - 1]
+void PolylinePyramid::refine(std::size_t level, std::size_t segment, const Figure &other,
+                             const BoundingBox &other_box, Points &result) const
+{
+    if (level == 0) {
+        Segment piece(source_[segment], source_[segment + 1]);
+        if (piece.bbox().intersects(other_box)) {
+            Points points = other.intersect(piece, result.get_allocator().resource());
+            result.insert(result.end(), points.begin(), points.end());
+        }
+        return;
+    }
+
+    const Level &current = levels_[level - 1];
+    std::size_t first = current.vertices[segment];
+    std::size_t last = current.vertices[segment + 1];
+    double deviation = current.deviations[segment];
+
+    Segment coarse(source_[first], source_[last]);
+    BoundingBox box = coarse.bbox();
+    box = BoundingBox(box.min_x() - deviation, box.min_y() - deviation,
+                      box.max_x() + deviation, box.max_y() + deviation);
+    if (!box.intersects(other_box) || other.distance(coarse) > deviation + EPS) {
+        return;
+    }
+
+    //finer segments covering [first, last]
+    if (level == 1) {
+        for (std::size_t i = first; i < last; i++) {
+            refine(0, i, other, other_box, result);
+        }
+        return;
+    }
+    const auto &finer = levels_[level - 2].vertices;
+    std::size_t k = std::lower_bound(finer.begin(), finer.end(), first) - finer.begin();
+    for (; k + 1 < finer.size() && finer[k] < last; k++) {
+        refine(level - 1, k, other, other_box, result);
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+#include "figures.h"
+
+// Polyline simplification. Both algorithms return the indices of the kept
+// vertices in order, always including both ends.
+
+// Douglas–Peucker: every dropped vertex stays within tolerance of the
+// segment replacing it. Iterative, O(n log n) for typical tracks and
+// O(n^2) only for adversarial spirals.
+std::vector<std::size_t> douglas_peucker(const Polyline &polyline, double tolerance);
+
+// Visvalingam–Whyatt: drops the vertex spanning the smallest triangle until
+// every remaining one spans at least min_area, O(n log n) with a heap.
+std::vector<std::size_t> visvalingam(const Polyline &polyline, double min_area);
+
+// owning copy of the vertices kept by douglas_peucker
+Polyline simplify(const Polyline &polyline, double tolerance,
+                  std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+// Douglas–Peucker levels of a polyline at doubling tolerances, each level
+// simplified from the one below so its segments are unions of finer ones.
+// Every level records how far the source strays from each of its segments,
+// which makes the coarse levels a conservative filter: a figure farther
+// than that from a coarse segment cannot meet the source under it.
+class PolylinePyramid
+{
+public:
+    struct Level
+    {
+        Polyline polyline;
+        // source index of every vertex of the level
+        std::vector<std::size_t> vertices;
+        // largest distance of the source vertices under each segment
+        std::vector<double> deviations;
+        double tolerance;
+    };
+
+    // Borrows the source, it must outlive the pyramid. The tolerance starts
+    // at base_tolerance and doubles until a level shrinks; levels stop at
+    // max_levels or at a single segment.
+    PolylinePyramid(const Polyline &source, double base_tolerance, std::size_t max_levels = 8);
+
+    const Polyline &source() const { return source_; }
+    // finest first
+    const std::vector<Level> &levels() const { return levels_; }
+
+    // The points of source().intersect(other), possibly in another order.
+    // Starts at the coarsest level and only descends into segments the other
+    // figure comes within the segment's deviation of.
+    Points intersect(const Figure &other,
+                     std::pmr::memory_resource *resource = std::pmr::get_default_resource()) const;
+
+private:
+    void refine(std::size_t level, std::size_t segment, const Figure &other,
+                const BoundingBox &other_box, Points &result) const;
+
+    const Polyline &source_;
+    std::vector<Level> levels_;
+};
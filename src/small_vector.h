@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Vector with inline storage for N elements. Spills to the memory resource
+// only when more than N elements are stored.
+template <typename T, std::size_t N>
+class SmallVector
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SmallVector keeps trivially copyable values only");
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using iterator = T *;
+    using const_iterator = const T *;
+    using allocator_type = std::pmr::polymorphic_allocator<T>;
+
+    explicit SmallVector(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : resource_(resource) {}
+
+    // like std::pmr containers, a copy uses the default resource
+    SmallVector(const SmallVector &other)
+    {
+        insert(end(), other.begin(), other.end());
+    }
+
+    SmallVector(SmallVector &&other) noexcept : resource_(other.resource_)
+    {
+        steal(other);
+    }
+
+    SmallVector &operator=(const SmallVector &other)
+    {
+        if (this != &other) {
+            clear();
+            insert(end(), other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    // copies, and so may allocate, when the resources differ
+    SmallVector &operator=(SmallVector &&other)
+    {
+        if (this == &other) {
+            return *this;
+        }
+        if (*resource_ == *other.resource_) {
+            free_heap();
+            steal(other);
+        } else {
+            clear();
+            insert(end(), other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    ~SmallVector() { free_heap(); }
+
+    allocator_type get_allocator() const { return allocator_type(resource_); }
+
+    size_type size() const { return size_; }
+    size_type capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+    bool is_inline() const { return data_ == inline_data(); }
+
+    T *data() { return data_; }
+    const T *data() const { return data_; }
+
+    iterator begin() { return data_; }
+    iterator end() { return data_ + size_; }
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_ + size_; }
+
+    T &operator[](size_type i) { return data_[i]; }
+    const T &operator[](size_type i) const { return data_[i]; }
+
+    T &front() { return data_[0]; }
+    const T &front() const { return data_[0]; }
+    T &back() { return data_[size_ - 1]; }
+    const T &back() const { return data_[size_ - 1]; }
+
+    void clear() { size_ = 0; }
+
+    void reserve(size_type capacity)
+    {
+        if (capacity <= capacity_) {
+            return;
+        }
+        T *heap = allocate(capacity);
+        if (size_ > 0) {
+            std::memcpy(static_cast<void *>(heap), data_, size_ * sizeof(T));
+        }
+        adopt(heap, capacity);
+    }
+
+    void push_back(const T &value)
+    {
+        emplace_back(value);
+    }
+
+    template <typename... Args>
+    T &emplace_back(Args &&... args)
+    {
+        if (size_ == capacity_) {
+            // args may refer to an element, so the old buffer goes last
+            size_type capacity = capacity_ * 2;
+            T *heap = allocate(capacity);
+            ::new (static_cast<void *>(heap + size_)) T(std::forward<Args>(args)...);
+            std::memcpy(static_cast<void *>(heap), data_, size_ * sizeof(T));
+            adopt(heap, capacity);
+        } else {
+            ::new (static_cast<void *>(data_ + size_)) T(std::forward<Args>(args)...);
+        }
+        return data_[size_++];
+    }
+
+    template <typename InputIt>
+    iterator insert(const_iterator pos, InputIt first, InputIt last)
+    {
+        size_type offset = pos - data_;
+        size_type count = std::distance(first, last);
+        if (size_ + count > capacity_) {
+            // the range may be elements of this vector, so the old buffer goes last
+            size_type capacity = std::max(size_ + count, capacity_ * 2);
+            T *heap = allocate(capacity);
+            for (T *out = heap + offset; first != last; ++first, ++out) {
+                ::new (static_cast<void *>(out)) T(*first);
+            }
+            std::memcpy(static_cast<void *>(heap), data_, offset * sizeof(T));
+            std::memcpy(static_cast<void *>(heap + offset + count), data_ + offset, (size_ - offset) * sizeof(T));
+            adopt(heap, capacity);
+            size_ += count;
+            return data_ + offset;
+        }
+        T *at = data_ + offset;
+        if (offset < size_) {
+            std::memmove(static_cast<void *>(at + count), at, (size_ - offset) * sizeof(T));
+        }
+        for (T *out = at; first != last; ++first, ++out) {
+            ::new (static_cast<void *>(out)) T(*first);
+        }
+        size_ += count;
+        return at;
+    }
+
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        T *at = data_ + (first - data_);
+        size_type count = last - first;
+        std::memmove(static_cast<void *>(at), at + count, (end() - (at + count)) * sizeof(T));
+        size_ -= count;
+        return at;
+    }
+
+private:
+    T *inline_data() { return reinterpret_cast<T *>(inline_); }
+    const T *inline_data() const { return reinterpret_cast<const T *>(inline_); }
+
+    T *allocate(size_type capacity)
+    {
+        return static_cast<T *>(resource_->allocate(capacity * sizeof(T), alignof(T)));
+    }
+
+    // frees the old heap buffer, if any, and switches to heap
+    void adopt(T *heap, size_type capacity)
+    {
+        free_heap();
+        data_ = heap;
+        capacity_ = capacity;
+    }
+
+    void free_heap()
+    {
+        if (!is_inline()) {
+            resource_->deallocate(data_, capacity_ * sizeof(T), alignof(T));
+            data_ = inline_data();
+            capacity_ = N;
+        }
+    }
+
+    void steal(SmallVector &other)
+    {
+        if (other.is_inline()) {
+            data_ = inline_data();
+            capacity_ = N;
+            std::memcpy(static_cast<void *>(data_), other.data_, other.size_ * sizeof(T));
+        } else {
+            data_ = other.data_;
+            capacity_ = other.capacity_;
+            other.data_ = other.inline_data();
+            other.capacity_ = N;
+        }
+        size_ = other.size_;
+        other.size_ = 0;
+    }
+
+    std::pmr::memory_resource *resource_ = std::pmr::get_default_resource();
+    alignas(T) unsigned char inline_[N * sizeof(T)];
+    T *data_ = inline_data();
+    size_type size_ = 0;
+    size_type capacity_ = N;
+};
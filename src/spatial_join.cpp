@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include "arena.h"
+#include "spatial_join.h"
+
+namespace {
+
+using Entry = RTree::Entry;
+
+const std::size_t TILE_ENTRIES = 4096;
+// keeps the per-tile bookkeeping small even for huge inputs
+const std::size_t MAX_GRID = 256;
+
+[[noreturn]] void fail(const std::string &what)
+{
+    throw std::runtime_error("spatial join: " + what);
+}
+
+BoundingBox scene_bounds(const Scene &scene)
+{
+    if (scene.has_index()) {
+        return scene.index().bounds();
+    }
+    BoundingBox bounds;
+    for (std::size_t id = 0; id < scene.size(); id++) {
+        bounds.expand(scene[id].bbox());
+    }
+    return bounds;
+}
+
+// boxes grow by EPS, so pairs the intersect kernels accept as touching
+// always share a tile and the overlap test below needs no tolerance
+BoundingBox padded(const BoundingBox &box)
+{
+    return BoundingBox(box.min_x() - EPS, box.min_y() - EPS, box.max_x() + EPS, box.max_y() + EPS);
+}
+
+bool overlaps(const BoundingBox &a, const BoundingBox &b)
+{
+    return a.min_x() <= b.max_x() && b.min_x() <= a.max_x()
+        && a.min_y() <= b.max_y() && b.min_y() <= a.max_y();
+}
+
+class Grid
+{
+public:
+    Grid(const BoundingBox &world, std::size_t size)
+        : world_(world), size_(size),
+          width_((world.max_x() - world.min_x()) / size),
+          height_((world.max_y() - world.min_y()) / size) {}
+
+    std::size_t size() const { return size_; }
+    std::size_t tiles() const { return size_ * size_; }
+
+    std::size_t column(double x) const { return cell(x - world_.min_x(), width_); }
+    std::size_t row(double y) const { return cell(y - world_.min_y(), height_); }
+    std::size_t tile(double x, double y) const { return row(y) * size_ + column(x); }
+
+private:
+    std::size_t cell(double offset, double step) const
+    {
+        if (!(step > 0) || offset <= 0) {
+            return 0;
+        }
+        return std::min(static_cast<std::size_t>(offset / step), size_ - 1);
+    }
+
+    BoundingBox world_;
+    std::size_t size_;
+    double width_, height_;
+};
+
+// Entries of one input by tile. Past the budget all buffered entries are
+// appended to the spill file as one run per tile and the buffers freed.
+class Partitions
+{
+public:
+    Partitions(std::size_t tiles, std::size_t budget, std::filesystem::path spill_path)
+        : buffers_(tiles), runs_(tiles), budget_(budget), path_(std::move(spill_path)) {}
+
+    ~Partitions()
+    {
+        if (out_.is_open()) {
+            out_.close();
+            std::error_code error;
+            std::filesystem::remove(path_, error);
+        }
+    }
+
+    Partitions(const Partitions &) = delete;
+    Partitions &operator=(const Partitions &) = delete;
+
+    void add(std::size_t tile, const Entry &entry)
+    {
+        buffers_[tile].push_back(entry);
+        buffered_ += sizeof(Entry);
+        if (budget_ > 0 && buffered_ > budget_) {
+            spill();
+        }
+    }
+
+    // ready for concurrent load() calls
+    void finish()
+    {
+        if (out_.is_open()) {
+            out_.flush();
+            if (!out_) {
+                fail("cannot write " + path_.string());
+            }
+        }
+    }
+
+    std::vector<Entry> load(std::size_t tile) const
+    {
+        std::vector<Entry> result;
+        std::size_t count = buffers_[tile].size();
+        for (const auto &run : runs_[tile]) {
+            count += run.count;
+        }
+        result.reserve(count);
+
+        if (!runs_[tile].empty()) {
+            std::ifstream in(path_, std::ios::binary);
+            for (const auto &run : runs_[tile]) {
+                std::size_t first = result.size();
+                result.resize(first + run.count);
+                in.seekg(static_cast<std::streamoff>(run.offset));
+                in.read(reinterpret_cast<char *>(result.data() + first),
+                        static_cast<std::streamsize>(run.count * sizeof(Entry)));
+            }
+            if (!in) {
+                fail("cannot read " + path_.string());
+            }
+        }
+        result.insert(result.end(), buffers_[tile].begin(), buffers_[tile].end());
+        return result;
+    }
+
+private:
+    struct Run
+    {
+        std::uint64_t offset;
+        std::size_t count;
+    };
+
+    void spill()
+    {
+        if (!out_.is_open()) {
+            out_.open(path_, std::ios::binary | std::ios::trunc);
+            if (!out_) {
+                fail("cannot create " + path_.string());
+            }
+        }
+        for (std::size_t tile = 0; tile < buffers_.size(); tile++) {
+            auto &buffer = buffers_[tile];
+            if (buffer.empty()) {
+                continue;
+            }
+            runs_[tile].push_back({written_, buffer.size()});
+            out_.write(reinterpret_cast<const char *>(buffer.data()),
+                       static_cast<std::streamsize>(buffer.size() * sizeof(Entry)));
+            written_ += buffer.size() * sizeof(Entry);
+            std::vector<Entry>().swap(buffer);
+        }
+        if (!out_) {
+            fail("cannot write " + path_.string());
+        }
+        buffered_ = 0;
+    }
+
+    std::vector<std::vector<Entry>> buffers_;
+    std::vector<std::vector<Run>> runs_;
+    std::size_t budget_;
+    std::size_t buffered_ = 0;
+    std::filesystem::path path_;
+    std::ofstream out_;
+    std::uint64_t written_ = 0;
+};
+
+void partition(const Scene &scene, const BoundingBox &world, const Grid &grid, Partitions &partitions)
+{
+    for (std::size_t id = 0; id < scene.size(); id++) {
+        BoundingBox box = padded(scene[id].bbox());
+        if (!overlaps(box, world)) {
+            continue;
+        }
+        Entry entry{box, id};
+        std::size_t last_column = grid.column(box.max_x());
+        std::size_t last_row = grid.row(box.max_y());
+        for (std::size_t row = grid.row(box.min_y()); row <= last_row; row++) {
+            for (std::size_t column = grid.column(box.min_x()); column <= last_column; column++) {
+                partitions.add(row * grid.size() + column, entry);
+            }
+        }
+    }
+}
+
+// plane sweep over both tile lists sorted by min_x
+template <typename Visitor>
+void sweep(std::vector<Entry> &a, std::vector<Entry> &b, Visitor &&visit)
+{
+    auto by_min_x = [](const Entry &first, const Entry &second) { return first.box.min_x() < second.box.min_x(); };
+    std::sort(a.begin(), a.end(), by_min_x);
+    std::sort(b.begin(), b.end(), by_min_x);
+
+    std::size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i].box.min_x() <= b[j].box.min_x()) {
+            for (std::size_t k = j; k < b.size() && b[k].box.min_x() <= a[i].box.max_x(); k++) {
+                visit(a[i], b[k]);
+            }
+            i++;
+        } else {
+            for (std::size_t k = i; k < a.size() && a[k].box.min_x() <= b[j].box.max_x(); k++) {
+                visit(a[k], b[j]);
+            }
+            j++;
+        }
+    }
+}
+
+std::string spill_name()
+{
+    std::random_device random;
+    std::uniform_int_distribution<std::uint64_t> distribution;
+    char name[40];
+    std::snprintf(name, sizeof(name), "figures-join-%016llx", static_cast<unsigned long long>(distribution(random)));
+    return name;
+}
+
+}//namespace
+
+std::vector<JoinPair> spatial_join(const Scene &a, const Scene &b, const JoinOptions &options)
+{
+    unsigned threads = options.threads > 0 ? options.threads : std::thread::hardware_concurrency();
+    std::vector<std::vector<JoinPair>> found(std::max(1u, threads));
+    spatial_join(a, b, options, [&](unsigned worker, std::size_t id_a, std::size_t id_b, const Points &) {
+        found[worker].push_back({id_a, id_b});
+    });
+
+    std::vector<JoinPair> result;
+    for (auto &pairs : found) {
+        result.insert(result.end(), pairs.begin(), pairs.end());
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+void spatial_join(const Scene &a, const Scene &b, const JoinOptions &options, const JoinVisitor &visit)
+{
+    BoundingBox bounds_a = scene_bounds(a);
+    BoundingBox bounds_b = scene_bounds(b);
+    if (bounds_a.empty() || bounds_b.empty() || !overlaps(padded(bounds_a), padded(bounds_b))) {
+        return;
+    }
+    // only the overlap of the inputs can hold pairs
+    BoundingBox world(std::max(bounds_a.min_x(), bounds_b.min_x()) - EPS,
+                      std::max(bounds_a.min_y(), bounds_b.min_y()) - EPS,
+                      std::min(bounds_a.max_x(), bounds_b.max_x()) + EPS,
+                      std::min(bounds_a.max_y(), bounds_b.max_y()) + EPS);
+
+    std::size_t size = options.grid;
+    if (size == 0) {
+        double tiles = static_cast<double>(a.size() + b.size()) / TILE_ENTRIES;
+        size = std::min(MAX_GRID, std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(std::sqrt(tiles)))));
+    }
+    Grid grid(world, size);
+
+    std::filesystem::path directory = options.spill_directory.empty()
+            ? std::filesystem::temp_directory_path() : std::filesystem::path(options.spill_directory);
+    std::string name = spill_name();
+    Partitions partitions_a(grid.tiles(), options.memory_budget / 2, directory / (name + "-a.bin"));
+    Partitions partitions_b(grid.tiles(), options.memory_budget / 2, directory / (name + "-b.bin"));
+    partition(a, world, grid, partitions_a);
+    partition(b, world, grid, partitions_b);
+    partitions_a.finish();
+    partitions_b.finish();
+
+    unsigned threads = options.threads > 0 ? options.threads : std::thread::hardware_concurrency();
+    threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(grid.tiles())));
+
+    std::atomic<std::size_t> next_tile(0);
+    std::vector<std::exception_ptr> errors(threads);
+    auto run = [&](unsigned worker) {
+        try {
+            for (std::size_t tile = next_tile++; tile < grid.tiles(); tile = next_tile++) {
+                std::vector<Entry> entries_a = partitions_a.load(tile);
+                if (entries_a.empty()) {
+                    continue;
+                }
+                std::vector<Entry> entries_b = partitions_b.load(tile);
+
+                ArenaScope arena;
+                sweep(entries_a, entries_b, [&](const Entry &first, const Entry &second) {
+                    if (first.box.min_y() > second.box.max_y() || second.box.min_y() > first.box.max_y()) {
+                        return;
+                    }
+                    double corner_x = std::max(first.box.min_x(), second.box.min_x());
+                    double corner_y = std::max(first.box.min_y(), second.box.min_y());
+                    if (grid.tile(corner_x, corner_y) != tile) {
+                        return;
+                    }
+                    std::size_t id_a = static_cast<std::size_t>(first.id);
+                    std::size_t id_b = static_cast<std::size_t>(second.id);
+                    Points points = a[id_a].intersect(b[id_b], arena.resource());
+                    if (!points.empty()) {
+                        visit(worker, id_a, id_b, points);
+                    }
+                });
+            }
+        } catch (...) {
+            errors[worker] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; i++) {
+        workers.emplace_back(run, i);
+    }
+    run(0);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    for (const auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
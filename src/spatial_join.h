@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "scene.h"
+
+// Partition-based spatial join of two scenes. Both inputs are cut into a
+// grid of tiles over the overlap of their bounds and every figure goes to
+// each tile its bbox touches. Tiles are joined in parallel by a plane sweep
+// over the boxes followed by the exact intersect kernels. A pair is reported
+// only by the tile holding the low corner of the overlap of its boxes, so
+// figures spanning several tiles do not produce duplicates.
+struct JoinOptions
+{
+    // tiles per side, 0 sizes the grid for a few thousand boxes per tile
+    std::size_t grid = 0;
+    // 0 uses std::thread::hardware_concurrency()
+    unsigned threads = 0;
+    // bytes of tile entries kept in memory, past it they spill to a file per
+    // input in spill_directory; 0 never spills
+    std::size_t memory_budget = 0;
+    // empty uses std::filesystem::temp_directory_path()
+    std::string spill_directory;
+};
+
+struct JoinPair
+{
+    std::size_t a;
+    std::size_t b;
+
+    bool operator==(const JoinPair &other) const { return a == other.a && b == other.b; }
+    bool operator<(const JoinPair &other) const { return a < other.a || (a == other.a && b < other.b); }
+};
+
+// Every intersecting pair of a figure of a and a figure of b, sorted. For
+// inputs larger than memory pass MappedScene::scene(), so the figures stay
+// in the mapped files. Throws std::runtime_error when spilling fails.
+std::vector<JoinPair> spatial_join(const Scene &a, const Scene &b, const JoinOptions &options = JoinOptions());
+
+// Gets each intersecting pair once, with its points, as soon as a worker
+// finds it. Calls from different workers run concurrently; worker is below
+// the thread count the join used, which is at most options.threads when
+// that is set. The points live in the worker's arena until the call returns.
+using JoinVisitor = std::function<void(unsigned worker, std::size_t a, std::size_t b, const Points &points)>;
+
+// Streaming form of the above: pairs arrive in no particular order and
+// nothing is collected.
+void spatial_join(const Scene &a, const Scene &b, const JoinOptions &options, const JoinVisitor &visit);
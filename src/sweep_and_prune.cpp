@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <iterator>
+#include "sweep_and_prune.h"
+
+void SweepAndPrune::insert(std::size_t id, const BoundingBox &box)
+{
+    if (id >= boxes_.size()) {
+        boxes_.resize(id + 1);
+        active_.resize(id + 1, false);
+        listed_.resize(id + 1, false);
+        changed_.resize(id + 1, false);
+    }
+    boxes_[id] = box;
+    touch(id);
+    if (active_[id]) {
+        return;
+    }
+    active_[id] = true;
+    count_++;
+    // an id removed and inserted again before the step is still in order_
+    if (!listed_[id]) {
+        listed_[id] = true;
+        pending_.push_back(id);
+    }
+}
+
+void SweepAndPrune::update(std::size_t id, const BoundingBox &box)
+{
+    if (contains(id)) {
+        boxes_[id] = box;
+        touch(id);
+    }
+}
+
+void SweepAndPrune::remove(std::size_t id)
+{
+    if (contains(id)) {
+        active_[id] = false;
+        has_removed_ = true;
+        touch(id);
+        count_--;
+    }
+}
+
+void SweepAndPrune::touch(std::size_t id)
+{
+    if (!changed_[id]) {
+        changed_[id] = true;
+        changed_ids_.push_back(id);
+    }
+}
+
+void SweepAndPrune::sort()
+{
+    if (has_removed_) {
+        auto drop = [&](std::size_t id) {
+            if (active_[id]) {
+                return false;
+            }
+            listed_[id] = false;
+            return true;
+        };
+        order_.erase(std::remove_if(order_.begin(), order_.end(), drop), order_.end());
+        pending_.erase(std::remove_if(pending_.begin(), pending_.end(), drop), pending_.end());
+        has_removed_ = false;
+    }
+
+    // insertion sort, cheap when boxes barely moved since the last step
+    for (std::size_t i = 1; i < order_.size(); i++) {
+        std::size_t id = order_[i];
+        double key = boxes_[id].min_x();
+        std::size_t j = i;
+        while (j > 0 && boxes_[order_[j - 1]].min_x() > key) {
+            order_[j] = order_[j - 1];
+            j--;
+        }
+        order_[j] = id;
+    }
+
+    if (!pending_.empty()) {
+        auto by_min_x = [&](std::size_t a, std::size_t b) { return boxes_[a].min_x() < boxes_[b].min_x(); };
+        std::sort(pending_.begin(), pending_.end(), by_min_x);
+        std::size_t middle = order_.size();
+        order_.insert(order_.end(), pending_.begin(), pending_.end());
+        std::inplace_merge(order_.begin(), order_.begin() + middle, order_.end(), by_min_x);
+        pending_.clear();
+    }
+}
+
+void SweepAndPrune::sweep(std::vector<Pair> &pairs) const
+{
+    for (std::size_t i = 0; i < order_.size(); i++) {
+        const BoundingBox &box = boxes_[order_[i]];
+        for (std::size_t j = i + 1; j < order_.size(); j++) {
+            const BoundingBox &other = boxes_[order_[j]];
+            if (other.min_x() > box.max_x() + EPS) {
+                break;
+            }
+            if (box.intersects(other)) {
+                pairs.emplace_back(std::min(order_[i], order_[j]), std::max(order_[i], order_[j]));
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+}
+
+// Pairs with a changed id, found by walking outwards from its place in the
+// order: to the right up to its max x, to the left as far as the widest box
+// could reach. Both ends of a pair of changed ids see it, the lower id
+// reports it.
+void SweepAndPrune::sweep_changed(std::vector<Pair> &pairs)
+{
+    position_.resize(boxes_.size());
+    double widest = 0;
+    for (std::size_t i = 0; i < order_.size(); i++) {
+        position_[order_[i]] = i;
+        widest = std::max(widest, boxes_[order_[i]].max_x() - boxes_[order_[i]].min_x());
+    }
+
+    auto visit = [&](std::size_t id, std::size_t other) {
+        if (boxes_[id].intersects(boxes_[other]) && (!changed_[other] || id < other)) {
+            pairs.emplace_back(std::min(id, other), std::max(id, other));
+        }
+    };
+    for (std::size_t id : changed_ids_) {
+        if (!active_[id]) {
+            continue;
+        }
+        const BoundingBox &box = boxes_[id];
+        std::size_t at = position_[id];
+        for (std::size_t j = at + 1; j < order_.size() && boxes_[order_[j]].min_x() <= box.max_x() + EPS; j++) {
+            visit(id, order_[j]);
+        }
+        for (std::size_t j = at; j > 0 && boxes_[order_[j - 1]].min_x() >= box.min_x() - widest - EPS; j--) {
+            visit(id, order_[j - 1]);
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+}
+
+void SweepAndPrune::step()
+{
+    sort();
+
+    std::vector<Pair> pairs;
+    pairs.reserve(pairs_.size());
+    if (changed_ids_.size() * 2 > order_.size()) {
+        sweep(pairs);
+    } else {
+        std::vector<Pair> fresh;
+        sweep_changed(fresh);
+        std::vector<Pair> kept;
+        kept.reserve(pairs_.size());
+        std::copy_if(pairs_.begin(), pairs_.end(), std::back_inserter(kept), [&](const Pair &pair) {
+            return !changed_[pair.first] && !changed_[pair.second];
+        });
+        std::merge(kept.begin(), kept.end(), fresh.begin(), fresh.end(), std::back_inserter(pairs));
+    }
+    for (std::size_t id : changed_ids_) {
+        changed_[id] = false;
+    }
+    changed_ids_.clear();
+
+    added_.clear();
+    removed_.clear();
+    std::set_difference(pairs.begin(), pairs.end(), pairs_.begin(), pairs_.end(), std::back_inserter(added_));
+    std::set_difference(pairs_.begin(), pairs_.end(), pairs.begin(), pairs.end(), std::back_inserter(removed_));
+    pairs_.swap(pairs);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "figures.h"
+
+// Sort-and-sweep broad phase for figures that move a little every step.
+// Boxes stay sorted by min x between steps, so re-sorting with insertion
+// sort is close to linear. Pairs of ids that were not inserted, updated or
+// removed since the last step are carried over; only the changed ids are
+// swept against their neighbours in the order, unless most of them changed.
+// Ids are small dense integers (e.g. scene ids).
+class SweepAndPrune
+{
+public:
+    // first < second
+    using Pair = std::pair<std::size_t, std::size_t>;
+
+    void insert(std::size_t id, const BoundingBox &box);
+    void update(std::size_t id, const BoundingBox &box);
+    void remove(std::size_t id);
+
+    bool contains(std::size_t id) const { return id < active_.size() && active_[id]; }
+    std::size_t size() const { return count_; }
+
+    // re-sorts, sweeps and diffs the overlapping pairs with the previous step
+    void step();
+
+    // same, then calls on_added(a, b) and on_removed(a, b) for the changes
+    template <typename Added, typename Removed>
+    void step(Added &&on_added, Removed &&on_removed);
+
+    // overlapping pairs of the last step, sorted
+    const std::vector<Pair> &pairs() const { return pairs_; }
+    const std::vector<Pair> &added() const { return added_; }
+    const std::vector<Pair> &removed() const { return removed_; }
+
+private:
+    void touch(std::size_t id);
+    void sort();
+    void sweep(std::vector<Pair> &pairs) const;
+    void sweep_changed(std::vector<Pair> &pairs);
+
+    std::vector<BoundingBox> boxes_;
+    std::vector<bool> active_;
+    std::size_t count_ = 0;
+
+    // active ids by min x, new ids wait in pending_ until the next step;
+    // listed_ marks ids in either, removed ones stay until the next step
+    std::vector<std::size_t> order_;
+    std::vector<std::size_t> pending_;
+    std::vector<bool> listed_;
+    bool has_removed_ = false;
+
+    // ids inserted, updated or removed since the last step
+    std::vector<bool> changed_;
+    std::vector<std::size_t> changed_ids_;
+    // position of each id in order_, for sweep_changed()
+    std::vector<std::size_t> position_;
+
+    std::vector<Pair> pairs_;
+    std::vector<Pair> added_;
+    std::vector<Pair> removed_;
+};
+
+template <typename Added, typename Removed>
+void SweepAndPrune::step(Added &&on_added, Removed &&on_removed)
+{
+    step();
+    for (const auto &pair : added_) {
+        on_added(pair.first, pair.second);
+    }
+    for (const auto &pair : removed_) {
+        on_removed(pair.first, pair.second);
+    }
+}
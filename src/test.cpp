@@ -1,7 +1,34 @@
 #include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
 #include "catch.hpp"
 #include "figures.h"
 #include "misc.h"
+#include "arena.h"
+#include "mapped_file.h"
+#include "rtree.h"
+#include "scene.h"
+#include "scene_file.h"
+#include "scene_source.h"
+#include "wkt.h"
+#include "csv_loader.h"
+#include "index_file.h"
+#include "sweep_and_prune.h"
+#include "loose_quadtree.h"
+#include "ray.h"
+#include "spatial_join.h"
+#include "simplify.h"
+#include "polygon.h"
+#include "rectangle.h"
+#include "arc.h"
+#include "bezier.h"
+#include "transform.h"
+#include "collision.h"
 
 TEST_CASE("Test Point", "[figure][point]")
 {
@@ -281,6 +308,37 @@ TEST_CASE("Intersect circle and segment", "[figure][segment][circle]")
         REQUIRE(reverse_intersections[0].y() == Approx(0));
     }
 
+    SECTION("Short segment")
+    {
+        Segment segment(-2.001, 0.001, -1.999, -0.001);
+        Circle circle(0, 0, 2);
+
+        auto intersections = segment.intersect(circle);
+        REQUIRE(intersections.size() == 1);
+        REQUIRE(intersections[0].x() == Approx(-2));
+    }
+
+    SECTION("Tangent test does not scale with segment length")
+    {
+        Circle circle(0, 0, 2);
+
+        //both used to be taken for tangents with the foot point outside them
+        Segment crossing(0.5, sqrt(3.75) - 0.00005, 0.5, sqrt(3.75) + 0.00005);
+        auto intersections = crossing.intersect(circle);
+        REQUIRE(intersections.size() == 1);
+        REQUIRE(intersections[0].y() == Approx(sqrt(3.75)));
+
+        Segment chord(-1e-4, 1e-4, 1e-4, -1e-4);
+        REQUIRE(chord.intersect(Circle(1, -1, sqrt(2))).size() == 1);
+
+        Segment tangent(-0.0001, 2, 0.0001, 2);
+        intersections = tangent.intersect(circle);
+        REQUIRE(intersections.size() == 1);
+        REQUIRE(intersections[0].x() == Approx(0).margin(1e-9));
+
+        REQUIRE(Segment(-100, 2.001, 100, 2.001).intersect(circle).empty());
+    }
+
 }
 
 TEST_CASE("Intersect circles", "[figure][circle]")
@@ -538,8 +596,8 @@ TEST_CASE("Intersect polylines", "[figures][polyline]")
 TEST_CASE("Test vector of different figures")
 {
     std::vector<Figure*> figures;
-    std::vector<Point> intersections;
-    std::vector<Point> reverse_intersections;
+    Points intersections;
+    Points reverse_intersections;
 
     std::vector<Point> polyline_points;
     polyline_points.emplace_back(-1, 2);
@@ -590,3 +648,2090 @@ TEST_CASE("Test vector of different figures")
     REQUIRE(misc::contains_point(reverse_intersections, Point(2, 1)));
     REQUIRE(misc::contains_point(reverse_intersections, Point(2, -1)));
 }
+
+TEST_CASE("Intersect with memory resource", "[figure][memory]")
+{
+    SECTION("Results and polyline use the given resource")
+    {
+        std::pmr::monotonic_buffer_resource arena;
+
+        std::vector<Point> polyline_points;
+        polyline_points.emplace_back(1, 3);
+        polyline_points.emplace_back(4, 3);
+        polyline_points.emplace_back(4, 1);
+
+        Polyline polyline(polyline_points, &arena);
+        Segment segment(0, 2, 7, 2);
+        Circle circle(2, 3, 1);
+
+        auto intersections = segment.intersect(polyline, &arena);
+        auto circle_intersections = circle.intersect(static_cast<const Figure &>(polyline), &arena);
+
+        REQUIRE(polyline.get_allocator().resource() == &arena);
+        REQUIRE(intersections.get_allocator().resource() == &arena);
+        REQUIRE(circle_intersections.get_allocator().resource() == &arena);
+
+        REQUIRE(intersections.size() == 1);
+        REQUIRE(misc::contains_point(intersections, Point(4, 2)));
+
+        REQUIRE(circle_intersections.size() == 2);
+        REQUIRE(misc::contains_point(circle_intersections, Point(1, 3)));
+        REQUIRE(misc::contains_point(circle_intersections, Point(3, 3)));
+    }
+
+    SECTION("Thread arena stops spilling after the first batch")
+    {
+        Segment segment(0, 0, 10, 10);
+        Segment other_segment(0, 10, 10, 0);
+
+        for (int batch = 0; batch < 3; batch++) {
+            ArenaScope scope;
+            for (int i = 0; i < 1000; i++) {
+                auto intersections = segment.intersect(other_segment, scope.resource());
+                REQUIRE(intersections.size() == 1);
+            }
+            if (batch > 0) {
+                REQUIRE(ThreadArena::overflow() == 0);
+            }
+        }
+    }
+}
+
+TEST_CASE("Intersection results storage", "[figure][memory]")
+{
+    SECTION("Fixed-arity results stay inline")
+    {
+        Segment segment(-5, 0, 10, 0);
+        Segment other_segment(0, -5, 0, 5);
+        Circle circle(0, 0, 2);
+        Circle other_circle(0, 1, 2.2);
+
+        auto segments_intersections = segment.intersect(other_segment);
+        auto circle_intersections = segment.intersect(circle);
+        auto circles_intersections = circle.intersect(other_circle);
+
+        REQUIRE(segments_intersections.size() == 1);
+        REQUIRE(segments_intersections.is_inline());
+        REQUIRE(circle_intersections.size() == 2);
+        REQUIRE(circle_intersections.is_inline());
+        REQUIRE(circles_intersections.size() == 2);
+        REQUIRE(circles_intersections.is_inline());
+    }
+
+    SECTION("Polyline results spill to the heap")
+    {
+        std::vector<Point> polyline_points;
+        polyline_points.emplace_back(0, 0);
+        polyline_points.emplace_back(1, 2);
+        polyline_points.emplace_back(2, 0);
+        polyline_points.emplace_back(3, 2);
+        polyline_points.emplace_back(4, 0);
+
+        Polyline polyline(polyline_points);
+        Segment segment(-1, 1, 5, 1);
+
+        auto intersections = segment.intersect(polyline);
+        Points copy(intersections);
+        Points moved(std::move(copy));
+
+        REQUIRE(intersections.size() == 4);
+        REQUIRE_FALSE(intersections.is_inline());
+        REQUIRE(moved.size() == 4);
+        REQUIRE(misc::contains_point(moved, Point(0.5, 1)));
+        REQUIRE(misc::contains_point(moved, Point(3.5, 1)));
+    }
+
+    SECTION("Growing keeps elements passed back in")
+    {
+        Points points;
+        points.push_back(Point(1, 2));
+        points.push_back(Point(3, 4));
+        while (points.size() < 16) {
+            points.push_back(points[0]);
+        }
+        REQUIRE(points.size() == points.capacity());
+        points.emplace_back(points[1]);
+        points.insert(points.begin() + 1, points.begin(), points.end());
+
+        REQUIRE(points.size() == 34);
+        REQUIRE(points[1] == Point(1, 2));
+        REQUIRE(points[2] == Point(3, 4));
+        REQUIRE(points[16] == Point(1, 2));
+        REQUIRE(points[17] == Point(3, 4));
+        REQUIRE(points[18] == Point(3, 4));
+        REQUIRE(points[32] == Point(1, 2));
+        REQUIRE(points[33] == Point(3, 4));
+    }
+}
+
+TEST_CASE("Polyline view over external coordinates", "[figure][polyline]")
+{
+    const double coords[] = {1, 3, 4, 3, 4, 1, 6, 1, 6, 3};
+
+    SECTION("View over memory")
+    {
+        PolylineView view(coords, 5);
+        Segment segment(0, 2, 7, 2);
+        Circle circle(0, 0, 2);
+
+        auto intersections = segment.intersect(view);
+        auto reverse_intersections = view.intersect(segment);
+
+        REQUIRE(view.is_view());
+        REQUIRE(view.size() == 5);
+        REQUIRE(view.length() == Approx(9));
+
+        REQUIRE(intersections.size() == 2);
+        REQUIRE(misc::contains_point(intersections, Point(4, 2)));
+        REQUIRE(misc::contains_point(intersections, Point(6, 2)));
+
+        REQUIRE(reverse_intersections.size() == 2);
+        REQUIRE(circle.intersect(view).empty());
+    }
+
+    SECTION("View over mapped file")
+    {
+        std::string path = (std::filesystem::temp_directory_path() / "figures_polyline_view.bin").string();
+        {
+            std::ofstream out(path, std::ios::binary);
+            out.write(reinterpret_cast<const char *>(coords), sizeof(coords));
+        }
+
+        MappedFile file(path);
+        PolylineView view(reinterpret_cast<const double *>(file.data()), file.size() / (2 * sizeof(double)));
+
+        std::vector<Point> other_points;
+        other_points.emplace_back(0, 2);
+        other_points.emplace_back(7, 2);
+        other_points.emplace_back(7, 0);
+        Polyline other_polyline(other_points);
+
+        const Figure &figure = view;
+        auto intersections = figure.intersect(other_polyline);
+        auto reverse_intersections = other_polyline.intersect(figure);
+
+        Polyline copy(view);
+        std::remove(path.c_str());
+
+        REQUIRE(view.size() == 5);
+        REQUIRE(view.length() == Approx(9));
+        REQUIRE(copy.is_view());
+
+        REQUIRE(intersections.size() == 2);
+        REQUIRE(misc::contains_point(intersections, Point(4, 2)));
+        REQUIRE(misc::contains_point(intersections, Point(6, 2)));
+        REQUIRE(reverse_intersections.size() == 2);
+    }
+}
+
+TEST_CASE("RTree queries", "[index][rtree]")
+{
+    std::vector<RTree::Entry> entries;
+    for (int i = 0; i < 50; i++) {
+        for (int j = 0; j < 50; j++) {
+            entries.push_back({BoundingBox(i, j, i + 0.5, j + 0.5), static_cast<std::uint64_t>(i * 50 + j)});
+        }
+    }
+    RTree tree(entries);
+
+    SECTION("Window query")
+    {
+        auto ids = tree.query(BoundingBox(10.2, 20.2, 12.7, 21.7));
+
+        REQUIRE(tree.size() == 2500);
+        REQUIRE(ids.size() == 6);
+        REQUIRE(std::find(ids.begin(), ids.end(), 10 * 50 + 20) != ids.end());
+        REQUIRE(std::find(ids.begin(), ids.end(), 12 * 50 + 21) != ids.end());
+    }
+
+    SECTION("Empty result")
+    {
+        REQUIRE(tree.query(BoundingBox(100, 100, 200, 200)).empty());
+        REQUIRE(RTree().query(BoundingBox(0, 0, 1, 1)).empty());
+    }
+
+    SECTION("Borrowed tree validation")
+    {
+        REQUIRE(RTree::view(tree.nodes(), tree.node_count(), tree.entries(), tree.entry_count()).is_valid(2500));
+        REQUIRE_FALSE(RTree::view(tree.nodes(), tree.node_count(), tree.entries(), tree.entry_count()).is_valid(2499));
+
+        std::vector<RTree::Node> nodes(tree.nodes(), tree.nodes() + tree.node_count());
+        RTree::Node &root = nodes.back();
+        root.count = RTree::NODE_CAPACITY + 1;
+        root.first = 0;
+        REQUIRE_FALSE(RTree::view(nodes.data(), nodes.size(), tree.entries(), tree.entry_count()).is_valid(2500));
+        root.count = 0;
+        REQUIRE_FALSE(RTree::view(nodes.data(), nodes.size(), tree.entries(), tree.entry_count()).is_valid(2500));
+
+        // a chain of single child nodes is in bounds but deeper than the traversal stacks allow
+        std::vector<RTree::Node> chain;
+        chain.push_back({BoundingBox(0, 0, 1, 1), 0, 1, 1, 0});
+        for (std::uint32_t level = 1; level < RTree::MAX_DEPTH; level++) {
+            chain.push_back({BoundingBox(0, 0, 1, 1), level - 1, 1, 0, 0});
+        }
+        REQUIRE(RTree::view(chain.data(), chain.size(), tree.entries(), 1).is_valid(2500));
+        chain.push_back({BoundingBox(0, 0, 1, 1), RTree::MAX_DEPTH - 1, 1, 0, 0});
+        REQUIRE_FALSE(RTree::view(chain.data(), chain.size(), tree.entries(), 1).is_valid(2500));
+    }
+}
+
+TEST_CASE("Scene file", "[scene][file]")
+{
+    std::string path = (std::filesystem::temp_directory_path() / "figures_scene.bin").string();
+
+    std::vector<Point> polyline_points;
+    polyline_points.emplace_back(1, 3);
+    polyline_points.emplace_back(4, 3);
+    polyline_points.emplace_back(4, 1);
+
+    Scene scene;
+    scene.add(Segment(0, 2, 7, 2));
+    scene.add(Circle(10, 10, 2));
+    scene.add(Polyline(polyline_points));
+    scene.add(Segment(20, 20, 30, 30));
+
+    SECTION("Round trip with index")
+    {
+        scene.build_index();
+        write_scene(scene, path);
+
+        MappedScene mapped(path);
+        const Scene &loaded = mapped.scene();
+
+        REQUIRE(loaded.size() == 4);
+        REQUIRE(loaded.kind(1) == Scene::Kind::CIRCLE);
+        REQUIRE(loaded.circle(1).radius() == Approx(2));
+        REQUIRE(loaded.polyline(2).is_view());
+        REQUIRE(loaded[2].length() == Approx(5));
+        REQUIRE(loaded[3].length() == Approx(scene[3].length()));
+
+        auto intersections = loaded[0].intersect(loaded[2]);
+        REQUIRE(intersections.size() == 1);
+        REQUIRE(misc::contains_point(intersections, Point(4, 2)));
+
+        REQUIRE(loaded.has_index());
+        auto ids = loaded.index().query(BoundingBox(3, 0, 5, 2.5));
+        REQUIRE(ids.size() == 2);
+    }
+
+    SECTION("Round trip without index")
+    {
+        write_scene(scene, path);
+        MappedScene mapped(path);
+
+        REQUIRE(mapped.scene().size() == 4);
+        REQUIRE_FALSE(mapped.scene().has_index());
+    }
+
+    SECTION("Rejects other files")
+    {
+        {
+            std::ofstream out(path, std::ios::binary);
+            out << "definitely not a scene file, but long enough to hold a header of the scene format"
+                   " so the magic check is the one that fails";
+        }
+        REQUIRE_THROWS_AS(MappedScene(path), std::runtime_error);
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Scene sources", "[scene][file]")
+{
+    std::vector<std::string> paths;
+    for (int file = 0; file < 3; file++) {
+        std::vector<Point> points;
+        points.emplace_back(file, 0);
+        points.emplace_back(file, file + 1);
+        Scene scene;
+        scene.add(Polyline(points));
+        scene.add(Segment(file, 0, file + 1, 0));
+        paths.push_back((std::filesystem::temp_directory_path() /
+                         ("figures_source_" + std::to_string(file) + ".bin")).string());
+        write_scene(scene, paths.back());
+    }
+
+    SECTION("Batches span several mapped files")
+    {
+        SceneSource source(paths, InputFormat::AUTO);
+        Scene batch;
+        REQUIRE(source.next(16, batch));
+        REQUIRE(batch.size() == 6);
+        for (int file = 0; file < 3; file++) {
+            REQUIRE(batch.polyline(2 * file).is_view());
+            REQUIRE(batch[2 * file].length() == Approx(file + 1));
+        }
+        REQUIRE_FALSE(source.next(16, batch));
+    }
+
+    SECTION("Copies outlive the source with its mappings")
+    {
+        Scene loaded;
+        std::vector<std::unique_ptr<MappedScene>> mappings;
+        {
+            SceneSource source(paths, InputFormat::BIN);
+            Scene batch;
+            while (source.next(1, batch)) {
+                copy_figure(batch, 0, loaded);
+            }
+            mappings = source.take_mappings();
+        }
+        REQUIRE(mappings.size() == 3);
+        REQUIRE(loaded.size() == 6);
+        REQUIRE(loaded[4].length() == Approx(3));
+        REQUIRE(loaded[0].intersect(loaded[1]).size() == 1);
+    }
+
+    for (const auto &path : paths) {
+        std::remove(path.c_str());
+    }
+}
+
+TEST_CASE("WKT reader and writer", "[wkt]")
+{
+    SECTION("Read figures")
+    {
+        std::istringstream in("LINESTRING (0 2, 7 2)\n"
+                              "linestring(1 3,4 3 , 4 1);\n"
+                              "CIRCULARSTRING (-2 0, 2 0, -2 0)\n"
+                              "POINT (10 10) 2.5\n"
+                              "LINESTRING EMPTY\n");
+        Scene scene;
+
+        REQUIRE(read_wkt(in, scene) == 4);
+        REQUIRE(scene.kind(0) == Scene::Kind::SEGMENT);
+        REQUIRE(scene.kind(1) == Scene::Kind::POLYLINE);
+        REQUIRE(scene.kind(2) == Scene::Kind::CIRCLE);
+        REQUIRE(scene.circle(2).radius() == Approx(2));
+        REQUIRE(scene.circle(3).center() == Point(10, 10));
+        REQUIRE(scene.circle(3).radius() == Approx(2.5));
+        REQUIRE_FALSE(scene.polyline(1).is_view());
+
+        auto intersections = scene[0].intersect(scene[1]);
+        REQUIRE(intersections.size() == 1);
+        REQUIRE(misc::contains_point(intersections, Point(4, 2)));
+    }
+
+    SECTION("Round trip through a small buffer")
+    {
+        std::ostringstream out;
+        WktWriter writer(out);
+        for (int i = 0; i < 200; i++) {
+            writer.write(Segment(i, 0.1 * i, i + 1, -1e-3 * i));
+            writer.write(Circle(i, i, 0.5));
+        }
+
+        std::istringstream in(out.str());
+        WktReader reader(in, 256);
+        int count = 0;
+        while (reader.next()) {
+            if (count % 2 == 0) {
+                REQUIRE(reader.kind() == Scene::Kind::SEGMENT);
+                REQUIRE(reader.segment().start().y() == 0.1 * (count / 2));
+            } else {
+                REQUIRE(reader.kind() == Scene::Kind::CIRCLE);
+                REQUIRE(reader.circle().radius() == Approx(0.5));
+            }
+            count++;
+        }
+        REQUIRE(count == 400);
+    }
+
+    SECTION("Write intersections")
+    {
+        std::ostringstream out;
+        WktWriter writer(out);
+
+        writer.write(Segment(-5, 0, 10, 0).intersect(Circle(0, 0, 2)));
+        writer.write(Points());
+
+        REQUIRE(out.str() == "MULTIPOINT ((2 0), (-2 0))\nMULTIPOINT EMPTY\n");
+    }
+
+    SECTION("Malformed input")
+    {
+        std::istringstream unknown("MULTIPOLYGON (((0 0, 1 0, 1 1, 0 0)))");
+        std::istringstream unclosed("LINESTRING (0 0, 1 1");
+        std::istringstream collinear("CIRCULARSTRING (0 0, 1 1, 2 2)");
+        std::istringstream chained("CIRCULARSTRING (0 0, 1 1, 2 0, 3 -1, 4 0)");
+        std::istringstream ring("POLYGON ((0 0, 1 0, 0 0))");
+        std::ostringstream written;
+        WktWriter(written).write(Point(1, 2));
+        std::istringstream bare_point(written.str());
+        std::istringstream multipoint("MULTIPOINT ((1 1), (2 2))");
+
+        REQUIRE_THROWS_AS(WktReader(unknown).next(), std::runtime_error);
+        REQUIRE_THROWS_AS(WktReader(unclosed).next(), std::runtime_error);
+        REQUIRE_THROWS_AS(WktReader(collinear).next(), std::runtime_error);
+        REQUIRE_THROWS_AS(WktReader(chained).next(), std::runtime_error);
+        REQUIRE_THROWS_AS(WktReader(ring).next(), std::runtime_error);
+        REQUIRE_THROWS_AS(WktReader(bare_point).next(), std::runtime_error);
+        REQUIRE_THROWS_AS(WktReader(multipoint).next(), std::runtime_error);
+    }
+
+    SECTION("Round trip of every written figure")
+    {
+        Polygon zone({{0, 0}, {10, 0}, {10, 10}, {0, 10}}, {{{2, 2}, {4, 2}, {4, 4}}});
+        Rectangle box(-3, -2, 5, 1);
+        Arc clockwise_end(1, 2, 3, 0.25, 4);
+        Arc wrapping(0, 0, 2, 3 * M_PI / 2, M_PI / 4);
+
+        std::ostringstream out;
+        WktWriter writer(out);
+        const Figure *figures[] = {&zone, &box, &clockwise_end, &wrapping};
+        for (const Figure *figure : figures) {
+            writer.write(*figure);
+        }
+
+        std::istringstream in(out.str());
+        Scene scene;
+        REQUIRE(read_wkt(in, scene) == 4);
+        for (std::size_t id = 0; id < scene.size(); id++) {
+            REQUIRE(scene.kind(id) == Scene::Kind::OTHER);
+            REQUIRE(scene[id].length() == Approx(figures[id]->length()));
+            REQUIRE(scene[id].bbox().min_x() == Approx(figures[id]->bbox().min_x()).margin(1e-9));
+            REQUIRE(scene[id].bbox().max_y() == Approx(figures[id]->bbox().max_y()).margin(1e-9));
+        }
+
+        auto polygon = dynamic_cast<const Polygon *>(&scene[0]);
+        REQUIRE(polygon);
+        REQUIRE(polygon->rings().size() == 2);
+        REQUIRE(polygon->area() == Approx(zone.area()));
+        REQUIRE(dynamic_cast<const Polygon *>(&scene[1])->area() == Approx(24));
+
+        auto arc = dynamic_cast<const Arc *>(&scene[2]);
+        REQUIRE(arc);
+        REQUIRE(arc->center().x() == Approx(1));
+        REQUIRE(arc->radius() == Approx(3));
+        REQUIRE(arc->sweep() == Approx(3.75));
+        REQUIRE(dynamic_cast<const Arc *>(&scene[3])->sweep() == Approx(3 * M_PI / 4));
+
+        //written again, they read back the same
+        std::ostringstream again;
+        WktWriter rewriter(again);
+        for (std::size_t id = 0; id < scene.size(); id++) {
+            rewriter.write(scene[id]);
+        }
+        std::istringstream reread(again.str());
+        WktReader reader(reread);
+        REQUIRE(reader.next());
+        REQUIRE(reader.figure().intersect(Segment(-1, 3, 11, 3)).size() == 4);
+    }
+}
+
+TEST_CASE("CSV loader", "[csv]")
+{
+    std::string path = (std::filesystem::temp_directory_path() / "figures_feed.csv").string();
+
+    SECTION("Load rows in parallel chunks")
+    {
+        {
+            std::ofstream out(path);
+            out << "kind,a,b,c,d\n";
+            for (int i = 0; i < 100; i++) {
+                out << "segment," << i << ",0," << i << ",10\n";
+                out << "circle," << i << ",5,0.25\r\n";
+            }
+            out << "# track 7\n";
+            for (int i = 0; i < 30; i++) {
+                out << "vertex,7," << i << "," << (i % 2) << "\n";
+            }
+            out << "\nvertex, 8, -1, 5\nvertex,8,101,5\n";
+        }
+
+        for (unsigned threads = 1; threads <= 7; threads += 3) {
+            CsvOptions options;
+            options.threads = threads;
+            Scene scene = load_csv(path, options);
+
+            REQUIRE(scene.size() == 202);
+            REQUIRE(scene.kind(0) == Scene::Kind::SEGMENT);
+            REQUIRE(scene.kind(199) == Scene::Kind::CIRCLE);
+            REQUIRE(scene.circle(199).center() == Point(99, 5));
+            REQUIRE(scene.kind(200) == Scene::Kind::POLYLINE);
+            REQUIRE(scene.polyline(200).size() == 30);
+            REQUIRE(scene.polyline(200).length() == Approx(29 * std::sqrt(2)));
+            REQUIRE(scene.polyline(201).size() == 2);
+            REQUIRE(scene[201].intersect(scene[0]).size() == 1);
+        }
+    }
+
+    SECTION("Files shorter than the thread count")
+    {
+        CsvOptions options;
+        options.threads = 8;
+        {
+            std::ofstream out(path);
+            out << "kind\n";
+        }
+        REQUIRE(load_csv(path, options).size() == 0);
+
+        {
+            std::ofstream out(path);
+            out << "kind,a,b,c,d\nsegment,0,0,1,1\n";
+        }
+        REQUIRE(load_csv(path, options).size() == 1);
+
+        {
+            std::ofstream out(path);
+        }
+        REQUIRE(load_csv(path, options).size() == 0);
+    }
+
+    SECTION("Tab separated")
+    {
+        {
+            std::ofstream out(path);
+            out << "circle\t0\t0\t2\nsegment\t-5\t0\t10\t0\n";
+        }
+        Scene scene = load_csv(path);
+
+        REQUIRE(scene.size() == 2);
+        REQUIRE(scene[0].intersect(scene[1]).size() == 2);
+    }
+
+    SECTION("Malformed row")
+    {
+        {
+            std::ofstream out(path);
+            out << "segment,0,0,1,1\nsegment,0,0,x,1\n";
+        }
+        REQUIRE_THROWS_AS(load_csv(path), std::runtime_error);
+
+        //a first row with numbers is data, not a header
+        {
+            std::ofstream out(path);
+            out << "segmnet,0,0,1,1\nsegment,0,0,2,1\n";
+        }
+        REQUIRE_THROWS_AS(load_csv(path), std::runtime_error);
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("CSV loader throughput", "[.][csv][benchmark]")
+{
+    std::string path = (std::filesystem::temp_directory_path() / "figures_feed_large.csv").string();
+    {
+        std::ofstream out(path);
+        out << "kind,a,b,c,d\n";
+        for (int i = 0; i < 400000; i++) {
+            out << "segment," << i << ",0.5," << i + 1 << ",10.25\n";
+            out << "circle," << i << ",5.5,0.25\n";
+            out << "vertex," << i / 10 << "," << i << "," << (i % 2) << "\n";
+        }
+    }
+    double megabytes = static_cast<double>(std::filesystem::file_size(path)) / (1 << 20);
+
+    std::size_t expected = 0;
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads : {1u, cores}) {
+        CsvOptions options;
+        options.threads = threads;
+        auto start = std::chrono::steady_clock::now();
+        Scene scene = load_csv(path, options);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        WARN(threads << " threads: " << megabytes / elapsed.count() << " MB/s");
+
+        if (expected == 0) {
+            expected = scene.size();
+        }
+        REQUIRE(scene.size() == expected);
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Index snapshots", "[index][file]")
+{
+    std::string path = (std::filesystem::temp_directory_path() / "figures_index.rtree").string();
+
+    std::vector<RTree::Entry> entries;
+    for (int i = 0; i < 1000; i++) {
+        entries.push_back({Segment(i, 0, i + 1, i % 7).bbox(), static_cast<std::uint64_t>(i)});
+    }
+    RTree tree(entries);
+    write_index(tree, 1000, path);
+
+    SECTION("Loads without rebuilding")
+    {
+        MappedIndex mapped(path, 1000);
+        BoundingBox window(100.5, 0, 120.5, 3);
+
+        REQUIRE(mapped.index().size() == 1000);
+        REQUIRE(mapped.index().nodes() != tree.nodes());
+        REQUIRE(mapped.index().query(window) == tree.query(window));
+    }
+
+    SECTION("Rejects stale or corrupted snapshots")
+    {
+        REQUIRE_THROWS_AS(MappedIndex(path, 999), std::runtime_error);
+
+        {
+            std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(-5, std::ios::end);
+            file.put('\x7f');
+        }
+        REQUIRE_THROWS_AS(MappedIndex(path, 1000), std::runtime_error);
+    }
+
+    SECTION("Rejects snapshots of a changed source")
+    {
+        std::string source = (std::filesystem::temp_directory_path() / "figures_index.wkt").string();
+        {
+            std::ofstream out(source);
+            out << "LINESTRING (0 0, 1 1)\n";
+        }
+        write_index(tree, 1000, path, source);
+        REQUIRE(MappedIndex(path, 1000, source).index().size() == 1000);
+
+        {
+            std::ofstream out(source, std::ios::app);
+            out << "LINESTRING (1 1, 2 2)\n";
+        }
+        REQUIRE_THROWS_AS(MappedIndex(path, 1000, source), IndexFileError);
+        std::remove(source.c_str());
+    }
+
+    SECTION("Rewrites leave mapped snapshots intact")
+    {
+        MappedIndex mapped(path, 1000);
+        RTree smaller(std::vector<RTree::Entry>(entries.begin(), entries.begin() + 10));
+        write_index(smaller, 10, path);
+
+        REQUIRE(mapped.index().size() == 1000);
+        BoundingBox window(100.5, 0, 120.5, 3);
+        REQUIRE(mapped.index().query(window) == tree.query(window));
+        REQUIRE(MappedIndex(path, 10).index().size() == 10);
+        for (const auto &file : std::filesystem::directory_iterator(std::filesystem::temp_directory_path())) {
+            REQUIRE(file.path().filename().string().rfind("figures_index.rtree.tmp", 0) != 0);
+        }
+    }
+
+    SECTION("Reports missing snapshots as I/O errors")
+    {
+        std::remove(path.c_str());
+        REQUIRE_THROWS_AS(MappedIndex(path, 1000), std::system_error);
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Sweep and prune", "[broadphase][sweep]")
+{
+    std::vector<Circle> circles;
+    for (int i = 0; i < 20; i++) {
+        circles.emplace_back(i * 3, (i % 3) * 3, 1);
+    }
+
+    SweepAndPrune sweep;
+    for (std::size_t id = 0; id < circles.size(); id++) {
+        sweep.insert(id, circles[id].bbox());
+    }
+
+    SECTION("Pairs match brute force while figures move")
+    {
+        for (int tick = 0; tick < 10; tick++) {
+            for (std::size_t id = 0; id < circles.size(); id++) {
+                double dx = (id % 2 == 0 ? 0.4 : -0.4);
+                circles[id] = Circle(circles[id].center().x() + dx, circles[id].center().y(), 1);
+                sweep.update(id, circles[id].bbox());
+            }
+            sweep.step();
+
+            std::vector<SweepAndPrune::Pair> expected;
+            for (std::size_t a = 0; a < circles.size(); a++) {
+                for (std::size_t b = a + 1; b < circles.size(); b++) {
+                    if (circles[a].bbox().intersects(circles[b].bbox())) {
+                        expected.emplace_back(a, b);
+                    }
+                }
+            }
+            REQUIRE(sweep.pairs() == expected);
+        }
+    }
+
+    SECTION("Pair events")
+    {
+        sweep.step();
+        REQUIRE(sweep.pairs().empty());
+
+        std::vector<SweepAndPrune::Pair> added;
+        std::vector<SweepAndPrune::Pair> removed;
+        auto on_added = [&](std::size_t a, std::size_t b) { added.emplace_back(a, b); };
+        auto on_removed = [&](std::size_t a, std::size_t b) { removed.emplace_back(a, b); };
+
+        circles[0] = Circle(3, 1.5, 1);
+        sweep.update(0, circles[0].bbox());
+        sweep.step(on_added, on_removed);
+
+        REQUIRE(added.size() == 1);
+        REQUIRE(added[0] == SweepAndPrune::Pair(0, 1));
+        REQUIRE(removed.empty());
+        REQUIRE(circles[0].intersect(circles[1]).size() == 2);
+
+        sweep.remove(1);
+        sweep.step(on_added, on_removed);
+
+        REQUIRE(removed.size() == 1);
+        REQUIRE(removed[0] == SweepAndPrune::Pair(0, 1));
+        REQUIRE(sweep.size() == 19);
+    }
+
+    SECTION("Insert again before the step")
+    {
+        circles[0] = Circle(3, 1.5, 1);
+        sweep.update(0, circles[0].bbox());
+        sweep.step();
+        REQUIRE(sweep.pairs().size() == 1);
+
+        sweep.remove(0);
+        sweep.insert(0, circles[0].bbox());
+        sweep.remove(0);
+        sweep.insert(0, circles[0].bbox());
+        sweep.step();
+
+        REQUIRE(sweep.size() == 20);
+        REQUIRE(sweep.pairs() == std::vector<SweepAndPrune::Pair>{{0, 1}});
+        REQUIRE(sweep.added().empty());
+        REQUIRE(sweep.removed().empty());
+    }
+
+    SECTION("Few movers keep the other pairs")
+    {
+        std::vector<BoundingBox> boxes;
+        for (const auto &circle : circles) {
+            boxes.push_back(circle.bbox());
+        }
+        //a wide box on the left that later movers reach from far right
+        boxes.push_back(BoundingBox(-20, -1, 20, 0.5));
+        sweep.insert(20, boxes[20]);
+
+        for (int tick = 0; tick < 30; tick++) {
+            std::size_t id = static_cast<std::size_t>(tick * 7 % 21);
+            double dx = (tick % 2 == 0 ? 2.5 : -1.5);
+            boxes[id] = BoundingBox(boxes[id].min_x() + dx, boxes[id].min_y(),
+                                    boxes[id].max_x() + dx, boxes[id].max_y());
+            sweep.update(id, boxes[id]);
+            if (tick == 10) {
+                sweep.remove(5);
+            }
+            if (tick == 20) {
+                sweep.insert(5, boxes[5]);
+            }
+            sweep.step();
+
+            std::vector<SweepAndPrune::Pair> expected;
+            for (std::size_t a = 0; a < boxes.size(); a++) {
+                for (std::size_t b = a + 1; b < boxes.size(); b++) {
+                    if (sweep.contains(a) && sweep.contains(b) && boxes[a].intersects(boxes[b])) {
+                        expected.emplace_back(a, b);
+                    }
+                }
+            }
+            REQUIRE(sweep.pairs() == expected);
+        }
+    }
+}
+
+TEST_CASE("Loose quadtree", "[index][quadtree]")
+{
+    std::vector<Segment> segments;
+    for (int i = 0; i < 200; i++) {
+        double x = (i * 37) % 100;
+        double y = (i * 61) % 100;
+        segments.emplace_back(x, y, x + (i % 5), y + (i % 3) - 1);
+    }
+    Circle circle(50, 50, 5);
+
+    LooseQuadtree tree(BoundingBox(0, 0, 100, 100));
+    for (std::size_t id = 0; id < segments.size(); id++) {
+        tree.insert(id, segments[id]);
+    }
+    tree.insert(segments.size(), circle);
+
+    auto brute_force = [&](const BoundingBox &window) {
+        std::vector<std::size_t> ids;
+        for (std::size_t id = 0; id < segments.size(); id++) {
+            if (segments[id].bbox().intersects(window)) {
+                ids.push_back(id);
+            }
+        }
+        if (circle.bbox().intersects(window)) {
+            ids.push_back(segments.size());
+        }
+        return ids;
+    };
+    auto query = [&](const BoundingBox &window) {
+        std::vector<std::size_t> ids;
+        tree.query(window, [&](std::size_t id) { ids.push_back(id); });
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+
+    SECTION("Window queries while figures move")
+    {
+        for (int tick = 0; tick < 20; tick++) {
+            for (std::size_t id = 0; id < segments.size(); id += 3) {
+                Point start = segments[id].start();
+                Point end = segments[id].end();
+                double dx = tick % 2 == 0 ? 7.5 : -3;
+                segments[id] = Segment(start.x() + dx, start.y() + 1, end.x() + dx, end.y() + 1);
+                tree.update(id);
+            }
+            BoundingBox window(tick * 4, 20, tick * 4 + 30, 60);
+            REQUIRE(query(window) == brute_force(window));
+        }
+        REQUIRE(tree.size() == 201);
+    }
+
+    SECTION("Figure overlap query")
+    {
+        std::vector<std::size_t> ids;
+        tree.query(Segment(0, 50, 100, 50), [&](std::size_t id) { ids.push_back(id); });
+
+        REQUIRE(std::find(ids.begin(), ids.end(), segments.size()) != ids.end());
+        for (std::size_t id : ids) {
+            if (id < segments.size()) {
+                REQUIRE_FALSE(segments[id].intersect(Segment(0, 50, 100, 50)).empty());
+            }
+        }
+    }
+
+    SECTION("Removing returns nodes to the pool")
+    {
+        std::size_t nodes = tree.node_count();
+        for (std::size_t id = 0; id <= segments.size(); id++) {
+            tree.remove(id);
+        }
+
+        REQUIRE(nodes > 1);
+        REQUIRE(tree.size() == 0);
+        REQUIRE(tree.node_count() == 1);
+        REQUIRE(query(BoundingBox(0, 0, 100, 100)).empty());
+
+        tree.insert(3, segments[3]);
+        REQUIRE(query(BoundingBox(0, 0, 100, 100)) == std::vector<std::size_t>{3});
+    }
+}
+
+TEST_CASE("Distances", "[figure][distance]")
+{
+    Segment segment(0, 0, 4, 0);
+    Circle circle(2, 5, 2);
+    Circle inner_circle(2, 5, 1);
+
+    std::vector<Point> polyline_points;
+    polyline_points.emplace_back(10, 0);
+    polyline_points.emplace_back(10, 10);
+    polyline_points.emplace_back(20, 10);
+    Polyline polyline(polyline_points);
+
+    SECTION("Point to figure")
+    {
+        REQUIRE(segment.distance(Point(2, 3)) == Approx(3));
+        REQUIRE(segment.distance(Point(7, 4)) == Approx(5));
+        REQUIRE(circle.distance(Point(2, 5)) == Approx(2));
+        REQUIRE(circle.distance(Point(2, 10)) == Approx(3));
+        REQUIRE(polyline.distance(Point(15, 12)) == Approx(2));
+        REQUIRE(polyline.distance(Point(10, 5)) == Approx(0));
+    }
+
+    SECTION("Figure to figure")
+    {
+        const Figure &figure = segment;
+
+        REQUIRE(segment.distance(Segment(0, 1, 4, 2)) == Approx(1));
+        REQUIRE(segment.distance(Segment(2, -1, 2, 1)) == Approx(0));
+        REQUIRE(segment.distance(Segment(5, 0, 6, 0)) == Approx(1));
+        REQUIRE(segment.distance(circle) == Approx(3));
+        REQUIRE(circle.distance(segment) == Approx(3));
+        REQUIRE(Segment(2, 4.5, 2, 5.5).distance(circle) == Approx(1.5));
+        REQUIRE(figure.distance(polyline) == Approx(6));
+        REQUIRE(polyline.distance(figure) == Approx(6));
+
+        REQUIRE(circle.distance(inner_circle) == Approx(1));
+        REQUIRE(circle.distance(Circle(8, 5, 1)) == Approx(3));
+        REQUIRE(circle.distance(Circle(4, 5, 1)) == Approx(0));
+        REQUIRE(circle.distance(polyline) == Approx(6));
+        REQUIRE(polyline.distance(circle) == Approx(6));
+
+        REQUIRE(polyline.distance(Polyline(polyline_points)) == Approx(0));
+        REQUIRE(polyline.distance(PolylineView(polyline_points.data() + 1, 2)) == Approx(0));
+    }
+}
+
+TEST_CASE("Nearest figures", "[index][distance]")
+{
+    Scene scene;
+    for (int i = 0; i < 30; i++) {
+        for (int j = 0; j < 30; j++) {
+            if ((i + j) % 3 == 0) {
+                scene.add(Circle(i * 10, j * 10, 1 + (i % 3)));
+            } else {
+                scene.add(Segment(i * 10, j * 10, i * 10 + 5, j * 10 + (j % 4)));
+            }
+        }
+    }
+    scene.build_index();
+
+    Point point(123.4, 87.6);
+    auto neighbors = scene.nearest(point, 5);
+
+    std::vector<double> distances;
+    for (std::size_t id = 0; id < scene.size(); id++) {
+        distances.push_back(scene[id].distance(point));
+    }
+    std::sort(distances.begin(), distances.end());
+
+    REQUIRE(neighbors.size() == 5);
+    for (std::size_t i = 0; i < neighbors.size(); i++) {
+        REQUIRE(neighbors[i].distance == Approx(distances[i]));
+        REQUIRE(scene[neighbors[i].id].distance(point) == Approx(distances[i]));
+    }
+    REQUIRE(scene.nearest(point, 0).empty());
+}
+
+TEST_CASE("Ray casting", "[figure][ray]")
+{
+    SECTION("Figures")
+    {
+        Ray ray(Point(0, 0), 1, 0);
+
+        REQUIRE(Segment(3, -1, 3, 1).first_hit(ray) == Approx(3));
+        REQUIRE(Segment(-3, -1, -3, 1).first_hit(ray) == HUGE_VAL);
+        REQUIRE(Segment(3, 1, 5, 1).first_hit(ray) == HUGE_VAL);
+        REQUIRE(Segment(5, 0, 2, 0).first_hit(ray) == Approx(2));
+        REQUIRE(Segment(-1, 0, 2, 0).first_hit(ray) == Approx(0));
+
+        Circle circle(10, 0, 2);
+        auto circle_hits = circle.hits(ray);
+        REQUIRE(circle_hits.size() == 2);
+        REQUIRE(circle_hits[0] == Approx(8));
+        REQUIRE(circle_hits[1] == Approx(12));
+        REQUIRE(circle.first_hit(Ray(Point(10, 0), 0, 1)) == Approx(2));
+        REQUIRE(Circle(5, 2, 2).hits(ray).size() == 1);
+        REQUIRE(circle.first_hit(Ray(Point(0, 0), 1, 0, 5)) == HUGE_VAL);
+
+        Polyline zigzag(std::vector<Point>{{1, -1}, {2, 1}, {3, -1}, {4, 1}});
+        auto zigzag_hits = zigzag.hits(ray);
+        REQUIRE(zigzag_hits.size() == 3);
+        REQUIRE(zigzag_hits[0] == Approx(1.5));
+        REQUIRE(zigzag_hits[2] == Approx(3.5));
+        REQUIRE(zigzag.first_hit(Ray(Point(5, 0), -1, 0)) == Approx(1.5));
+        REQUIRE(zigzag.hits(Ray(Point(2, -5), 0, 1)).size() == 1);
+
+        Ray diagonal = Ray::towards(Point(0, 0), Point(3, 4));
+        REQUIRE(diagonal.max_distance() == Approx(5));
+        REQUIRE(diagonal.at(5).x() == Approx(3));
+        REQUIRE(Segment(0, 2, 4, 2).first_hit(diagonal) == Approx(2.5));
+        REQUIRE(Segment(0, 6, 6, 6).first_hit(diagonal) == HUGE_VAL);
+    }
+
+    SECTION("Scene")
+    {
+        Scene scene;
+        for (int i = 0; i < 30; i++) {
+            for (int j = 0; j < 30; j++) {
+                if ((i + j) % 3 == 0) {
+                    scene.add(Circle(i * 10, j * 10, 1 + (i % 3)));
+                } else if ((i + j) % 3 == 1) {
+                    scene.add(Segment(i * 10, j * 10, i * 10 + 5, j * 10 + (j % 4)));
+                } else {
+                    scene.add(Polyline(std::vector<Point>{{i * 10.0, j * 10.0}, {i * 10 + 3.0, j * 10 + 4.0},
+                                                          {i * 10 + 6.0, j * 10.0}}));
+                }
+            }
+        }
+        scene.build_index();
+
+        std::vector<Ray> rays;
+        for (int i = 0; i < 20; i++) {
+            double angle = 0.05 + i * 0.07;
+            rays.emplace_back(Point(-7, 1.3), cos(angle), sin(angle));
+        }
+        rays.emplace_back(Point(-7, 1.3), -1, 0);
+        rays.emplace_back(Point(140, 140), 1, 1, 3);
+
+        auto packet = scene.first_hits(rays);
+        REQUIRE(packet.size() == rays.size());
+        for (std::size_t r = 0; r < rays.size(); r++) {
+            const Ray &ray = rays[r];
+            double nearest = HUGE_VAL;
+            std::size_t hit_count = 0;
+            for (std::size_t id = 0; id < scene.size(); id++) {
+                nearest = fmin(nearest, scene[id].first_hit(ray));
+                hit_count += scene[id].hits(ray).size();
+            }
+
+            auto first = scene.first_hit(ray);
+            auto all = scene.hits(ray);
+            REQUIRE(all.size() == hit_count);
+            REQUIRE(std::is_sorted(all.begin(), all.end(), [](const RayHit &a, const RayHit &b) {
+                return a.distance < b.distance;
+            }));
+            if (nearest == HUGE_VAL) {
+                REQUIRE(!first);
+                REQUIRE(!packet[r]);
+                continue;
+            }
+            REQUIRE(first);
+            REQUIRE(first->distance == Approx(nearest));
+            REQUIRE(scene[first->id].first_hit(ray) == Approx(nearest));
+            REQUIRE(packet[r]);
+            REQUIRE(packet[r]->id == first->id);
+            REQUIRE(all.front().distance == Approx(nearest));
+        }
+        REQUIRE(!scene.first_hit(rays[20]));
+    }
+}
+
+TEST_CASE("Spatial join", "[index][join]")
+{
+    Scene a, b;
+    for (int i = 0; i < 40; i++) {
+        for (int j = 0; j < 25; j++) {
+            if ((i + j) % 2 == 0) {
+                a.add(Circle(i * 7.0, j * 11.0, 2 + (i % 4)));
+            } else {
+                a.add(Segment(i * 7.0, j * 11.0, i * 7.0 + 9, j * 11.0 + (j % 5) - 2));
+            }
+            b.add(Segment(i * 6.5 + 3, j * 12.0 - 1, i * 6.5 + 1, j * 12.0 + 6));
+        }
+    }
+    // spans every tile
+    a.add(Segment(-10, -10, 300, 310));
+    b.add(Polyline(std::vector<Point>{{-5, 100}, {150, 90}, {300, 120}}));
+
+    std::vector<JoinPair> expected;
+    for (std::size_t i = 0; i < a.size(); i++) {
+        for (std::size_t j = 0; j < b.size(); j++) {
+            if (!a[i].intersect(b[j]).empty()) {
+                expected.push_back({i, j});
+            }
+        }
+    }
+    REQUIRE(!expected.empty());
+
+    SECTION("In memory")
+    {
+        JoinOptions options;
+        options.threads = 3;
+        REQUIRE(spatial_join(a, b, options) == expected);
+
+        options.grid = 9;
+        REQUIRE(spatial_join(a, b, options) == expected);
+
+        b.build_index();
+        options.grid = 1;
+        REQUIRE(spatial_join(a, b, options) == expected);
+    }
+
+    SECTION("Streamed with points")
+    {
+        JoinOptions options;
+        options.threads = 3;
+        std::vector<std::vector<JoinPair>> found(options.threads);
+        std::vector<std::size_t> mismatches(options.threads);
+        spatial_join(a, b, options, [&](unsigned worker, std::size_t i, std::size_t j, const Points &points) {
+            found[worker].push_back({i, j});
+            mismatches[worker] += points.size() != a[i].intersect(b[j]).size();
+        });
+
+        std::vector<JoinPair> pairs;
+        for (const auto &worker : found) {
+            pairs.insert(pairs.end(), worker.begin(), worker.end());
+        }
+        std::sort(pairs.begin(), pairs.end());
+        REQUIRE(pairs == expected);
+        REQUIRE(std::count(mismatches.begin(), mismatches.end(), 0) == 3);
+    }
+
+    SECTION("Spilled")
+    {
+        auto directory = std::filesystem::temp_directory_path() / "figures_test_join";
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+
+        JoinOptions options;
+        options.grid = 7;
+        options.threads = 4;
+        options.memory_budget = 64 * sizeof(RTree::Entry);
+        options.spill_directory = directory.string();
+        REQUIRE(spatial_join(a, b, options) == expected);
+        REQUIRE(std::filesystem::is_empty(directory));
+
+        options.spill_directory = (directory / "missing").string();
+        REQUIRE_THROWS_AS(spatial_join(a, b, options), std::runtime_error);
+        std::filesystem::remove_all(directory);
+    }
+
+    SECTION("Disjoint")
+    {
+        Scene far;
+        far.add(Circle(1000, 1000, 1));
+        REQUIRE(spatial_join(a, far).empty());
+        REQUIRE(spatial_join(Scene(), b).empty());
+    }
+}
+
+TEST_CASE("Polyline self-intersections", "[figure][polyline]")
+{
+    SECTION("Simple")
+    {
+        Polyline zigzag(std::vector<Point>{{0, 0}, {1, 1}, {2, 0}, {3, 1}, {4, 0}});
+        REQUIRE(zigzag.is_simple());
+        REQUIRE(zigzag.self_intersections().empty());
+
+        Polyline square(std::vector<Point>{{0, 0}, {2, 0}, {2, 2}, {0, 2}, {0, 0}});
+        REQUIRE(square.is_simple());
+        REQUIRE(Polyline(std::vector<Point>{{0, 0}, {1, 1}}).is_simple());
+        REQUIRE(Polyline(std::vector<Point>{}).is_simple());
+    }
+
+    SECTION("Crossing")
+    {
+        Polyline bow(std::vector<Point>{{0, 0}, {2, 2}, {2, 0}, {0, 2}});
+        REQUIRE(!bow.is_simple());
+        auto points = bow.self_intersections();
+        REQUIRE(points.size() == 1);
+        REQUIRE(misc::contains_point(points, Point(1, 1)));
+
+        Polyline spiral(std::vector<Point>{{0, 0}, {4, 0}, {4, 4}, {1, 4}, {1, -1}});
+        points = spiral.self_intersections();
+        REQUIRE(points.size() == 1);
+        REQUIRE(misc::contains_point(points, Point(1, 0)));
+
+        Polyline touch(std::vector<Point>{{0, 0}, {4, 0}, {4, 2}, {2, 2}, {2, 0}, {2, -2}});
+        REQUIRE(!touch.is_simple());
+        REQUIRE(misc::contains_point(touch.self_intersections(), Point(2, 0)));
+    }
+
+    SECTION("Fold")
+    {
+        Polyline fold(std::vector<Point>{{0, 0}, {4, 0}, {1, 0}});
+        REQUIRE(!fold.is_simple());
+        auto points = fold.self_intersections();
+        REQUIRE(points.size() == 1);
+        REQUIRE(misc::contains_point(points, Point(1, 0)));
+    }
+
+    SECTION("Matches brute force")
+    {
+        std::vector<Point> walk;
+        double x = 0, y = 0;
+        for (int i = 0; i < 300; i++) {
+            walk.emplace_back(x, y);
+            x += cos(i * 0.7) * (1 + i % 5) + 0.3;
+            y += sin(i * 1.3) * (1 + i % 3);
+        }
+        Polyline polyline(walk);
+
+        std::size_t expected = 0;
+        for (std::size_t i = 0; i + 1 < walk.size(); i++) {
+            for (std::size_t j = i + 2; j + 1 < walk.size(); j++) {
+                expected += Segment(walk[i], walk[i + 1]).intersect(Segment(walk[j], walk[j + 1])).size();
+            }
+        }
+        REQUIRE(expected > 0);
+        REQUIRE(polyline.self_intersections().size() == expected);
+        REQUIRE(!polyline.is_simple());
+    }
+}
+
+TEST_CASE("Polyline monotone chains", "[figure][polyline]")
+{
+    Polyline zigzag(std::vector<Point>{{0, 0}, {1, 1}, {2, 3}, {3, 1}, {4, 0}, {5, 0}, {6, 2}});
+    const auto &chains = zigzag.chains();
+    REQUIRE(chains.size() == 3);
+    REQUIRE(chains[0].first == 0);
+    REQUIRE(chains[0].last == 2);
+    REQUIRE(chains[1].first == 2);
+    REQUIRE(chains[1].last == 5);
+    REQUIRE(chains[2].first == 5);
+    REQUIRE(chains[2].last == 6);
+
+    Polyline copy(zigzag);
+    REQUIRE(&copy.chains() == &chains);
+    REQUIRE(Polyline(std::vector<Point>{{1, 1}}).chains().empty());
+
+    std::vector<Point> wave, track;
+    for (int i = 0; i < 400; i++) {
+        wave.emplace_back(i * 0.5, 3 * sin(i * 0.2));
+        track.emplace_back(100 - i * 0.45 + cos(i * 0.9), 2 * cos(i * 0.13) + 0.1);
+    }
+    Polyline first(wave);
+    Polyline second(track);
+
+    auto count_brute_force = [](const Polyline &a, const Polyline &b) {
+        std::size_t count = 0;
+        for (const auto &segment : a.segments()) {
+            for (const auto &other : b.segments()) {
+                count += segment.intersect(other).size();
+            }
+        }
+        return count;
+    };
+
+    auto points = first.intersect(second);
+    REQUIRE(points.size() == count_brute_force(first, second));
+    REQUIRE(points.size() > 10);
+    for (const auto &point : points) {
+        REQUIRE(first.distance(point) < 1e-6);
+        REQUIRE(second.distance(point) < 1e-6);
+    }
+
+    Segment segment(0, -1, 180, 2);
+    auto segment_points = segment.intersect(first);
+    std::size_t expected = 0;
+    for (const auto &other : first.segments()) {
+        expected += segment.intersect(other).size();
+    }
+    REQUIRE(segment_points.size() == expected);
+    REQUIRE(first.intersect(segment).size() == expected);
+}
+
+TEST_CASE("Merging close points", "[figure][result]")
+{
+    SECTION("Small")
+    {
+        Points points;
+        points.emplace_back(1, 1);
+        points.emplace_back(2, 2);
+        points.emplace_back(1 + EPS / 2, 1 - EPS / 2);
+        points.emplace_back(1 + 2 * EPS, 1);
+        merge_close_points(points);
+        REQUIRE(points.size() == 3);
+        REQUIRE(points[0].x() == 1);
+        REQUIRE(points[1].x() == 2);
+        REQUIRE(points[2].x() == Approx(1 + 2 * EPS));
+    }
+
+    SECTION("Hashed")
+    {
+        Points points;
+        for (int i = 0; i < 1000; i++) {
+            points.emplace_back(i * 0.1, -i * 0.05);
+            points.emplace_back(i * 0.1 + EPS / 3, -i * 0.05 - EPS / 3);
+        }
+        for (int i = 0; i < 1000; i += 7) {
+            points.emplace_back(i * 0.1 - EPS / 4, -i * 0.05);
+        }
+        merge_close_points(points);
+        REQUIRE(points.size() == 1000);
+        for (int i = 0; i < 1000; i++) {
+            REQUIRE(points[i].x() == Approx(i * 0.1));
+        }
+    }
+
+    SECTION("Intersect flag")
+    {
+        std::vector<Point> zigzag;
+        for (int i = 0; i <= 200; i++) {
+            zigzag.emplace_back(i, i % 2 == 0 ? 0 : 1);
+        }
+        Polyline polyline(zigzag);
+        Segment axis(-1, 0, 201, 0);
+
+        REQUIRE(axis.intersect(polyline).size() == 200);
+        auto merged = axis.intersect(polyline, std::pmr::get_default_resource(), Duplicates::MERGE);
+        REQUIRE(merged.size() == 101);
+        REQUIRE(polyline.intersect(axis, std::pmr::get_default_resource(), Duplicates::MERGE).size() == 101);
+
+        Polyline other(std::vector<Point>{{-1, 0}, {201, 0}});
+        REQUIRE(polyline.intersect(other, std::pmr::get_default_resource(), Duplicates::MERGE).size() == 101);
+        const Figure &figure = other;
+        REQUIRE(figure.intersect(polyline, std::pmr::get_default_resource(), Duplicates::MERGE).size() == 101);
+
+        Polyline star(std::vector<Point>{{0, 0}, {4, 0}, {2, 2}, {2, -2}, {3, -2}, {2, 0}});
+        REQUIRE(star.self_intersections().size() > star.self_intersections(
+                std::pmr::get_default_resource(), Duplicates::MERGE).size());
+    }
+}
+
+TEST_CASE("Polyline linear referencing", "[figure][polyline]")
+{
+    Polyline track(std::vector<Point>{{0, 0}, {3, 4}, {3, 10}, {3, 10}, {0, 14}});
+
+    const auto &lengths = track.cumulative_lengths();
+    REQUIRE(lengths.size() == 5);
+    REQUIRE(lengths[1] == Approx(5));
+    REQUIRE(lengths[3] == Approx(11));
+    REQUIRE(track.length() == Approx(16));
+    REQUIRE(Polyline(std::vector<Point>{}).length() == 0);
+
+    SECTION("Point at")
+    {
+        REQUIRE(track.point_at(2.5) == Point(1.5, 2));
+        REQUIRE(track.point_at(5) == Point(3, 4));
+        REQUIRE(track.point_at(8) == Point(3, 7));
+        REQUIRE(track.point_at(11) == Point(3, 10));
+        REQUIRE(track.point_at(13.5) == Point(1.5, 12));
+        REQUIRE(track.point_at(-1) == Point(0, 0));
+        REQUIRE(track.point_at(100) == Point(0, 14));
+        REQUIRE_THROWS_AS(Polyline(std::vector<Point>{}).point_at(1), std::invalid_argument);
+    }
+
+    SECTION("Sub polyline")
+    {
+        Polyline part = track.sub_polyline(2.5, 13.5);
+        REQUIRE(part.length() == Approx(11));
+        REQUIRE(part[0] == Point(1.5, 2));
+        REQUIRE(part[1] == Point(3, 4));
+        REQUIRE(part[part.size() - 1] == Point(1.5, 12));
+        REQUIRE(!part.is_view());
+
+        Polyline reversed = track.sub_polyline(8, 6);
+        REQUIRE(reversed.size() == 2);
+        REQUIRE(reversed.length() == Approx(2));
+
+        REQUIRE(track.sub_polyline(-5, 100).length() == Approx(16));
+        REQUIRE(track.sub_polyline(5, 5).length() == Approx(0));
+    }
+
+    SECTION("Project")
+    {
+        REQUIRE(track.project(Point(5, 7)) == Approx(8));
+        REQUIRE(track.project(Point(-1, -1)) == Approx(0));
+        REQUIRE(track.project(Point(0, 20)) == Approx(16));
+        REQUIRE(track.project(Point(3, 4)) == Approx(5));
+
+        std::vector<Point> wave;
+        for (int i = 0; i < 500; i++) {
+            wave.emplace_back(i * 0.3, 4 * sin(i * 0.05));
+        }
+        Polyline polyline(wave);
+        for (int k = 0; k < 20; k++) {
+            Point point(k * 7.3, 3 * cos(k * 1.7));
+            double along = polyline.project(point);
+            REQUIRE(point.distance(polyline.point_at(along)) == Approx(polyline.distance(point)));
+        }
+    }
+}
+
+TEST_CASE("Polyline simplification", "[figure][polyline][simplify]")
+{
+    std::vector<Point> track;
+    for (int i = 0; i < 5000; i++) {
+        track.emplace_back(i * 0.02, 10 * sin(i * 0.002) + 0.001 * sin(i * 1.7));
+    }
+    Polyline polyline(track);
+
+    SECTION("Douglas peucker")
+    {
+        double tolerance = 0.01;
+        auto kept = douglas_peucker(polyline, tolerance);
+        REQUIRE(kept.front() == 0);
+        REQUIRE(kept.back() == track.size() - 1);
+        REQUIRE(kept.size() * 20 < track.size());
+        REQUIRE(std::is_sorted(kept.begin(), kept.end()));
+
+        Polyline coarse = simplify(polyline, tolerance);
+        REQUIRE(coarse.size() == kept.size());
+        for (std::size_t i = 0; i < track.size(); i += 37) {
+            REQUIRE(coarse.distance(track[i]) <= tolerance + EPS);
+        }
+
+        REQUIRE(douglas_peucker(Polyline(std::vector<Point>{{0, 0}, {1, 1}}), 1).size() == 2);
+        REQUIRE(douglas_peucker(Polyline(std::vector<Point>{{0, 0}, {1, 0}, {2, 0}}), 0).size() == 2);
+    }
+
+    SECTION("Visvalingam")
+    {
+        Polyline steps(std::vector<Point>{{0, 0}, {1, 0.01}, {2, 0}, {3, 2}, {4, 0}});
+        auto kept = visvalingam(steps, 0.1);
+        REQUIRE(kept == std::vector<std::size_t>{0, 2, 3, 4});
+        REQUIRE(visvalingam(steps, 0).size() == 5);
+
+        auto reduced = visvalingam(polyline, 0.001);
+        REQUIRE(reduced.front() == 0);
+        REQUIRE(reduced.back() == track.size() - 1);
+        REQUIRE(reduced.size() * 10 < track.size());
+    }
+
+    SECTION("Pyramid")
+    {
+        PolylinePyramid pyramid(polyline, 0.005, 6);
+        REQUIRE(pyramid.levels().size() == 6);
+        for (std::size_t i = 1; i < pyramid.levels().size(); i++) {
+            REQUIRE(pyramid.levels()[i].polyline.size() <= pyramid.levels()[i - 1].polyline.size());
+        }
+        const auto &coarsest = pyramid.levels().back();
+        for (std::size_t k = 0; k + 1 < coarsest.vertices.size(); k++) {
+            Segment segment(track[coarsest.vertices[k]], track[coarsest.vertices[k + 1]]);
+            for (std::size_t i = coarsest.vertices[k]; i <= coarsest.vertices[k + 1]; i += 11) {
+                REQUIRE(segment.distance(track[i]) <= coarsest.deviations[k] + EPS);
+            }
+        }
+
+        Segment segment(0, 3, 100, -1);
+        Circle circle(50, -8, 3);
+        Polyline crossing(std::vector<Point>{{10, -12}, {30, 12}, {60, -12}, {90, 12}});
+        const Figure *others[] = {&segment, &circle, &crossing};
+        for (const Figure *other : others) {
+            auto expected = polyline.intersect(*other);
+            auto points = pyramid.intersect(*other);
+            REQUIRE(!expected.empty());
+            REQUIRE(points.size() == expected.size());
+            for (const auto &point : expected) {
+                REQUIRE(misc::contains_point(points, point));
+            }
+        }
+        REQUIRE(pyramid.intersect(Circle(50, 50, 1)).empty());
+    }
+}
+
+TEST_CASE("Polyline editing", "[figure][polyline]")
+{
+    auto require_same = [](const Polyline &edited, const std::vector<Point> &points) {
+        Polyline fresh(points);
+        REQUIRE(edited.size() == points.size());
+        for (std::size_t i = 0; i < points.size(); i++) {
+            REQUIRE(edited[i] == points[i]);
+        }
+        REQUIRE(edited.bbox().min_x() == fresh.bbox().min_x());
+        REQUIRE(edited.bbox().max_x() == fresh.bbox().max_x());
+        REQUIRE(edited.bbox().min_y() == fresh.bbox().min_y());
+        REQUIRE(edited.bbox().max_y() == fresh.bbox().max_y());
+        REQUIRE(edited.length() == Approx(fresh.length()));
+        REQUIRE(edited.cumulative_lengths().size() == points.size());
+        for (std::size_t i = 0; i < points.size(); i++) {
+            REQUIRE(edited.cumulative_lengths()[i] == Approx(fresh.cumulative_lengths()[i]));
+        }
+        REQUIRE(edited.chains().size() == fresh.chains().size());
+        for (std::size_t i = 0; i < fresh.chains().size(); i++) {
+            REQUIRE(edited.chains()[i].first == fresh.chains()[i].first);
+            REQUIRE(edited.chains()[i].last == fresh.chains()[i].last);
+        }
+    };
+
+    SECTION("Append")
+    {
+        Polyline track(std::vector<Point>{});
+        track.length();
+        track.chains();
+        std::vector<Point> points;
+        for (int i = 0; i < 300; i++) {
+            Point point(i * 0.5 + sin(i * 0.3), 3 * cos(i * 0.11));
+            track.append(point);
+            points.push_back(point);
+        }
+        require_same(track, points);
+
+        Polyline copy(track);
+        copy.append(Point(200, 0));
+        points.push_back(Point(200, 0));
+        require_same(copy, points);
+        REQUIRE(track.size() == 300);
+        REQUIRE(track.cumulative_lengths().size() == 300);
+        REQUIRE(track.chains().back().last == 299);
+    }
+
+    SECTION("Insert and erase")
+    {
+        std::vector<Point> points{{0, 0}, {3, 4}, {3, 10}, {0, 14}, {-2, 12}};
+        Polyline track(points);
+        track.length();
+
+        track.insert(2, Point(6, 7));
+        points.insert(points.begin() + 2, Point(6, 7));
+        require_same(track, points);
+
+        track.insert(0, Point(-5, -5));
+        points.insert(points.begin(), Point(-5, -5));
+        require_same(track, points);
+
+        track.erase(0);
+        points.erase(points.begin());
+        require_same(track, points);
+
+        track.erase(1, 3);
+        points.erase(points.begin() + 1, points.begin() + 4);
+        require_same(track, points);
+
+        track.erase(track.size() - 1);
+        points.pop_back();
+        require_same(track, points);
+
+        REQUIRE_THROWS_AS(track.insert(10, Point(0, 0)), std::out_of_range);
+        REQUIRE_THROWS_AS(track.erase(1, 5), std::out_of_range);
+    }
+
+    SECTION("View")
+    {
+        std::vector<Point> points{{0, 0}, {1, 1}, {2, 0}};
+        PolylineView view(points.data(), points.size());
+        view.append(Point(3, 1));
+        REQUIRE(!view.is_view());
+        REQUIRE(view.size() == 4);
+        REQUIRE(points.size() == 3);
+        REQUIRE(view.length() == Approx(3 * sqrt(2)));
+    }
+}
+
+TEST_CASE("Polygon", "[figure][polygon]")
+{
+    Polygon zone({{0, 0}, {10, 0}, {10, 10}, {0, 10}}, {{{4, 4}, {6, 4}, {6, 6}, {4, 6}}});
+
+    SECTION("Measures")
+    {
+        REQUIRE(zone.rings().size() == 2);
+        REQUIRE(zone.outer().size() == 5);
+        REQUIRE(zone.area() == Approx(96));
+        REQUIRE(zone.length() == Approx(48));
+        REQUIRE(zone.bbox().max_x() == 10);
+        REQUIRE_THROWS_AS(Polygon({{0, 0}, {1, 1}}), std::invalid_argument);
+    }
+
+    SECTION("Point in polygon")
+    {
+        REQUIRE(zone.contains(Point(1, 1)));
+        REQUIRE(zone.contains(Point(5, 2)));
+        REQUIRE(!zone.contains(Point(5, 5)));
+        REQUIRE(!zone.contains(Point(11, 5)));
+        REQUIRE(!zone.contains(Point(5, -1)));
+        REQUIRE(zone.contains(Point(0, 5)));
+        REQUIRE(zone.contains(Point(5, 10)));
+        REQUIRE(zone.contains(Point(4, 5)));
+        REQUIRE(zone.contains(Point(10, 10)));
+
+        std::vector<Point> star;
+        for (int i = 0; i < 40; i++) {
+            double radius = i % 2 == 0 ? 10 : 4;
+            star.emplace_back(radius * cos(i * M_PI / 20), radius * sin(i * M_PI / 20));
+        }
+        Polygon shape(star);
+        Polyline ring = shape.outer();
+        for (int i = 0; i < 400; i++) {
+            Point point(-11 + (i * 37 % 220) * 0.1, -11 + (i * 53 % 220) * 0.1);
+            //crossing number against the ring
+            bool inside = false;
+            for (std::size_t k = 1; k < ring.size(); k++) {
+                const Point &a = ring[k - 1], &b = ring[k];
+                if ((a.y() > point.y()) != (b.y() > point.y())
+                        && point.x() < a.x() + (point.y() - a.y()) * (b.x() - a.x()) / (b.y() - a.y())) {
+                    inside = !inside;
+                }
+            }
+            if (ring.distance(point) > 1e-6) {
+                REQUIRE(shape.contains(point) == inside);
+            }
+        }
+    }
+
+    SECTION("Boundary")
+    {
+        Segment segment(-1, 5, 11, 5);
+        auto points = zone.intersect(segment);
+        REQUIRE(points.size() == 4);
+        REQUIRE(misc::contains_point(points, Point(0, 5)));
+        REQUIRE(misc::contains_point(points, Point(6, 5)));
+        REQUIRE(segment.intersect(zone).size() == 4);
+        const Figure &figure = zone;
+        REQUIRE(segment.intersect(figure).size() == 4);
+        REQUIRE(zone.intersect(Circle(5, 5, 0.5)).empty());
+        REQUIRE(zone.intersect(Polygon({{8, 8}, {12, 8}, {12, 12}, {8, 12}})).size() == 2);
+
+        REQUIRE(zone.distance(Point(5, 5)) == Approx(1));
+        REQUIRE(zone.distance(Segment(12, 0, 12, 10)) == Approx(2));
+        REQUIRE(Circle(5, 5, 0.5).distance(zone) == Approx(0.5));
+        REQUIRE(zone.first_hit(Ray(Point(-2, 5), 1, 0)) == Approx(2));
+        REQUIRE(zone.hits(Ray(Point(-2, 5), 1, 0)).size() == 4);
+    }
+
+    SECTION("Containment")
+    {
+        REQUIRE(zone.contains(Circle(2, 2, 1)));
+        REQUIRE(!zone.contains(Circle(2, 2, 3)));
+        REQUIRE(!zone.contains(Circle(5, 5, 3)));
+        REQUIRE(!zone.contains(Circle(5, 5, 0.5)));
+        REQUIRE(zone.contains(Segment(1, 1, 9, 2)));
+        REQUIRE(!zone.contains(Segment(1, 1, 9, 9)));
+        REQUIRE(!zone.contains(Circle(20, 20, 1)));
+        REQUIRE(zone.contains(Polyline(std::vector<Point>{{1, 1}, {3, 9}, {9, 9}})));
+        REQUIRE(zone.contains(Polygon({{1, 1}, {3, 1}, {3, 3}})));
+        REQUIRE(!zone.contains(Polygon({{1, 1}, {9, 1}, {9, 9}, {1, 9}})));
+
+        REQUIRE(zone.overlaps(Circle(2, 2, 1)));
+        REQUIRE(zone.overlaps(Segment(-1, -1, 1, 1)));
+        REQUIRE(!zone.overlaps(Circle(5, 5, 0.5)));
+        REQUIRE(!zone.overlaps(Segment(11, 0, 12, 10)));
+        REQUIRE(zone.overlaps(Circle(5, 5, 30)));
+    }
+
+    SECTION("Wkt")
+    {
+        std::ostringstream out;
+        WktWriter(out).write(static_cast<const Figure &>(Polygon({{0, 0}, {2, 0}, {0, 2}})));
+        REQUIRE(out.str() == "POLYGON ((0 0, 2 0, 0 2, 0 0))\n");
+    }
+}
+
+TEST_CASE("Rectangle", "[figure][rectangle]")
+{
+    Rectangle window(10, 10, 0, 0);
+
+    SECTION("Measures")
+    {
+        REQUIRE(window.box().min_x() == 0);
+        REQUIRE(window.box().max_y() == 10);
+        REQUIRE(window.area() == Approx(100));
+        REQUIRE(window.length() == Approx(40));
+    }
+
+    SECTION("Segment clipping")
+    {
+        auto points = window.intersect(Segment(-5, 5, 15, 5));
+        REQUIRE(points.size() == 2);
+        REQUIRE(misc::contains_point(points, Point(0, 5)));
+        REQUIRE(misc::contains_point(points, Point(10, 5)));
+        REQUIRE(Segment(5, 5, 15, 5).intersect(window).size() == 1);
+        REQUIRE(window.intersect(Segment(2, 2, 8, 8)).empty());
+        REQUIRE(window.intersect(Segment(-5, 15, 15, 14)).empty());
+        REQUIRE(window.intersect(Segment(-5, 5, 5, 15)).size() == 1);
+
+        //against the generic polyline boundary
+        Polyline ring(std::vector<Point>{{0, 0}, {10, 0}, {10, 10}, {0, 10}, {0, 0}});
+        for (int i = 0; i < 200; i++) {
+            Segment segment(-3 + (i * 37 % 160) * 0.1, -3 + (i * 53 % 160) * 0.1,
+                            -3 + (i * 71 % 160) * 0.1, -3 + (i * 29 % 160) * 0.1);
+            auto fast = window.intersect(segment, std::pmr::get_default_resource(), Duplicates::MERGE);
+            auto slow = ring.intersect(segment, std::pmr::get_default_resource(), Duplicates::MERGE);
+            REQUIRE(fast.size() == slow.size());
+            for (const auto &point : slow) {
+                REQUIRE(misc::contains_point(fast, point));
+            }
+        }
+    }
+
+    SECTION("Circle and polyline")
+    {
+        REQUIRE(window.intersect(Circle(5, 5, 2)).empty());
+        REQUIRE(window.intersect(Circle(20, 20, 3)).empty());
+        REQUIRE(window.intersect(Circle(5, 0, 2)).size() == 2);
+        REQUIRE(window.intersect(Circle(5, 5, 6)).size() == 8);
+
+        Polyline track(std::vector<Point>{{-1, 5}, {2, 5}, {3, 6}, {4, 5}, {12, 5}, {12, 8}, {5, 8}, {5, 12}});
+        REQUIRE(window.intersect(track).size() == 4);
+        REQUIRE(track.intersect(window).size() == 4);
+        REQUIRE(window.intersect(Rectangle(5, 5, 15, 15)).size() == 2);
+        REQUIRE(window.intersect(Rectangle(2, 2, 3, 3)).empty());
+
+        REQUIRE(window.distance(Point(5, 4)) == Approx(4));
+        REQUIRE(window.distance(Point(13, 14)) == Approx(5));
+        REQUIRE(window.distance(Circle(5, 5, 2)) == Approx(3));
+        REQUIRE(window.distance(Rectangle(12, 0, 14, 4)) == Approx(2));
+        REQUIRE(Segment(-3, 0, -1, 0).distance(window) == Approx(1));
+        REQUIRE(window.first_hit(Ray(Point(-2, 5), 1, 0)) == Approx(2));
+        REQUIRE(window.hits(Ray(Point(-1, -1), 1, 1)).size() == 2);
+    }
+
+    SECTION("Polyline clip")
+    {
+        Polyline track(std::vector<Point>{{-5, 5}, {5, 5}, {5, 15}, {8, 15}, {8, 5}, {8, 2}});
+        auto pieces = window.clip(track);
+        REQUIRE(pieces.size() == 2);
+        REQUIRE(pieces[0].size() == 3);
+        REQUIRE(pieces[0][0] == Point(0, 5));
+        REQUIRE(pieces[0][2] == Point(5, 10));
+        REQUIRE(pieces[1].size() == 3);
+        REQUIRE(pieces[1][0] == Point(8, 10));
+        REQUIRE(pieces[1][2] == Point(8, 2));
+        REQUIRE(window.clip(Polyline(std::vector<Point>{{20, 20}, {30, 30}})).empty());
+    }
+
+    SECTION("Regions")
+    {
+        REQUIRE(window.contains(Point(10, 5)));
+        REQUIRE(window.contains(Circle(5, 5, 2)));
+        REQUIRE(!window.contains(Circle(5, 5, 5)));
+        REQUIRE(window.overlaps(Circle(5, 5, 2)));
+        REQUIRE(window.overlaps(Circle(5, 5, 30)));
+        REQUIRE(!window.overlaps(Circle(30, 30, 2)));
+        REQUIRE(!window.overlaps(Segment(11, 0, 15, 12)));
+
+        Polygon zone({{-1, -1}, {11, -1}, {11, 11}, {-1, 11}});
+        REQUIRE(zone.contains(window));
+        REQUIRE(window.overlaps(zone));
+        REQUIRE(zone.intersect(window).empty());
+        REQUIRE(zone.distance(window) == Approx(1));
+    }
+
+    SECTION("Wkt")
+    {
+        std::ostringstream out;
+        WktWriter(out).write(static_cast<const Figure &>(Rectangle(0, 0, 2, 1)));
+        REQUIRE(out.str() == "POLYGON ((0 0, 2 0, 2 1, 0 1, 0 0))\n");
+    }
+}
+
+TEST_CASE("Arc", "[figure][arc]")
+{
+    //upper half of the unit circle around (0, 0)
+    Arc upper(0, 0, 1, 0, M_PI);
+
+    SECTION("Measures")
+    {
+        REQUIRE(upper.sweep() == Approx(M_PI));
+        REQUIRE(upper.length() == Approx(M_PI));
+        REQUIRE(upper.start() == Point(1, 0));
+        REQUIRE(upper.end() == Point(-1, 0));
+        REQUIRE(upper.bbox().min_y() == Approx(0).margin(1e-12));
+        REQUIRE(upper.bbox().max_y() == Approx(1));
+        REQUIRE(Arc(0, 0, 1, 0, 0).sweep() == Approx(2 * M_PI));
+        REQUIRE(Arc(0, 0, 1, M_PI, -M_PI / 2).sweep() == Approx(M_PI / 2));
+
+        Arc wrapping(0, 0, 2, 3 * M_PI / 2, M_PI / 2);
+        REQUIRE(wrapping.spans(Point(2, 0)));
+        REQUIRE(!wrapping.spans(Point(-2, 0)));
+        REQUIRE(wrapping.bbox().max_x() == Approx(2));
+        REQUIRE(wrapping.bbox().min_x() == Approx(0).margin(1e-12));
+    }
+
+    SECTION("Intersections")
+    {
+        REQUIRE(upper.intersect(Segment(-2, 0.5, 2, 0.5)).size() == 2);
+        REQUIRE(upper.intersect(Segment(-2, -0.5, 2, -0.5)).empty());
+        REQUIRE(Segment(0, 0, 0, 5).intersect(upper).size() == 1);
+        REQUIRE(upper.intersect(Circle(0, -1, 1)).empty());
+        REQUIRE(upper.intersect(Circle(0, 1, 1)).size() == 2);
+        REQUIRE(upper.intersect(Circle(0, 0, 1)).empty());
+
+        Polyline zigzag(std::vector<Point>{{-2, 0.5}, {2, 0.5}, {2, -0.5}, {-2, -0.5}});
+        REQUIRE(upper.intersect(zigzag).size() == 2);
+        REQUIRE(zigzag.intersect(upper).size() == 2);
+
+        Arc lower(0, 0.5, 1, M_PI, 2 * M_PI);
+        auto points = upper.intersect(lower);
+        REQUIRE(points.size() == 2);
+        REQUIRE(misc::contains_point(points, Point(sqrt(0.9375), 0.25)));
+        REQUIRE(upper.intersect(Arc(0, 0.5, 1, 0, M_PI)).empty());
+
+        REQUIRE(Rectangle(-0.5, 0.5, 0.5, 2).intersect(upper).size() == 2);
+        REQUIRE(Polygon({{-2, 0.5}, {2, 0.5}, {2, 2}, {-2, 2}}).intersect(upper).size() == 2);
+
+        //against a dense tessellation of the same arc
+        std::vector<Point> dense;
+        for (int i = 0; i <= 2000; i++) {
+            dense.emplace_back(cos(i * M_PI / 2000), sin(i * M_PI / 2000));
+        }
+        Polyline tessellated(dense);
+        for (int i = 0; i < 50; i++) {
+            Segment segment(-1.5 + (i * 37 % 30) * 0.1, -0.5 + (i * 53 % 20) * 0.1,
+                            -1.5 + (i * 71 % 30) * 0.1, -0.5 + (i * 29 % 20) * 0.1);
+            auto exact = upper.intersect(segment);
+            auto approx = tessellated.intersect(segment, std::pmr::get_default_resource(), Duplicates::MERGE);
+            if (approx.size() == exact.size()) {
+                for (const auto &point : exact) {
+                    REQUIRE(tessellated.distance(point) < 1e-5);
+                }
+            }
+        }
+    }
+
+    SECTION("Distance and rays")
+    {
+        REQUIRE(upper.distance(Point(0, 3)) == Approx(2));
+        REQUIRE(upper.distance(Point(0, -3)) == Approx(sqrt(10)));
+        REQUIRE(upper.distance(Point(0, 0)) == Approx(1));
+        REQUIRE(upper.distance(Segment(-3, 2, 3, 2)) == Approx(1));
+        REQUIRE(upper.distance(Segment(-3, -2, 3, -2)) == Approx(2));
+        REQUIRE(upper.distance(Circle(0, -3, 1)) == Approx(sqrt(10) - 1));
+        REQUIRE(upper.distance(Circle(0, 3, 1)) == Approx(1));
+        REQUIRE(upper.distance(Arc(0, 0, 3, 0, M_PI)) == Approx(2));
+        REQUIRE(upper.distance(Arc(0, -0.5, 1, M_PI, 2 * M_PI)) == Approx(0.5));
+        REQUIRE(upper.distance(Arc(0, 3, 1, M_PI, 2 * M_PI)) == Approx(1));
+        REQUIRE(upper.distance(Arc(0, -2, 0.5, 0, M_PI)) == Approx(sqrt(5) - 0.5));
+        REQUIRE(Polyline(std::vector<Point>{{-3, 2}, {3, 2}, {3, 4}}).distance(upper) == Approx(1));
+        REQUIRE(Rectangle(-3, 2, 3, 4).distance(upper) == Approx(1));
+
+        REQUIRE(upper.first_hit(Ray(Point(0, -3), 0, 1)) == Approx(4));
+        REQUIRE(upper.hits(Ray(Point(-3, 0.5), 1, 0)).size() == 2);
+        REQUIRE(upper.first_hit(Ray(Point(-3, -0.5), 1, 0)) == HUGE_VAL);
+    }
+
+    SECTION("Wkt")
+    {
+        std::ostringstream out;
+        WktWriter(out).write(static_cast<const Figure &>(Arc(0, 0, 2, 0, M_PI)));
+        REQUIRE(out.str().rfind("CIRCULARSTRING (2 0, ", 0) == 0);
+    }
+}
+
+TEST_CASE("Bezier", "[figure][bezier]")
+{
+    //y = 1 - x^2 for x in [-1, 1]
+    Bezier arch(Point(-1, 0), Point(0, 2), Point(1, 0));
+    Bezier wave(Point(0, 0), Point(1, 2), Point(2, -2), Point(3, 0));
+
+    SECTION("Shape")
+    {
+        REQUIRE(arch.degree() == 2);
+        REQUIRE(wave.degree() == 3);
+        REQUIRE(arch.at(0.5) == Point(0, 1));
+        REQUIRE(wave.at(1) == Point(3, 0));
+        REQUIRE(arch.bbox().max_y() == Approx(1));
+        REQUIRE(arch.bbox().min_x() == Approx(-1));
+        REQUIRE(wave.bbox().max_y() == Approx(wave.at(0.5 - sqrt(3) / 6).y()));
+        REQUIRE(wave.bbox().max_y() < 1);
+        REQUIRE(arch.length() == Approx(sqrt(5) + asinh(2) / 2).epsilon(1e-6));
+        REQUIRE_THROWS_AS(Bezier(std::vector<Point>{{0, 0}, {1, 1}}), std::invalid_argument);
+    }
+
+    SECTION("Flattening")
+    {
+        auto coarse = arch.flattened(0.1);
+        auto fine = arch.flattened(0.001);
+        REQUIRE(coarse->size() < fine->size());
+        REQUIRE(arch.flattened(0.1) == coarse);
+        REQUIRE(arch.flattened(0.07) == coarse);
+        REQUIRE((*coarse)[0] == Point(-1, 0));
+        REQUIRE((*coarse)[coarse->size() - 1] == Point(1, 0));
+        for (int i = 0; i <= 100; i++) {
+            REQUIRE(coarse->distance(arch.at(i / 100.0)) <= 0.07);
+        }
+
+        Bezier copy = arch;
+        REQUIRE(copy.flattened(0.1) == coarse);
+
+        //older tolerances make room, but stay valid while held
+        for (double tolerance : {0.01, 1e-4, 1e-5, 1e-6}) {
+            arch.flattened(tolerance);
+        }
+        REQUIRE(arch.flattened(0.1) != coarse);
+        REQUIRE(coarse->size() == arch.flattened(0.1)->size());
+
+        //a straight cubic costs one segment
+        REQUIRE(Bezier(Point(0, 0), Point(1, 1), Point(2, 2), Point(3, 3)).flattened(0.01)->size() == 2);
+    }
+
+    SECTION("Intersections")
+    {
+        auto points = arch.intersect(Segment(-2, 0.75, 2, 0.75));
+        REQUIRE(points.size() == 2);
+        REQUIRE(misc::contains_point(points, Point(0.5, 0.75)));
+        REQUIRE(misc::contains_point(points, Point(-0.5, 0.75)));
+        REQUIRE(Segment(0, -1, 0, 3).intersect(arch).size() == 1);
+        REQUIRE(arch.intersect(Segment(-2, 2, 2, 2)).empty());
+        REQUIRE(arch.intersect(Circle(0, 0, 0.9)).size() == 4);
+        REQUIRE(arch.intersect(Circle(5, 5, 1)).empty());
+        REQUIRE(arch.intersect(Polyline(std::vector<Point>{{-2, 0.75}, {0, 0.75}, {0, 3}})).size() == 2);
+        REQUIRE(Rectangle(-0.5, 0.5, 0.5, 2).intersect(arch).size() == 2);
+        REQUIRE(Polygon({{-0.5, 0.5}, {0.5, 0.5}, {0.5, 2}, {-0.5, 2}}).intersect(arch).size() == 2);
+        REQUIRE(arch.intersect(Arc(0, 0, 0.9, 0, M_PI / 2)).size() == 2);
+
+        auto crossings = wave.intersect(Segment(-1, 0, 4, 0));
+        REQUIRE(crossings.size() == 3);
+        REQUIRE(misc::contains_point(crossings, Point(1.5, 0)));
+
+        Bezier flipped(Point(-1, 1), Point(0, -1), Point(1, 1));
+        auto both = arch.intersect(flipped);
+        REQUIRE(both.size() == 2);
+        REQUIRE(misc::contains_point(both, Point(sqrt(0.5), 0.5)));
+        REQUIRE(static_cast<const Figure &>(flipped).intersect(static_cast<const Figure &>(arch)).size() == 2);
+
+        Bezier long_arch(Point(-1000, 0), Point(0, 2000), Point(1000, 0));
+        auto top = long_arch.intersect(Segment(0, 0, 0, 2000));
+        REQUIRE(top.size() == 1);
+        REQUIRE(top[0].y() == Approx(1000));
+        REQUIRE(long_arch.intersect(Segment(-1, 999, 1, 999)).empty());
+    }
+
+    SECTION("Distance and rays")
+    {
+        REQUIRE(arch.distance(Point(0, 3)) == Approx(2).epsilon(1e-4));
+        REQUIRE(arch.distance(Segment(-2, 2, 2, 2)) == Approx(1).epsilon(1e-4));
+        REQUIRE(Circle(0, 3, 1).distance(arch) == Approx(1).epsilon(1e-4));
+        REQUIRE(Rectangle(-2, 2, 2, 4).distance(arch) == Approx(1).epsilon(1e-4));
+        REQUIRE(arch.first_hit(Ray(Point(0, 5), 0, -1)) == Approx(4).epsilon(1e-4));
+        REQUIRE(arch.hits(Ray(Point(-2, 0.75), 1, 0)).size() == 2);
+        REQUIRE(arch.first_hit(Ray(Point(5, 5), 1, 0)) == HUGE_VAL);
+    }
+}
+
+TEST_CASE("Transformed figures", "[figure][transform]")
+{
+    auto footprint = std::make_shared<const Polyline>(std::vector<Point>{{0, 0}, {2, 0}, {2, 1}});
+
+    SECTION("Affine")
+    {
+        Affine move = Affine::translation(3, 4) * Affine::rotation(M_PI / 2);
+        REQUIRE(move(Point(1, 0)) == Point(3, 5));
+        REQUIRE(move.inverse()(Point(3, 5)) == Point(1, 0));
+        REQUIRE((move * move.inverse())(Point(7, -2)) == Point(7, -2));
+        REQUIRE(move.similarity_scale() == Approx(1));
+        REQUIRE((Affine::scaling(2, 2) * Affine::scaling(1, -1)).similarity_scale() == Approx(2));
+        REQUIRE(Affine::scaling(2, 1).similarity_scale() == 0);
+        REQUIRE_THROWS_AS(Affine::scaling(0, 1).inverse(), std::invalid_argument);
+    }
+
+    SECTION("Placed polyline")
+    {
+        Affine matrix = Affine::translation(10, 0) * Affine::rotation(M_PI / 2) * Affine::scaling(2, 2);
+        Transformed placed(footprint, matrix);
+        auto world = transform(*footprint, matrix);
+
+        REQUIRE(placed.bbox().min_x() == Approx(8));
+        REQUIRE(placed.bbox().max_y() == Approx(4));
+        REQUIRE(placed.length() == Approx(world->length()));
+
+        Segment query(5, 1, 12, 1);
+        auto points = placed.intersect(query);
+        REQUIRE(points.size() == 1);
+        REQUIRE(misc::contains_point(points, Point(10, 1)));
+        REQUIRE(query.intersect(placed).size() == 1);
+        REQUIRE(misc::contains_point(query.intersect(*world), Point(10, 1)));
+
+        //a long query maps the shape out instead
+        std::vector<Point> zigzag;
+        for (int i = 0; i < 20; i++) {
+            zigzag.emplace_back(5 + i * 0.5, i % 2 == 0 ? 0.5 : 1.5);
+        }
+        Polyline track(zigzag);
+        REQUIRE(placed.intersect(track, std::pmr::get_default_resource(), Duplicates::MERGE).size()
+                == world->intersect(track, std::pmr::get_default_resource(), Duplicates::MERGE).size());
+        REQUIRE(placed.intersect(track).size() == world->intersect(track).size());
+        REQUIRE(placed.world()->bbox().min_x() == Approx(world->bbox().min_x()));
+
+        REQUIRE(placed.distance(Point(12, 2)) == Approx(world->distance(Point(12, 2))));
+        REQUIRE(placed.distance(Circle(15, 2, 1)) == Approx(world->distance(Circle(15, 2, 1))));
+        REQUIRE(placed.first_hit(Ray(Point(0, 2), 1, 0)) == Approx(10));
+        REQUIRE(placed.hits(Ray(Point(0, 2), 1, 0)).size() == world->hits(Ray(Point(0, 2), 1, 0)).size());
+    }
+
+    SECTION("Circles")
+    {
+        auto unit = std::make_shared<const Circle>(0, 0, 1);
+        Transformed ring(unit, Affine::translation(5, 5) * Affine::scaling(3, 3));
+        REQUIRE(ring.bbox().min_x() == Approx(2));
+        REQUIRE(ring.intersect(Segment(0, 5, 10, 5)).size() == 2);
+        REQUIRE(ring.distance(Point(5, 5)) == Approx(3));
+        REQUIRE(ring.encloses(Point(6, 6)));
+
+        //an ellipse with semi-axes 3 and 1
+        Transformed ellipse(unit, Affine::scaling(3, 1));
+        REQUIRE(ellipse.bbox().max_x() == Approx(3));
+        auto points = ellipse.intersect(Segment(-5, 0.5, 5, 0.5));
+        REQUIRE(points.size() == 2);
+        for (const auto &point : points) {
+            REQUIRE(pow(point.x() / 3, 2) + pow(point.y(), 2) == Approx(1).epsilon(1e-4));
+        }
+        REQUIRE(ellipse.intersect(Circle(0, 0, 2)).size() == 4);
+        REQUIRE(ellipse.distance(Point(0, 3)) == Approx(2).epsilon(1e-4));
+        REQUIRE(ellipse.first_hit(Ray(Point(-5, 0), 1, 0)) == Approx(2));
+        REQUIRE(ellipse.length() > 2 * M_PI * 2);
+    }
+
+    SECTION("Instances")
+    {
+        Transformed a(footprint, Affine::translation(0, 0));
+        Transformed b(footprint, Affine::translation(1, 0.5));
+        Transformed c(footprint, Affine::translation(20, 0));
+        REQUIRE(!a.intersect(b).empty());
+        const Figure &figure = b;
+        REQUIRE(a.intersect(figure).size() == transform(*footprint, Affine::translation(1, 0.5))->intersect(*footprint).size());
+        REQUIRE(a.intersect(c).empty());
+        REQUIRE(a.distance(c) == Approx(18));
+
+        Transformed nested(std::make_shared<const Transformed>(b), Affine::translation(-1, -0.5));
+        REQUIRE(nested.bbox().min_x() == Approx(0));
+        REQUIRE(nested.distance(Point(1, -1)) == Approx(1));
+
+        Transformed copy = b;
+        REQUIRE(copy.bbox().min_y() == Approx(0.5));
+    }
+}
+
+TEST_CASE("Swept circle contact", "[collision]")
+{
+    //unit circle moving right by 10 over the step
+    SweptCircle agent{Circle(0, 0, 1), 10, 0};
+
+    SECTION("Segments")
+    {
+        REQUIRE(time_of_contact(agent, Segment(5, -3, 5, 3)) == Approx(0.4));
+        REQUIRE(time_of_contact(agent, Segment(5, 1.5, 5, 3)) == HUGE_VAL);
+        REQUIRE(time_of_contact(agent, Segment(20, -3, 20, 3)) == HUGE_VAL);
+        //reached by its end: center at distance 1 from (5, 0.5)
+        REQUIRE(time_of_contact(agent, Segment(5, 0.5, 5, 3)) == Approx((5 - sqrt(0.75)) / 10));
+        //parallel, touched by the side offset
+        REQUIRE(time_of_contact(agent, Segment(3, 1, 8, 1)) == Approx(0.3));
+        REQUIRE(time_of_contact(agent, Segment(-0.5, 1, 2, 1)) == 0);
+        //inside the circle until an end reaches the line
+        REQUIRE(time_of_contact(agent, Segment(-0.5, 0, 0.5, 0)) == Approx(0.05));
+        //tunnelling: the step jumps right over a thin wall
+        REQUIRE(agent.at(1).intersect(Segment(5, -3, 5, 3)).empty());
+        REQUIRE(time_of_contact(SweptCircle{Circle(0, 0, 1), 0, 0}, Segment(5, -3, 5, 3)) == HUGE_VAL);
+    }
+
+    SECTION("Circles")
+    {
+        REQUIRE(time_of_contact(agent, Circle(6, 0, 1)) == Approx(0.4));
+        REQUIRE(time_of_contact(agent, Circle(6, 3, 1)) == HUGE_VAL);
+        REQUIRE(time_of_contact(agent, Circle(0.5, 0, 1)) == 0);
+        //a large ring around the agent is touched from inside
+        REQUIRE(time_of_contact(agent, Circle(0, 0, 5)) == Approx(0.4));
+    }
+
+    SECTION("Polylines and others")
+    {
+        std::vector<Point> wall;
+        for (int i = 0; i <= 40; i++) {
+            wall.emplace_back(8 + (i % 2) * 0.5, -10 + i * 0.5);
+        }
+        REQUIRE(time_of_contact(agent, Polyline(wall)) == Approx(0.7));
+        REQUIRE(time_of_contact(agent, Polyline(std::vector<Point>{{0, 5}, {10, 5}, {10, 8}})) == HUGE_VAL);
+
+        const Figure &box = Rectangle(4, -2, 6, 2);
+        REQUIRE(time_of_contact(agent, box) == Approx(0.3));
+        REQUIRE(time_of_contact(agent, Polygon({{4, -2}, {6, -2}, {6, 2}})) == Approx((5 - sqrt(20) / 4) / 10));
+        REQUIRE(time_of_contact(agent, Arc(6, 0, 1, M_PI / 2, 3 * M_PI / 2)) == Approx(0.4));
+        REQUIRE(time_of_contact(agent, Arc(6, 0, 1, -M_PI / 2, M_PI / 2)) == Approx(0.6));
+        REQUIRE(time_of_contact(agent, Bezier(Point(5, -3), Point(4, 0), Point(5, 3))) == Approx(0.35).margin(1e-4));
+
+        //the same wall placed by a similarity and by a stretch
+        auto post = std::make_shared<Segment>(-1.5, 0, 1.5, 0);
+        Transformed placed(post, Affine::translation(5, 0) * Affine::rotation(M_PI / 2) * Affine::scaling(2, 2));
+        REQUIRE(time_of_contact(agent, placed) == Approx(0.4));
+        Transformed stretched(post, Affine::translation(5, 0) * Affine::rotation(M_PI / 2) * Affine::scaling(2, 1));
+        REQUIRE(time_of_contact(agent, stretched) == Approx(0.4));
+        Transformed ring(std::make_shared<Circle>(0, 0, 0.25), Affine::translation(6, 0) * Affine::scaling(2, 2));
+        REQUIRE(time_of_contact(agent, ring) == Approx(0.45));
+
+        //sampled against the discrete overlap test
+        Polyline zigzag(std::vector<Point>{{3, -2}, {4, 2}, {5, -2}, {6, 2}});
+        double time = time_of_contact(agent, zigzag);
+        REQUIRE(agent.at(time).distance(zigzag) == Approx(0).margin(1e-6));
+        REQUIRE(agent.at(time - 1e-3).distance(zigzag) > 0);
+    }
+
+    SECTION("Scene")
+    {
+        Scene scene;
+        scene.add(Segment(5, -3, 5, 3));
+        scene.add(Circle(3, 0, 0.5));
+        scene.add(Polyline(std::vector<Point>{{0, 10}, {10, 10}}));
+        scene.add(std::make_unique<Rectangle>(-6, -1, -4, 1));
+        scene.add(std::make_unique<Transformed>(std::make_shared<Rectangle>(0, 0, 1, 1),
+                                                Affine::translation(0, -8) * Affine::rotation(M_PI / 4)));
+        scene.build_index();
+
+        auto contact = scene.first_contact(agent);
+        REQUIRE(contact);
+        REQUIRE(contact->id == 1);
+        REQUIRE(contact->time == Approx(0.15));
+
+        auto contacts = scene.first_contacts({agent, SweptCircle{Circle(0, 0, 1), -10, 0},
+                                              SweptCircle{Circle(0, 5, 1), 0, 1}});
+        REQUIRE(contacts.size() == 3);
+        REQUIRE(contacts[0]->id == 1);
+        REQUIRE(contacts[1]->id == 3);
+        REQUIRE(contacts[1]->time == Approx(0.3));
+        REQUIRE(!contacts[2]);
+
+        //the rotated square has its top corner at (0, -8 + sqrt(2))
+        auto placed = scene.first_contact(SweptCircle{Circle(0, -3, 1), 0, -10});
+        REQUIRE(placed);
+        REQUIRE(placed->id == 4);
+        REQUIRE(placed->time == Approx((4 - sqrt(2)) / 10));
+    }
+}
@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include "arc.h"
+#include "bezier.h"
+#include "polygon.h"
+#include "ray.h"
+#include "rectangle.h"
+#include "transform.h"
+
+namespace {
+
+// same as the Polyline caches: threads may race to build it, one result
+// wins and the others are dropped
+template <typename T, typename Build>
+const T &lazy_cache(std::shared_ptr<const T> &slot, Build &&build)
+{
+    auto cached = std::atomic_load(&slot);
+    if (!cached) {
+        std::shared_ptr<const T> built = build();
+        cached = built;
+        std::shared_ptr<const T> expected;
+        if (!std::atomic_compare_exchange_strong(&slot, &expected, built)) {
+            cached = expected;
+        }
+    }
+    return *cached;
+}
+
+std::vector<Point> transformed_points(const Polyline &polyline, const Affine &matrix)
+{
+    std::vector<Point> points;
+    points.reserve(polyline.size());
+    for (const auto &point : polyline) {
+        points.push_back(matrix(point));
+    }
+    return points;
+}
+
+// Image of a circular arc under a matrix that is not a similarity, an
+// elliptic arc, as a polyline with chords within EPS of it
+std::unique_ptr<Figure> sampled_arc(const Point &center, double radius, double start, double sweep,
+                                    const Affine &matrix)
+{
+    //the Frobenius norm bounds how far the matrix stretches the radius
+    double stretched = radius * sqrt(matrix.a() * matrix.a() + matrix.b() * matrix.b()
+                                     + matrix.c() * matrix.c() + matrix.d() * matrix.d());
+    double step = stretched > EPS ? 2 * acos(1 - EPS / stretched) : sweep;
+    std::size_t count = std::min<std::size_t>(std::max(2.0, ceil(sweep / step)), 1 << 16);
+
+    std::vector<Point> points;
+    points.reserve(count + 1);
+    for (std::size_t i = 0; i <= count; i++) {
+        double angle = start + sweep * i / count;
+        points.push_back(matrix(Point(center.x() + radius * cos(angle), center.y() + radius * sin(angle))));
+    }
+    return std::make_unique<Polyline>(points);
+}
+
+// vertices a figure brings to a query, which decides which side gets mapped
+std::size_t vertex_count(const Figure &figure)
+{
+    if (auto polyline = dynamic_cast<const Polyline *>(&figure)) {
+        return polyline->size();
+    }
+    if (auto polygon = dynamic_cast<const Polygon *>(&figure)) {
+        std::size_t count = 0;
+        for (const auto &ring : polygon->rings()) {
+            count += ring.size();
+        }
+        return count;
+    }
+    if (auto transformed = dynamic_cast<const Transformed *>(&figure)) {
+        return vertex_count(transformed->shape());
+    }
+    return 4;
+}
+
+}//namespace
+
+//Affine
+
+Affine Affine::rotation(double angle)
+{
+    return Affine(cos(angle), -sin(angle), sin(angle), cos(angle), 0, 0);
+}
+
+BoundingBox Affine::operator()(const BoundingBox &box) const
+{
+    BoundingBox result;
+    result.expand((*this)(Point(box.min_x(), box.min_y())));
+    result.expand((*this)(Point(box.max_x(), box.min_y())));
+    result.expand((*this)(Point(box.max_x(), box.max_y())));
+    result.expand((*this)(Point(box.min_x(), box.max_y())));
+    return result;
+}
+
+Affine Affine::operator*(const Affine &other) const
+{
+    return Affine(a_ * other.a_ + b_ * other.c_, a_ * other.b_ + b_ * other.d_,
+                  c_ * other.a_ + d_ * other.c_, c_ * other.b_ + d_ * other.d_,
+                  a_ * other.tx_ + b_ * other.ty_ + tx_, c_ * other.tx_ + d_ * other.ty_ + ty_);
+}
+
+Affine Affine::inverse() const
+{
+    double det = determinant();
+    if (det == 0 || !std::isfinite(det)) {
+        throw std::invalid_argument("affine: singular matrix");
+    }
+    double a = d_ / det, b = -b_ / det, c = -c_ / det, d = a_ / det;
+    return Affine(a, b, c, d, -(a * tx_ + b * ty_), -(c * tx_ + d * ty_));
+}
+
+double Affine::similarity_scale() const
+{
+    double scale = sqrt(a_ * a_ + c_ * c_);
+    double tolerance = 1e-12 * fmax(scale, 1);
+    bool rotation = fabs(a_ - d_) <= tolerance && fabs(b_ + c_) <= tolerance;
+    bool reflection = fabs(a_ + d_) <= tolerance && fabs(b_ - c_) <= tolerance;
+    return rotation || reflection ? scale : 0;
+}
+
+std::unique_ptr<Figure> transform(const Figure &figure, const Affine &matrix)
+{
+    double scale = matrix.similarity_scale();
+
+    if (auto segment = dynamic_cast<const Segment *>(&figure)) {
+        return std::make_unique<Segment>(matrix(segment->start()), matrix(segment->end()));
+    }
+    if (auto circle = dynamic_cast<const Circle *>(&figure)) {
+        if (scale == 0) {
+            return sampled_arc(circle->center(), circle->radius(), 0, 2 * M_PI, matrix);
+        }
+        Point center = matrix(circle->center());
+        return std::make_unique<Circle>(center.x(), center.y(), circle->radius() * scale);
+    }
+    if (auto polyline = dynamic_cast<const Polyline *>(&figure)) {
+        return std::make_unique<Polyline>(transformed_points(*polyline, matrix));
+    }
+    if (auto polygon = dynamic_cast<const Polygon *>(&figure)) {
+        std::vector<std::vector<Point>> holes;
+        for (std::size_t i = 1; i < polygon->rings().size(); i++) {
+            holes.push_back(transformed_points(polygon->rings()[i], matrix));
+        }
+        return std::make_unique<Polygon>(transformed_points(polygon->outer(), matrix), holes);
+    }
+    if (auto rectangle = dynamic_cast<const Rectangle *>(&figure)) {
+        const BoundingBox &box = rectangle->box();
+        if (matrix.b() == 0 && matrix.c() == 0) {
+            return std::make_unique<Rectangle>(matrix(box));
+        }
+        return std::make_unique<Polygon>(std::vector<Point>{
+            matrix(Point(box.min_x(), box.min_y())), matrix(Point(box.max_x(), box.min_y())),
+            matrix(Point(box.max_x(), box.max_y())), matrix(Point(box.min_x(), box.max_y()))});
+    }
+    if (auto arc = dynamic_cast<const Arc *>(&figure)) {
+        if (scale == 0) {
+            return sampled_arc(arc->center(), arc->radius(), arc->start_angle(), arc->sweep(), matrix);
+        }
+        Point center = matrix(arc->center());
+        Point start = matrix(arc->start());
+        Point end = matrix(arc->end());
+        if (arc->sweep() >= 2 * M_PI) {
+            end = start;
+        }
+        double start_angle = atan2(start.y() - center.y(), start.x() - center.x());
+        double end_angle = atan2(end.y() - center.y(), end.x() - center.x());
+        //a reflection turns the sweep clockwise
+        if (matrix.determinant() < 0) {
+            std::swap(start_angle, end_angle);
+        }
+        return std::make_unique<Arc>(center.x(), center.y(), arc->radius() * scale, start_angle, end_angle);
+    }
+    if (auto bezier = dynamic_cast<const Bezier *>(&figure)) {
+        std::vector<Point> control;
+        for (const auto &point : bezier->control()) {
+            control.push_back(matrix(point));
+        }
+        return std::make_unique<Bezier>(control);
+    }
+    if (auto transformed = dynamic_cast<const Transformed *>(&figure)) {
+        return std::make_unique<Transformed>(transformed->shared_shape(), matrix * transformed->matrix());
+    }
+    throw std::invalid_argument("transform: unsupported figure type");
+}
+
+//Transformed
+
+Transformed::Transformed(std::shared_ptr<const Figure> shape, const Affine &matrix)
+    : shape_(std::move(shape)),
+      matrix_(matrix),
+      inverse_(matrix.inverse()),
+      scale_(matrix.similarity_scale())
+{
+    if (!shape_) {
+        throw std::invalid_argument("transformed: null shape");
+    }
+}
+
+Transformed::Transformed(const Transformed &other)
+    : shape_(other.shape_),
+      matrix_(other.matrix_),
+      inverse_(other.inverse_),
+      scale_(other.scale_),
+      bbox_(std::atomic_load(&other.bbox_)) {}
+
+Transformed &Transformed::operator=(const Transformed &other)
+{
+    if (this != &other) {
+        shape_ = other.shape_;
+        matrix_ = other.matrix_;
+        inverse_ = other.inverse_;
+        scale_ = other.scale_;
+        bbox_ = std::atomic_load(&other.bbox_);
+    }
+    return *this;
+}
+
+double Transformed::length() const
+{
+    return scale_ > 0 ? scale_ * shape_->length() : world()->length();
+}
+
+BoundingBox Transformed::bbox() const
+{
+    return lazy_cache(bbox_, [&]() {
+        //vertex shapes are walked in place, the others through a world copy
+        //that is dropped once the box is known
+        const Polyline *outline = dynamic_cast<const Polyline *>(shape_.get());
+        if (auto polygon = dynamic_cast<const Polygon *>(shape_.get())) {
+            outline = &polygon->outer();
+        }
+        BoundingBox box;
+        if (outline) {
+            for (const auto &point : *outline) {
+                box.expand(matrix_(point));
+            }
+        } else {
+            box = world()->bbox();
+        }
+        return std::make_shared<const BoundingBox>(box);
+    });
+}
+
+Points Transformed::intersect_figure(const Figure &other, std::pmr::memory_resource *resource) const
+{
+    if (!bbox().intersects(other.bbox())) {
+        return Points(resource);
+    }
+    if (vertex_count(other) > vertex_count(*shape_)) {
+        return other.intersect(*world(), resource);
+    }
+    auto query = transform(other, inverse_);
+    Points result = shape_->intersect(*query, resource);
+    for (auto &point : result) {
+        point = matrix_(point);
+    }
+    return result;
+}
+
+double Transformed::distance_figure(const Figure &other) const
+{
+    if (scale_ == 0) {
+        return world()->distance(other);
+    }
+    return scale_ * shape_->distance(*transform(other, inverse_));
+}
+
+Points Transformed::intersect(const Figure &other, std::pmr::memory_resource *resource) const
+{
+    return intersect_figure(other, resource);
+}
+
+Points Transformed::intersect(const Segment &other, std::pmr::memory_resource *resource) const
+{
+    return intersect_figure(other, resource);
+}
+
+Points Transformed::intersect(const Circle &other, std::pmr::memory_resource *resource) const
+{
+    return intersect_figure(other, resource);
+}
+
+Points Transformed::intersect(const Polyline &other, std::pmr::memory_resource *resource) const
+{
+    return intersect_figure(other, resource);
+}
+
+Points Transformed::intersect(const Polygon &other, std::pmr::memory_resource *resource) const
+{
+    return intersect_figure(other, resource);
+}
+
+Points Transformed::intersect(const Rectangle &other, std::pmr::memory_resource *resource) const
+{
+    return intersect_figure(other, resource);
+}
+
+Points Transformed::intersect(const Arc &other, std::pmr::memory_resource *resource) const
+{
+    return intersect_figure(other, resource);
+}
+
+Points Transformed::intersect(const Bezier &other, std::pmr::memory_resource *resource) const
+{
+    return intersect_figure(other, resource);
+}
+
+double Transformed::distance(const Point &point) const
+{
+    return scale_ > 0 ? scale_ * shape_->distance(inverse_(point)) : world()->distance(point);
+}
+
+double Transformed::distance(const Figure &other) const
+{
+    return distance_figure(other);
+}
+
+double Transformed::distance(const Segment &other) const
+{
+    return distance_figure(other);
+}
+
+double Transformed::distance(const Circle &other) const
+{
+    return distance_figure(other);
+}
+
+double Transformed::distance(const Polyline &other) const
+{
+    return distance_figure(other);
+}
+
+double Transformed::distance(const Polygon &other) const
+{
+    return distance_figure(other);
+}
+
+double Transformed::distance(const Rectangle &other) const
+{
+    return distance_figure(other);
+}
+
+double Transformed::distance(const Arc &other) const
+{
+    return distance_figure(other);
+}
+
+double Transformed::distance(const Bezier &other) const
+{
+    return distance_figure(other);
+}
+
+// A world ray maps to a shape-space ray whose unit of length is stretched
+// by the length of the mapped direction, for any invertible matrix.
+double Transformed::first_hit(const Ray &ray) const
+{
+    Point direction = inverse_.linear(ray.dx(), ray.dy());
+    double stretch = hypot(direction.x(), direction.y());
+    Ray local(inverse_(ray.origin()), direction.x(), direction.y(), ray.max_distance() * stretch);
+    return shape_->first_hit(local) / stretch;
+}
+
+Distances Transformed::hits(const Ray &ray) const
+{
+    Point direction = inverse_.linear(ray.dx(), ray.dy());
+    double stretch = hypot(direction.x(), direction.y());
+    Ray local(inverse_(ray.origin()), direction.x(), direction.y(), ray.max_distance() * stretch);
+    Distances result = shape_->hits(local);
+    for (auto &distance : result) {
+        distance /= stretch;
+    }
+    return result;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <memory>
+#include "figures.h"
+
+// 2x3 affine matrix: x' = a x + b y + tx, y' = c x + d y + ty
+class Affine
+{
+public:
+    // identity
+    Affine() : Affine(1, 0, 0, 1, 0, 0) {}
+    Affine(double a, double b, double c, double d, double tx, double ty)
+        : a_(a), b_(b), c_(c), d_(d), tx_(tx), ty_(ty) {}
+
+    static Affine translation(double dx, double dy) { return Affine(1, 0, 0, 1, dx, dy); }
+    // counterclockwise, radians
+    static Affine rotation(double angle);
+    static Affine scaling(double sx, double sy) { return Affine(sx, 0, 0, sy, 0, 0); }
+
+    double a() const { return a_; }
+    double b() const { return b_; }
+    double c() const { return c_; }
+    double d() const { return d_; }
+    double tx() const { return tx_; }
+    double ty() const { return ty_; }
+
+    Point operator()(const Point &point) const
+    {
+        return Point(a_ * point.x() + b_ * point.y() + tx_, c_ * point.x() + d_ * point.y() + ty_);
+    }
+    // without the translation, for directions
+    Point linear(double x, double y) const { return Point(a_ * x + b_ * y, c_ * x + d_ * y); }
+    // box of the transformed corners
+    BoundingBox operator()(const BoundingBox &box) const;
+
+    // applies other first, then this
+    Affine operator*(const Affine &other) const;
+    // throws std::invalid_argument for a singular matrix
+    Affine inverse() const;
+
+    double determinant() const { return a_ * d_ - b_ * c_; }
+    // the common scale factor of a rotation, reflection or uniform scale
+    // (plus translation), which keeps circles circles and scales every
+    // distance alike; 0 for other matrices
+    double similarity_scale() const;
+
+private:
+    double a_, b_, c_, d_, tx_, ty_;
+};
+
+// World-space copy of a figure. Circles and arcs become polylines within
+// EPS of the true curve unless the matrix is a similarity, rectangles
+// become polygons unless it keeps the axes.
+std::unique_ptr<Figure> transform(const Figure &figure, const Affine &matrix);
+
+// A shared template figure placed by an affine matrix, e.g. one footprint
+// at thousands of positions. The shape is stored once; an instance adds the
+// matrix, its inverse and lazily built caches.
+//
+// Intersections map the query into the shape's space with the inverse, run
+// the shape's own kernels and map the points back, unless the query has
+// more vertices than the shape, in which case it meets a world-space copy
+// of the shape instead. Ray queries always run in shape space. Distances do
+// too for similarity matrices; others use the world-space copy. The copy
+// lives only as long as the query that needs it, so an instance holds no
+// more than its bbox.
+class Transformed : public Figure
+{
+public:
+    // throws std::invalid_argument for a null shape or singular matrix
+    Transformed(std::shared_ptr<const Figure> shape, const Affine &matrix);
+
+    Transformed(const Transformed &other);
+    Transformed(Transformed &&other) noexcept = default;
+    Transformed &operator=(const Transformed &other);
+    Transformed &operator=(Transformed &&other) noexcept = default;
+
+    const Figure &shape() const { return *shape_; }
+    const std::shared_ptr<const Figure> &shared_shape() const { return shape_; }
+    const Affine &matrix() const { return matrix_; }
+    const Affine &inverse() const { return inverse_; }
+    // world-space copy of the shape, built anew on every call
+    std::unique_ptr<Figure> world() const { return transform(*shape_, matrix_); }
+
+    double length() const override;
+    // built on first use
+    BoundingBox bbox() const override;
+
+    using Figure::intersect;
+    Points intersect(const Figure &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Segment &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Circle &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Polyline &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Polygon &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Rectangle &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Arc &other, std::pmr::memory_resource *resource) const override;
+    Points intersect(const Bezier &other, std::pmr::memory_resource *resource) const override;
+
+    double distance(const Point &point) const override;
+    double distance(const Figure &other) const override;
+    double distance(const Segment &other) const override;
+    double distance(const Circle &other) const override;
+    double distance(const Polyline &other) const override;
+    double distance(const Polygon &other) const override;
+    double distance(const Rectangle &other) const override;
+    double distance(const Arc &other) const override;
+    double distance(const Bezier &other) const override;
+
+    double first_hit(const Ray &ray) const override;
+    Distances hits(const Ray &ray) const override;
+    bool encloses(const Point &point) const override { return shape_->encloses(inverse_(point)); }
+
+private:
+    Points intersect_figure(const Figure &other, std::pmr::memory_resource *resource) const;
+    double distance_figure(const Figure &other) const;
+
+    std::shared_ptr<const Figure> shape_;
+    Affine matrix_;
+    Affine inverse_;
+    // 0 unless the matrix is a similarity
+    double scale_;
+    mutable std::shared_ptr<const BoundingBox> bbox_;
+};
@@ -0,0 +1,416 @@
+#include <cctype>
+#include <cmath>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include "wkt.h"
+
+namespace {
+
+// longest number token accepted by the reader
+const std::size_t MAX_TOKEN = 128;
+
+bool is_keyword(const char *keyword, const char *expected)
+{
+    return std::strcmp(keyword, expected) == 0;
+}
+
+}//namespace
+
+//WktReader
+WktReader::WktReader(std::istream &in, std::size_t buffer_size)
+    : in_(in), buffer_(buffer_size > 2 * MAX_TOKEN ? buffer_size : 2 * MAX_TOKEN)
+{
+}
+
+bool WktReader::fill(std::size_t count)
+{
+    if (end_ - pos_ >= count) {
+        return true;
+    }
+    std::memmove(buffer_.data(), buffer_.data() + pos_, end_ - pos_);
+    offset_ += pos_;
+    end_ -= pos_;
+    pos_ = 0;
+
+    while (end_ < buffer_.size() && in_) {
+        in_.read(buffer_.data() + end_, static_cast<std::streamsize>(buffer_.size() - end_));
+        end_ += static_cast<std::size_t>(in_.gcount());
+    }
+    return end_ - pos_ >= count;
+}
+
+bool WktReader::skip_space()
+{
+    while (fill(1)) {
+        if (!std::isspace(static_cast<unsigned char>(buffer_[pos_]))) {
+            return true;
+        }
+        pos_++;
+    }
+    return false;
+}
+
+bool WktReader::read_keyword(char *keyword, std::size_t size)
+{
+    std::size_t length = 0;
+    while (fill(1) && std::isalpha(static_cast<unsigned char>(buffer_[pos_]))) {
+        if (length + 1 == size) {
+            fail("unknown geometry");
+        }
+        keyword[length++] = static_cast<char>(std::toupper(static_cast<unsigned char>(buffer_[pos_++])));
+    }
+    keyword[length] = '\0';
+    return length > 0;
+}
+
+void WktReader::expect(char c)
+{
+    if (!accept(c)) {
+        fail(c == '(' ? "expected '('" : c == ')' ? "expected ')'" : "expected ','");
+    }
+}
+
+bool WktReader::accept(char c)
+{
+    if (skip_space() && buffer_[pos_] == c) {
+        pos_++;
+        return true;
+    }
+    return false;
+}
+
+double WktReader::read_number()
+{
+    if (!skip_space()) {
+        fail("expected number");
+    }
+    fill(MAX_TOKEN);
+    if (buffer_[pos_] == '+') {
+        pos_++;
+    }
+
+    double value = 0;
+    const char *first = buffer_.data() + pos_;
+    auto parsed = std::from_chars(first, buffer_.data() + end_, value);
+    if (parsed.ec != std::errc()) {
+        fail("expected number");
+    }
+    pos_ += static_cast<std::size_t>(parsed.ptr - first);
+    return value;
+}
+
+void WktReader::read_points()
+{
+    points_.clear();
+    expect('(');
+    do {
+        double x = read_number();
+        double y = read_number();
+        points_.emplace_back(x, y);
+    } while (accept(','));
+    expect(')');
+}
+
+void WktReader::read_polygon()
+{
+    std::size_t count = 0;
+    expect('(');
+    do {
+        read_points();
+        if (rings_.size() == count) {
+            rings_.emplace_back();
+        }
+        rings_[count++].assign(points_.begin(), points_.end());
+    } while (accept(','));
+    expect(')');
+
+    try {
+        other_ = std::make_unique<Polygon>(rings_[0], std::vector<std::vector<Point>>(rings_.begin() + 1,
+                                                                                     rings_.begin() + count));
+    } catch (const std::invalid_argument &) {
+        fail("POLYGON ring needs at least three points");
+    }
+    kind_ = Scene::Kind::OTHER;
+}
+
+void WktReader::set_arc()
+{
+    //circumcenter; d is twice the signed area, positive when a, b, c turn counterclockwise
+    const Point &a = points_[0];
+    const Point &b = points_[1];
+    const Point &c = points_[2];
+    double d = 2 * ((b.x() - a.x()) * (c.y() - a.y()) - (c.x() - a.x()) * (b.y() - a.y()));
+    if (fabs(d) <= EPS * a.distance(b) * a.distance(c)) {
+        fail("collinear CIRCULARSTRING");
+    }
+    double a2 = a.x() * a.x() + a.y() * a.y();
+    double b2 = b.x() * b.x() + b.y() * b.y();
+    double c2 = c.x() * c.x() + c.y() * c.y();
+    double x = (a2 * (b.y() - c.y()) + b2 * (c.y() - a.y()) + c2 * (a.y() - b.y())) / d;
+    double y = (a2 * (c.x() - b.x()) + b2 * (a.x() - c.x()) + c2 * (b.x() - a.x())) / d;
+
+    double start = atan2(a.y() - y, a.x() - x);
+    double end = atan2(c.y() - y, c.x() - x);
+    if (d < 0) {
+        std::swap(start, end);
+    }
+    other_ = std::make_unique<Arc>(x, y, a.distance(Point(x, y)), start, end);
+    kind_ = Scene::Kind::OTHER;
+}
+
+bool WktReader::next()
+{
+    char keyword[32];
+    while (true) {
+        if (!skip_space()) {
+            return false;
+        }
+        if (buffer_[pos_] == ';') {
+            pos_++;
+            continue;
+        }
+        if (!read_keyword(keyword, sizeof(keyword))) {
+            fail("expected geometry");
+        }
+
+        if (is_keyword(keyword, "LINESTRING") || is_keyword(keyword, "CIRCULARSTRING")) {
+            bool circular = is_keyword(keyword, "CIRCULARSTRING");
+            skip_space();
+            if (read_keyword(keyword, sizeof(keyword))) {
+                if (!is_keyword(keyword, "EMPTY")) {
+                    fail("unsupported coordinates");
+                }
+                continue;
+            }
+            read_points();
+
+            if (circular) {
+                if (points_.size() != 3) {
+                    fail("only single-arc CIRCULARSTRINGs are supported");
+                }
+                if (points_[0] == points_[2]) {
+                    const Point &a = points_[0];
+                    const Point &b = points_[1];
+                    circle_ = Circle((a.x() + b.x()) / 2, (a.y() + b.y()) / 2, a.distance(b) / 2);
+                    kind_ = Scene::Kind::CIRCLE;
+                } else {
+                    set_arc();
+                }
+            } else if (points_.size() == 2) {
+                segment_ = Segment(points_[0], points_[1]);
+                kind_ = Scene::Kind::SEGMENT;
+            } else if (points_.size() > 2) {
+                polyline_ = PolylineView(points_.data(), points_.size());
+                kind_ = Scene::Kind::POLYLINE;
+            } else {
+                fail("LINESTRING needs at least two points");
+            }
+            return true;
+        }
+
+        if (is_keyword(keyword, "POLYGON")) {
+            skip_space();
+            if (read_keyword(keyword, sizeof(keyword))) {
+                if (!is_keyword(keyword, "EMPTY")) {
+                    fail("unsupported coordinates");
+                }
+                continue;
+            }
+            read_polygon();
+            return true;
+        }
+
+        if (is_keyword(keyword, "POINT")) {
+            expect('(');
+            double x = read_number();
+            double y = read_number();
+            expect(')');
+            circle_ = Circle(x, y, read_number());
+            kind_ = Scene::Kind::CIRCLE;
+            return true;
+        }
+
+        fail("unsupported geometry");
+    }
+}
+
+const Figure &WktReader::figure() const
+{
+    switch (kind_) {
+    case Scene::Kind::CIRCLE:
+        return circle_;
+    case Scene::Kind::POLYLINE:
+        return polyline_;
+    case Scene::Kind::OTHER:
+        return *other_;
+    default:
+        return segment_;
+    }
+}
+
+void WktReader::fail(const char *what) const
+{
+    throw std::runtime_error(std::string("wkt: ") + what + " at byte " + std::to_string(offset_ + pos_));
+}
+
+std::size_t read_wkt(std::istream &in, Scene &scene)
+{
+    WktReader reader(in);
+    std::size_t count = 0;
+    while (reader.next()) {
+        switch (reader.kind()) {
+        case Scene::Kind::CIRCLE:
+            scene.add(reader.circle());
+            break;
+        case Scene::Kind::POLYLINE:
+            scene.add(Polyline(std::pmr::vector<Point>(reader.polyline().begin(), reader.polyline().end())));
+            break;
+        case Scene::Kind::OTHER:
+            scene.add(reader.release_other());
+            break;
+        default:
+            scene.add(reader.segment());
+            break;
+        }
+        count++;
+    }
+    return count;
+}
+
+//WktWriter
+void WktWriter::write_number(double value)
+{
+    char text[32];
+    auto written = std::to_chars(text, text + sizeof(text), value);
+    out_.write(text, written.ptr - text);
+}
+
+void WktWriter::write_coordinates(const Point &point)
+{
+    write_number(point.x());
+    out_.put(' ');
+    write_number(point.y());
+}
+
+void WktWriter::write(const Point &point)
+{
+    out_ << "POINT (";
+    write_coordinates(point);
+    out_ << ")\n";
+}
+
+void WktWriter::write(const Points &points)
+{
+    if (points.empty()) {
+        out_ << "MULTIPOINT EMPTY\n";
+        return;
+    }
+    out_ << "MULTIPOINT (";
+    for (std::size_t i = 0; i < points.size(); i++) {
+        out_ << (i == 0 ? "(" : ", (");
+        write_coordinates(points[i]);
+        out_.put(')');
+    }
+    out_ << ")\n";
+}
+
+void WktWriter::write(const Segment &segment)
+{
+    out_ << "LINESTRING (";
+    write_coordinates(segment.start());
+    out_ << ", ";
+    write_coordinates(segment.end());
+    out_ << ")\n";
+}
+
+void WktWriter::write(const Circle &circle)
+{
+    Point west(circle.center().x() - circle.radius(), circle.center().y());
+    Point east(circle.center().x() + circle.radius(), circle.center().y());
+    out_ << "CIRCULARSTRING (";
+    write_coordinates(west);
+    out_ << ", ";
+    write_coordinates(east);
+    out_ << ", ";
+    write_coordinates(west);
+    out_ << ")\n";
+}
+
+void WktWriter::write(const Polyline &polyline)
+{
+    out_ << "LINESTRING (";
+    for (std::size_t i = 0; i < polyline.size(); i++) {
+        if (i > 0) {
+            out_ << ", ";
+        }
+        write_coordinates(polyline[i]);
+    }
+    out_ << ")\n";
+}
+
+void WktWriter::write(const Polygon &polygon)
+{
+    out_ << "POLYGON (";
+    for (std::size_t r = 0; r < polygon.rings().size(); r++) {
+        const Polyline &ring = polygon.rings()[r];
+        out_ << (r > 0 ? ", (" : "(");
+        for (std::size_t i = 0; i < ring.size(); i++) {
+            if (i > 0) {
+                out_ << ", ";
+            }
+            write_coordinates(ring[i]);
+        }
+        out_ << ")";
+    }
+    out_ << ")\n";
+}
+
+void WktWriter::write(const Rectangle &rectangle)
+{
+    const BoundingBox &box = rectangle.box();
+    out_ << "POLYGON ((";
+    write_coordinates(Point(box.min_x(), box.min_y()));
+    out_ << ", ";
+    write_coordinates(Point(box.max_x(), box.min_y()));
+    out_ << ", ";
+    write_coordinates(Point(box.max_x(), box.max_y()));
+    out_ << ", ";
+    write_coordinates(Point(box.min_x(), box.max_y()));
+    out_ << ", ";
+    write_coordinates(Point(box.min_x(), box.min_y()));
+    out_ << "))\n";
+}
+
+void WktWriter::write(const Arc &arc)
+{
+    double middle = arc.start_angle() + arc.sweep() / 2;
+    out_ << "CIRCULARSTRING (";
+    write_coordinates(arc.start());
+    out_ << ", ";
+    write_coordinates(Point(arc.center().x() + arc.radius() * cos(middle),
+                            arc.center().y() + arc.radius() * sin(middle)));
+    out_ << ", ";
+    write_coordinates(arc.end());
+    out_ << ")\n";
+}
+
+void WktWriter::write(const Figure &figure)
+{
+    if (auto segment = dynamic_cast<const Segment *>(&figure)) {
+        write(*segment);
+    } else if (auto circle = dynamic_cast<const Circle *>(&figure)) {
+        write(*circle);
+    } else if (auto polyline = dynamic_cast<const Polyline *>(&figure)) {
+        write(*polyline);
+    } else if (auto polygon = dynamic_cast<const Polygon *>(&figure)) {
+        write(*polygon);
+    } else if (auto rectangle = dynamic_cast<const Rectangle *>(&figure)) {
+        write(*rectangle);
+    } else if (auto arc = dynamic_cast<const Arc *>(&figure)) {
+        write(*arc);
+    } else {
+        throw std::invalid_argument("wkt: unsupported figure type");
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <vector>
+#include "figures.h"
+#include "polygon.h"
+#include "rectangle.h"
+#include "arc.h"
+#include "scene.h"
+
+// Streaming WKT reader. Understands
+//   LINESTRING (x y, x y)            -> Segment
+//   LINESTRING (x y, x y, x y, ...)  -> Polyline
+//   CIRCULARSTRING (x1 y1, x2 y2, x1 y1) -> Circle with diameter p1-p2
+//   CIRCULARSTRING (x1 y1, x2 y2, x3 y3) -> Arc through the three points
+//   POLYGON ((x y, ...), (x y, ...)) -> Polygon, outer ring then holes
+//   POINT (x y) radius               -> Circle
+// so every figure WktWriter writes reads back, rectangles as polygons. Its
+// point output, a POINT without a radius or a MULTIPOINT, is no figure and
+// is rejected. Arcs and polygons are of kind OTHER. Geometries are
+// separated by whitespace or ';'. The input is read through a fixed-size
+// buffer and the current figure is reused between calls, so memory stays
+// bounded by the largest geometry.
+// Throws std::runtime_error on malformed input.
+class WktReader
+{
+public:
+    explicit WktReader(std::istream &in, std::size_t buffer_size = 64 * 1024);
+
+    // reads the next geometry, false at the end of input
+    bool next();
+
+    // valid until the next call to next()
+    Scene::Kind kind() const { return kind_; }
+    const Figure &figure() const;
+    const Segment &segment() const { return segment_; }
+    const Circle &circle() const { return circle_; }
+    const Polyline &polyline() const { return polyline_; }
+    // takes over the current figure of kind OTHER
+    std::unique_ptr<Figure> release_other() { return std::move(other_); }
+
+private:
+    bool fill(std::size_t count);
+    bool skip_space();
+    bool read_keyword(char *keyword, std::size_t size);
+    void expect(char c);
+    bool accept(char c);
+    double read_number();
+    void read_points();
+    void read_polygon();
+    void set_arc();
+    [[noreturn]] void fail(const char *what) const;
+
+    std::istream &in_;
+    std::vector<char> buffer_;
+    std::size_t pos_ = 0;
+    std::size_t end_ = 0;
+    std::uint64_t offset_ = 0;
+
+    Scene::Kind kind_ = Scene::Kind::SEGMENT;
+    std::vector<Point> points_;
+    Segment segment_{0, 0, 0, 0};
+    Circle circle_{0, 0, 0};
+    PolylineView polyline_{static_cast<const Point *>(nullptr), 0};
+    std::vector<std::vector<Point>> rings_;
+    std::unique_ptr<Figure> other_;
+};
+
+// reads every geometry into the scene, returns the number of figures read
+std::size_t read_wkt(std::istream &in, Scene &scene);
+
+// WKT writer, one geometry per line. Circles are written as full
+// CIRCULARSTRINGs, intersection results as MULTIPOINTs.
+class WktWriter
+{
+public:
+    explicit WktWriter(std::ostream &out) : out_(out) {}
+
+    void write(const Point &point);
+    void write(const Points &points);
+    void write(const Segment &segment);
+    void write(const Circle &circle);
+    void write(const Polyline &polyline);
+    void write(const Polygon &polygon);
+    // as a counterclockwise POLYGON
+    void write(const Rectangle &rectangle);
+    // as a CIRCULARSTRING through its ends and middle
+    void write(const Arc &arc);
+    // throws std::invalid_argument for figure types without a WKT form
+    void write(const Figure &figure);
+
+private:
+    void write_number(double value);
+    void write_coordinates(const Point &point);
+
+    std::ostream &out_;
+};